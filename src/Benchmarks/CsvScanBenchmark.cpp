@@ -0,0 +1,212 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+#include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QTime>
+#include <QStringList>
+
+#include "CsvParser.h"
+#include "CsvTokenizer.h"
+
+using namespace std;
+
+
+namespace
+{
+   //! Exposes the line based tokenizer of the parser for comparison.
+   class LineTokenizer : public Parser::CsvParser
+   {
+   public:
+      using Parser::CsvParser::ExtractTokens;
+   };
+
+   //! Result of timing one tokenizer over one file.
+   struct Timing
+   {
+      qint64 llFields; //!< Fields extracted per pass, used as a sanity check
+      int    nMsec;    //!< Time for all passes
+   };
+
+   // Tokenizes the file a line at a time the way the parser used to.
+   Timing TimeExtractTokens( const QString& sFilename, int nIterations )
+   {
+      LineTokenizer parser;
+      QStringList   tokens;
+      Timing        timing = { 0, 0 };
+
+      QTime timer;
+      timer.start();
+      for( int n = 0; n < nIterations; ++n )
+      {
+         QFile file( sFilename );
+         if( !file.open( QIODevice::ReadOnly ) )
+         {
+            break;
+         }
+         QTextStream stream( &file );
+         QString line = stream.readLine();
+         timing.llFields = 0;
+         while( !line.isNull() )
+         {
+            parser.ExtractTokens( line, tokens );
+            timing.llFields += tokens.size();
+            line = stream.readLine();
+         }
+      }
+      timing.nMsec = timer.elapsed();
+
+      return timing;
+   }
+
+   // Tokenizes the mapped file with the scanner kernel given.
+   Timing TimeTokenizer( 
+      const char* pData, 
+      qint64 llSize, 
+      Parser::CsvScanner::Kernel eKernel, 
+      int nIterations )
+   {
+      Parser::CsvTokenizer tokenizer;
+      Data::RowSpans       row;
+      Timing               timing = { 0, 0 };
+      tokenizer.SetKernel( eKernel );
+
+      QTime timer;
+      timer.start();
+      for( int n = 0; n < nIterations; ++n )
+      {
+         tokenizer.SetData( pData, pData+llSize );
+         timing.llFields = 0;
+         while( tokenizer.NextRow( row ) )
+         {
+            timing.llFields += row.size();
+         }
+      }
+      timing.nMsec = timer.elapsed();
+
+      return timing;
+   }
+
+   // Prints a single result line.
+   void Report( const char* sName, const Timing& timing, qint64 llBytes )
+   {
+      double fSeconds = qMax(timing.nMsec, 1) / 1000.0;
+      cout << "   " << setw(24) << left << sName << right
+         << setw(10) << timing.nMsec << " ms"
+         << setw(10) << fixed << setprecision(1) << (llBytes / fSeconds) / (1024.0*1024.0) << " MB/s"
+         << setw(12) << timing.llFields << " fields" << endl;
+   }
+};
+
+
+// Compares the scanner kernels against CsvParser::ExtractTokens.
+// Usage: CsvScanBenchmark [data directory] [iterations]
+int main(int argc, char *argv[])
+{
+   QCoreApplication a(argc, argv);
+
+   QString sDataDir    = "../../../data";
+   int     nIterations = 20;
+   if( argc > 1 )
+   {
+      sDataDir = argv[1];
+   }
+   if( argc > 2 )
+   {
+      nIterations = qMax( atoi(argv[2]), 1 );
+   }
+
+   QDir dir( sDataDir );
+   QStringList files = dir.entryList( 
+      QStringList() << "Test Flight *.csv", QDir::Files, QDir::Name );
+   if( files.empty() )
+   {
+      cerr << "No \"Test Flight *.csv\" files found in " << qPrintable(sDataDir) << endl;
+      cerr << "Usage: " << argv[0] << " [data directory] [iterations]" << endl;
+      return 1;
+   }
+
+   cout << "Best supported kernel: " 
+      << Parser::CsvScanner::KernelName( Parser::CsvScanner::BestKernel() ) << endl;
+
+   const int nKernels = Parser::CsvScanner::Kernel_Avx2+1;
+   Timing totalLine = { 0, 0 };
+   Timing totalKernel[nKernels];
+   for( int k = 0; k < nKernels; ++k )
+   {
+      totalKernel[k].llFields = 0;
+      totalKernel[k].nMsec    = 0;
+   }
+   qint64 llTotalBytes = 0;
+
+   for( int f = 0; f < files.size(); ++f )
+   {
+      QFile file( dir.filePath(files.at(f)) );
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         cerr << "Unable to open " << qPrintable(file.fileName()) << endl;
+         continue;
+      }
+      qint64 llSize = file.size();
+      const char* pData = reinterpret_cast<const char*>( file.map(0, llSize) );
+      if( !pData )
+      {
+         cerr << "Unable to map " << qPrintable(file.fileName()) << endl;
+         continue;
+      }
+      qint64 llBytes = llSize * nIterations;
+      llTotalBytes += llBytes;
+
+      cout << qPrintable(files.at(f)) << " (" << llSize << " bytes x " << nIterations << ")" << endl;
+
+      Timing timing = TimeExtractTokens( file.fileName(), nIterations );
+      Report( "readLine+ExtractTokens", timing, llBytes );
+      totalLine.llFields += timing.llFields;
+      totalLine.nMsec    += timing.nMsec;
+
+      for( int k = 0; k < nKernels; ++k )
+      {
+         Parser::CsvScanner::Kernel eKernel = static_cast<Parser::CsvScanner::Kernel>(k);
+         if( Parser::CsvScanner::IsSupported(eKernel) )
+         {
+            timing = TimeTokenizer( pData, llSize, eKernel, nIterations );
+            Report( Parser::CsvScanner::KernelName(eKernel), timing, llBytes );
+            totalKernel[k].llFields += timing.llFields;
+            totalKernel[k].nMsec    += timing.nMsec;
+         }
+      }
+   }
+
+   cout << "All files" << endl;
+   Report( "readLine+ExtractTokens", totalLine, llTotalBytes );
+   for( int k = 0; k < nKernels; ++k )
+   {
+      Parser::CsvScanner::Kernel eKernel = static_cast<Parser::CsvScanner::Kernel>(k);
+      if( Parser::CsvScanner::IsSupported(eKernel) )
+      {
+         Report( Parser::CsvScanner::KernelName(eKernel), totalKernel[k], llTotalBytes );
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,191 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <iomanip>
+
+#include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTime>
+#include <QStringList>
+#include <QWaitCondition>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "CsvParser.h"
+#include "DataMgmt.h"
+
+using namespace std;
+
+
+namespace
+{
+   //! Result of loading every file with one profile.
+   struct Timing
+   {
+      qint64 llRows; //!< Rows stored in the database
+      int    nMsec;  //!< Time from the first parse until every flight completed
+      Data::DataQueue::Statistics queue; //!< How full the queue of parsed buffers got
+      Data::DataBufferPool::Statistics pool; //!< How often parsers reused a buffer
+   };
+
+   // Blocks the calling thread for the given time.
+   void Sleep( int nMsec )
+   {
+      QMutex mutex;
+      QWaitCondition wait;
+      mutex.lock();
+      wait.wait( &mutex, nMsec );
+      mutex.unlock();
+   }
+
+   // Loads the files into a new database on disk with the profile given and
+   // times how long it takes for every flight to complete.
+   Timing TimeIngest( 
+      const QStringList& files,
+      const QString& sDatabase,
+      Data::DataMgmt::LoadProfile eProfile )
+   {
+      Timing timing = { 0, 0, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+      QFile::remove( sDatabase );
+
+      QStringList flights;
+      {
+         Data::DataMgmt dataMgmt;
+         if( !dataMgmt.Connect( sDatabase ) )
+         {
+            return timing;
+         }
+         dataMgmt.SetIngestMode( Data::DataMgmt::IngestMode_Database );
+         dataMgmt.SetLoadProfile( eProfile );
+         dataMgmt.start();
+
+         QTime timer;
+         timer.start();
+
+         QList<Parser::CsvParser*> parsers;
+         for( int f = 0; f < files.size(); ++f )
+         {
+            QString sFlightName = QString("Flight_%1").arg(f);
+            Parser::CsvParser* parser = new Parser::CsvParser;
+            parser->SetParseInformation( files.at(f), &dataMgmt, sFlightName, sDatabase );
+            parser->SetParallel( true );
+            parser->start();
+            parsers.append( parser );
+            flights.append( sFlightName );
+         }
+
+         QStringList loaded;
+         while( loaded.size() < files.size() )
+         {
+            Sleep( 10 );
+            dataMgmt.GetLoadedFlights( loaded );
+         }
+         timing.nMsec = timer.elapsed();
+         timing.queue = dataMgmt.GetQueueStatistics();
+         timing.pool  = dataMgmt.GetPoolStatistics();
+
+         qDeleteAll( parsers );
+      }
+
+      QSqlQuery q( QSqlDatabase::database(sDatabase) );
+      for( int f = 0; f < flights.size(); ++f )
+      {
+         if( q.exec("SELECT COUNT(*) FROM " + flights.at(f)) && q.next() )
+         {
+            timing.llRows += q.value(0).toLongLong();
+         }
+      }
+
+      return timing;
+   }
+
+   // Prints a single result line.
+   void Report( const char* sName, const Timing& timing, qint64 llBytes )
+   {
+      double fSeconds = qMax(timing.nMsec, 1) / 1000.0;
+      cout << "   " << setw(12) << left << sName << right
+         << setw(10) << timing.nMsec << " ms"
+         << setw(10) << fixed << setprecision(1) << (llBytes / fSeconds) / (1024.0*1024.0) << " MB/s"
+         << setw(12) << setprecision(0) << timing.llRows / fSeconds << " rows/s"
+         << setw(12) << timing.llRows << " rows" << endl;
+      cout << "   " << setw(12) << "" << " queue high water " 
+         << timing.queue.nHighWaterBuffers << " buffers, "
+         << setprecision(1) << timing.queue.llHighWaterBytes / (1024.0*1024.0) << " MB, "
+         << "parsers waited " << timing.queue.nBlocked << " times for " 
+         << timing.queue.llBlockedMsec << " ms" << endl;
+      cout << "   " << setw(12) << "" << " buffer pool " 
+         << timing.pool.nHits << " reused, "
+         << timing.pool.nMisses << " allocated, "
+         << timing.pool.nDropped << " freed" << endl;
+   }
+};
+
+
+// Compares loading the flights into an SQLite database on disk with the safe
+// and bulk load profiles of DataMgmt.
+// Usage: IngestBenchmark [data directory] [database directory]
+int main(int argc, char *argv[])
+{
+   QCoreApplication a(argc, argv);
+
+   QString sDataDir     = "../../../data";
+   QString sDatabaseDir = QDir::tempPath();
+   if( argc > 1 )
+   {
+      sDataDir = argv[1];
+   }
+   if( argc > 2 )
+   {
+      sDatabaseDir = argv[2];
+   }
+
+   QDir dir( sDataDir );
+   QStringList names = dir.entryList( 
+      QStringList() << "Test Flight *.csv", QDir::Files, QDir::Name );
+   if( names.empty() )
+   {
+      cerr << "No \"Test Flight *.csv\" files found in " << qPrintable(sDataDir) << endl;
+      cerr << "Usage: " << argv[0] << " [data directory] [database directory]" << endl;
+      return 1;
+   }
+
+   QStringList files;
+   qint64 llBytes = 0;
+   for( int f = 0; f < names.size(); ++f )
+   {
+      files.append( dir.filePath(names.at(f)) );
+      llBytes += QFileInfo( files.last() ).size();
+   }
+   cout << files.size() << " files, " << llBytes << " bytes" << endl;
+
+   QDir databaseDir( sDatabaseDir );
+   Timing safe = TimeIngest( files, 
+      databaseDir.filePath("IngestBenchmark_Safe.sqlite"), Data::DataMgmt::LoadProfile_Safe );
+   Timing bulk = TimeIngest( files, 
+      databaseDir.filePath("IngestBenchmark_Bulk.sqlite"), Data::DataMgmt::LoadProfile_BulkLoad );
+
+   Report( "Safe", safe, llBytes );
+   Report( "BulkLoad", bulk, llBytes );
+   cout << "   Speedup " << setprecision(2) 
+      << static_cast<double>(qMax(safe.nMsec, 1)) / qMax(bulk.nMsec, 1) << "x" << endl;
+
+   return 0;
+}
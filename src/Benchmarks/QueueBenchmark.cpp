@@ -0,0 +1,230 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+#include <QtCore/QCoreApplication>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QTime>
+#include <QWaitCondition>
+
+#include "DataQueue.h"
+
+using namespace std;
+
+
+namespace
+{
+   // Size of the buffers passed through the queues, a typical parse buffer.
+   const int nRows    = 500;
+   const int nColumns = 16;
+
+   // Numbers of producers compared.
+   const int nProducerCounts[] = { 1, 2, 4, 8, 16 };
+
+   //! Result of passing every buffer through one queue.
+   struct Timing
+   {
+      int nMsec;    //!< Time from starting the producers until every buffer arrived
+      int nBlocked; //!< Number of times a producer waited for room
+   };
+
+   // Blocks the calling thread for the given time.
+   void Sleep( int nMsec )
+   {
+      QMutex mutex;
+      QWaitCondition wait;
+      mutex.lock();
+      wait.wait( &mutex, nMsec );
+      mutex.unlock();
+   }
+
+   //! The queue DataMgmt used before, a QQueue behind a mutex that the 
+   //! consumer polls.  The consumer slept 500 ms when the queue was empty;
+   //! here it sleeps 1 ms so the comparison is about contention rather 
+   //! than the poll interval.
+   class LockedQueue
+   {
+   public:
+      bool Enqueue( Data::DataBuffer& buffer )
+      {
+         m_mutex.lock();
+         m_queue.enqueue( buffer );
+         m_mutex.unlock();
+         buffer = Data::DataBuffer();
+         return true;
+      }
+
+      bool Dequeue( Data::DataBuffer& buffer )
+      {
+         bool bRetVal(false);
+         m_mutex.lock();
+         if( !m_queue.empty() )
+         {
+            buffer = m_queue.dequeue();
+            bRetVal = true;
+         }
+         m_mutex.unlock();
+         return bRetVal;
+      }
+
+      bool WaitForData( unsigned long )
+      {
+         Sleep( 1 );
+         return true;
+      }
+
+      Data::DataQueue::Statistics GetStatistics() const
+      {
+         Data::DataQueue::Statistics stats = { 0, 0, 0, 0 };
+         return stats;
+      }
+
+   private:
+      QMutex                   m_mutex;
+      QQueue<Data::DataBuffer> m_queue;
+   };
+
+   //! Thread queuing the same buffer over and over.
+   template< class Queue >
+   class Producer : public QThread
+   {
+   public:
+      Producer( Queue& queue, const Data::DataBuffer& buffer, int nBuffers )
+         : m_queue(queue)
+         , m_buffer(buffer)
+         , m_nBuffers(nBuffers)
+      {
+      }
+
+   protected:
+      void run()
+      {
+         // The queues take the contents of what they are given, so each 
+         // buffer queued is a copy, like one freshly filled by a parser.
+         for( int i = 0; i < m_nBuffers; ++i )
+         {
+            Data::DataBuffer buffer = m_buffer;
+            m_queue.Enqueue( buffer );
+         }
+      }
+
+   private:
+      Queue&           m_queue;
+      Data::DataBuffer m_buffer;
+      int              m_nBuffers;
+   };
+
+   // Passes the buffers of every producer through a queue to a consumer on
+   // the calling thread.
+   template< class Queue >
+   Timing TimeQueue( int nProducers, int nBuffers, const Data::DataBuffer& buffer )
+   {
+      Queue queue;
+      QList< Producer<Queue>* > producers;
+      for( int p = 0; p < nProducers; ++p )
+      {
+         producers.append( new Producer<Queue>(queue, buffer, nBuffers) );
+      }
+
+      QTime timer;
+      timer.start();
+      for( int p = 0; p < nProducers; ++p )
+      {
+         producers.at(p)->start();
+      }
+
+      Data::DataBuffer received;
+      int nReceived = 0;
+      while( nReceived < nProducers*nBuffers )
+      {
+         if( queue.Dequeue(received) )
+         {
+            ++nReceived;
+         }
+         else
+         {
+            queue.WaitForData( 500 );
+         }
+      }
+
+      Timing timing;
+      timing.nMsec    = timer.elapsed();
+      timing.nBlocked = queue.GetStatistics().nBlocked;
+
+      for( int p = 0; p < nProducers; ++p )
+      {
+         producers.at(p)->wait();
+      }
+      qDeleteAll( producers );
+
+      return timing;
+   }
+
+   // Prints a single result line.
+   void Report( const char* sName, const Timing& timing, int nBuffers )
+   {
+      double fSeconds = qMax(timing.nMsec, 1) / 1000.0;
+      cout << "   " << setw(12) << left << sName << right
+         << setw(10) << timing.nMsec << " ms"
+         << setw(12) << fixed << setprecision(0) << nBuffers / fSeconds << " buffers/s"
+         << setw(10) << timing.nBlocked << " waits" << endl;
+   }
+};
+
+
+// Compares DataQueue with a mutex protected QQueue as 1 to 16 producers
+// pass buffers to a single consumer.
+// Usage: QueueBenchmark [buffers]
+int main(int argc, char *argv[])
+{
+   QCoreApplication a(argc, argv);
+
+   int nTotal = 100000;
+   if( argc > 1 )
+   {
+      nTotal = qMax( atoi(argv[1]), 1 );
+   }
+
+   Data::DataBuffer buffer;
+   buffer.sFlightName = "Benchmark";
+   buffer.numeric.resize( nColumns );
+   for( int c = 0; c < nColumns; ++c )
+   {
+      for( int r = 0; r < nRows; ++r )
+      {
+         buffer.numeric[c].append( r );
+      }
+   }
+   buffer.nRows = nRows;
+
+   for( unsigned int i = 0; i < sizeof(nProducerCounts)/sizeof(nProducerCounts[0]); ++i )
+   {
+      int nProducers = nProducerCounts[i];
+      int nBuffers   = qMax( nTotal / nProducers, 1 );
+      cout << nProducers << " producers, " << nBuffers*nProducers << " buffers" << endl;
+
+      Report( "LockedQueue", TimeQueue<LockedQueue>(nProducers, nBuffers, buffer), nBuffers*nProducers );
+      Report( "DataQueue", TimeQueue<Data::DataQueue>(nProducers, nBuffers, buffer), nBuffers*nProducers );
+   }
+
+   return 0;
+}
@@ -0,0 +1,377 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <iomanip>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThreadPool>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "CsvParser.h"
+#include "EventDetector.h"
+#include "FlightBatch.h"
+
+using namespace std;
+
+
+// In memory database used when no database is given, as in the application.
+const QString sMemoryConnection = ":memory:";
+
+
+FlightBatch::FlightBatch(QObject* parent)
+   : QObject(parent)
+   , m_eIngestMode(Data::DataMgmt::IngestMode_Deferred)
+   , m_bIngestMode(false)
+   , m_nThreads(QThread::idealThreadCount())
+   , m_nShards(0)
+   , m_nPending(0)
+   , m_nParsing(0)
+   , m_nParseMsec(0)
+   , m_nIngestMsec(0)
+   , m_nEventMsec(0)
+   , m_llRows(0)
+{
+   connect
+      ( &m_dataMgmt,   SIGNAL(FlightComplete(QString))
+      , this,          SLOT(FlightComplete(QString)) );
+   connect
+      ( &m_ingestPool, SIGNAL(jobFinished(int,QString,bool,bool))
+      , this,          SLOT(CsvFileDone(int,QString,bool,bool)) );
+}
+
+void FlightBatch::SetThreads( int nThreads )
+{
+   m_nThreads = qMax( nThreads, 1 );
+}
+
+void FlightBatch::SetDatabase( const QString& sDatabase )
+{
+   m_sDatabase = sDatabase;
+}
+
+void FlightBatch::SetIngestMode( Data::DataMgmt::IngestMode eMode )
+{
+   m_eIngestMode = eMode;
+   m_bIngestMode = true;
+}
+
+void FlightBatch::SetShards( int nShards )
+{
+   m_nShards = qBound( 0, nShards, Data::DataMgmt::nMaxShards );
+}
+
+void FlightBatch::SetEventFile( const QString& sEventFile )
+{
+   m_sEventFile = sEventFile;
+}
+
+QStringList FlightBatch::FindFiles( const QStringList& paths )
+{
+   QStringList files;
+   for( int p = 0; p < paths.size(); ++p )
+   {
+      QFileInfo info( paths.at(p) );
+      if( info.isDir() )
+      {
+         QDir dir( paths.at(p) );
+         QStringList names = dir.entryList( 
+            QStringList() << "*.csv" << "*.csv.gz", QDir::Files, QDir::Name );
+         for( int n = 0; n < names.size(); ++n )
+         {
+            files.append( dir.filePath(names.at(n)) );
+         }
+      }
+      else if( info.exists() )
+      {
+         files.append( paths.at(p) );
+      }
+      else
+      {
+         cerr << "No such file or directory " << qPrintable(paths.at(p)) << endl;
+      }
+   }
+   return files;
+}
+
+int FlightBatch::Run( const QStringList& files )
+{
+   // The database is setup as in the application unless one is given.
+   if( m_sDatabase.isEmpty() )
+   {
+      m_dataMgmt.Connect( sMemoryConnection );
+   }
+   else
+   {
+      QFile::remove( m_sDatabase );
+      for( int i = 0; i < Data::DataMgmt::nMaxShards; ++i )
+      {
+         QString sShard = QString("%1.shard%2").arg(m_sDatabase).arg(i);
+         QFile::remove( sShard );
+         QFile::remove( sShard + "-wal" );
+         QFile::remove( sShard + "-shm" );
+      }
+      if( !m_dataMgmt.Connect( m_sDatabase ) )
+      {
+         return 2;
+      }
+      m_dataMgmt.SetLoadProfile( Data::DataMgmt::LoadProfile_BulkLoad );
+      if( !m_bIngestMode )
+      {
+         m_eIngestMode = Data::DataMgmt::IngestMode_Database;
+      }
+   }
+   if( m_nShards > 0 )
+   {
+      if( !m_bIngestMode )
+      {
+         m_eIngestMode = Data::DataMgmt::IngestMode_Database;
+      }
+      if( !m_dataMgmt.SetShards( m_nShards ) )
+      {
+         return 2;
+      }
+   }
+   m_dataMgmt.SetIngestMode( m_eIngestMode );
+
+   // Each flight is only read once, by the event detection, and never drawn.
+   m_dataMgmt.SetResultCacheCapacity( 0 );
+   m_dataMgmt.SetPyramids( false );
+   Event::EventDetector evtDetect;
+   m_dataMgmt.SetEventDefinition( evtDetect.GetEventDefinition() );
+
+   // Both the files and the chunks of a large file are limited to the 
+   // threads requested.
+   m_ingestPool.SetMaxThreads( m_nThreads );
+   QThreadPool::globalInstance()->setMaxThreadCount( m_nThreads );
+
+   qint64 llBytes = 0;
+   for( int f = 0; f < files.size(); ++f )
+   {
+      llBytes += QFileInfo( files.at(f) ).size();
+   }
+   cout << files.size() << " files, " << llBytes << " bytes, " 
+      << m_nThreads << " threads, " << m_nShards << " shards" << endl;
+
+   m_dataMgmt.start();
+   m_timer.start();
+   for( int f = 0; f < files.size(); ++f )
+   {
+      QString sFlightName = FlightName( files.at(f) );
+      Parser::CsvParser* parser = new Parser::CsvParser;
+      parser->SetParseInformation( files.at(f), &m_dataMgmt, sFlightName, m_sDatabase );
+      parser->SetParallel( true );
+      m_ingestPool.Submit( parser );
+      m_flights.append( sFlightName );
+      ++m_nPending;
+      ++m_nParsing;
+   }
+   if( m_nPending > 0 )
+   {
+      m_loop.exec();
+   }
+
+   Report( llBytes );
+   if( !m_sEventFile.isEmpty() && !WriteEvents() )
+   {
+      cerr << "Unable to write the events to " << qPrintable(m_sEventFile) << endl;
+   }
+
+   for( int f = 0; f < m_failed.size(); ++f )
+   {
+      cerr << "Unable to load all of the flight " << qPrintable(m_failed.at(f)) << endl;
+   }
+   return m_failed.empty() ? 0 : 2;
+}
+
+void FlightBatch::FlightComplete(QString sFlightName)
+{
+   // Events are detected as each flight completes, as in the application.
+   QTime timer;
+   timer.start();
+   Event::EventDetector evtDetect;
+   Data::EventData evtData;
+   if( evtDetect.DetectEvents( sFlightName, &m_dataMgmt, evtData ) )
+   {
+      m_dataMgmt.SetEventData( sFlightName, evtData );
+   }
+   m_nEventMsec += timer.elapsed();
+
+   m_llRows += m_dataMgmt.GetRowCount( sFlightName );
+   FlightDone();
+}
+
+void FlightBatch::CsvFileDone(int /*nJob*/, QString sFlightName, bool bSuccess, bool bCommitted)
+{
+   if( !bSuccess )
+   {
+      m_failed.append( sFlightName );
+   }
+
+   // The last flight may complete before the last parse job reports in, so
+   // the parse time is taken from the jobs themselves.
+   --m_nParsing;
+   if( m_nParsing == 0 )
+   {
+      m_nParseMsec = m_timer.elapsed();
+   }
+
+   // A flight that was never committed won't complete.
+   if( !bCommitted )
+   {
+      FlightDone();
+   }
+   else
+   {
+      CheckDone();
+   }
+}
+
+QString FlightBatch::FlightName( const QString& sFilename )
+{
+   // Table names are made from the file name without the extensions.
+   QString sFlightName = QFileInfo( sFilename ).fileName();
+   if( sFlightName.endsWith(".gz", Qt::CaseInsensitive) )
+   {
+      sFlightName.chop(3);
+   }
+   int index = sFlightName.lastIndexOf('.');
+   if( index != -1 )
+   {
+      sFlightName = sFlightName.left(index);
+   }
+   sFlightName.replace(' ', '_');
+   sFlightName.replace('-', '_');
+
+   // Files from different directories may share a name.
+   QString sUnique = sFlightName;
+   for( int n = 2; m_flights.contains(sUnique); ++n )
+   {
+      sUnique = QString("%1_%2").arg(sFlightName).arg(n);
+   }
+   return sUnique;
+}
+
+void FlightBatch::FlightDone()
+{
+   --m_nPending;
+   if( m_nPending == 0 )
+   {
+      m_nIngestMsec = m_timer.elapsed();
+   }
+   CheckDone();
+}
+
+void FlightBatch::CheckDone()
+{
+   if( m_nPending == 0 && m_nParsing == 0 )
+   {
+      m_loop.quit();
+   }
+}
+
+void FlightBatch::Report( qint64 llBytes ) const
+{
+   // Events are detected while other flights are still loading so their 
+   // time overlaps the ingest time.
+   double fSeconds = qMax(m_nIngestMsec, 1) / 1000.0;
+   cout << "   " << setw(8) << left << "Parse" << right
+      << setw(10) << m_nParseMsec << " ms" << endl;
+   cout << "   " << setw(8) << left << "Ingest" << right
+      << setw(10) << m_nIngestMsec << " ms"
+      << setw(10) << fixed << setprecision(1) << (llBytes / fSeconds) / (1024.0*1024.0) << " MB/s"
+      << setw(12) << setprecision(0) << m_llRows / fSeconds << " rows/s"
+      << setw(12) << m_llRows << " rows" << endl;
+   cout << "   " << setw(8) << left << "Events" << right
+      << setw(10) << m_nEventMsec << " ms" << endl;
+   cout << "   " << setw(8) << left << "Peak RSS" << right
+      << setw(10) << setprecision(1) << PeakMemory() / (1024.0*1024.0) << " MB" << endl;
+}
+
+bool FlightBatch::WriteEvents() const
+{
+   QFile file;
+   bool bOpen = false;
+   if( m_sEventFile == "-" )
+   {
+      bOpen = file.open( stdout, QIODevice::WriteOnly );
+   }
+   else
+   {
+      file.setFileName( m_sEventFile );
+      bOpen = file.open( QIODevice::WriteOnly | QIODevice::Truncate );
+   }
+   if( !bOpen )
+   {
+      return false;
+   }
+
+   QTextStream out( &file );
+   out << "Flight,Event,Found,Time,Sequence,Value,NormalizedValue\n";
+   const Data::EventContainer& events = m_dataMgmt.GetEventData()._events;
+   for( int f = 0; f < m_flights.size(); ++f )
+   {
+      const Data::EventData evtData = events.value( m_flights.at(f) );
+      for( int e = 0; e < evtData.size(); ++e )
+      {
+         const Data::EventValue& evt = evtData.at(e);
+         out << m_flights.at(f) << ","
+            << evt._eventName << ","
+            << (evt._bFound ? 1 : 0) << ","
+            << evt._time << ","
+            << evt._sequence << ","
+            << evt._value.toString() << ","
+            << evt._valueNormal.toString() << "\n";
+      }
+   }
+   out.flush();
+   return file.error() == QFile::NoError;
+}
+
+qint64 FlightBatch::PeakMemory()
+{
+#if defined(Q_OS_WIN)
+   PROCESS_MEMORY_COUNTERS counters;
+   if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+   {
+      return counters.PeakWorkingSetSize;
+   }
+   return 0;
+#else
+   // Linux reports the maximum resident set size in kilobytes, Mac OS X in 
+   // bytes.
+   struct rusage usage;
+   if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+   {
+      return 0;
+   }
+#if defined(Q_OS_MAC)
+   return usage.ru_maxrss;
+#else
+   return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
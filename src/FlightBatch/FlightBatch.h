@@ -0,0 +1,121 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLIGHTBATCH_H
+#define FLIGHTBATCH_H
+
+#include <QObject>
+#include <QEventLoop>
+#include <QStringList>
+#include <QTime>
+
+#include "DataMgmt.h"
+#include "IngestPool.h"
+
+
+//! Loads a batch of flights without a user interface.  Each file is parsed
+//! into the data management, its events are detected and the time taken by
+//! each stage is reported along with the throughput and peak memory use.
+class FlightBatch : public QObject
+{
+   Q_OBJECT
+
+public:
+   FlightBatch(QObject* parent = 0);
+
+   //! Sets the number of files parsed at the same time, which is also the 
+   //! number of threads splitting a single large file.
+   void SetThreads( int nThreads );
+
+   //! Stores the flights in an SQLite database on disk with the bulk load
+   //! profile rather than in memory.
+   //! @param sDatabase  Path of the database, replaced if it exists
+   void SetDatabase( const QString& sDatabase );
+
+   //! Selects how the flights are stored.  By default flights are stored as
+   //! in the application, or inserted into the database as they arrive when
+   //! one is given.
+   void SetIngestMode( Data::DataMgmt::IngestMode eMode );
+
+   //! Spreads the flights over shards committed in parallel, see 
+   //! DataMgmt::SetShards().  The flights are inserted into the database as
+   //! they arrive unless another ingest mode is selected.
+   //! @param nShards  Number of shards, 0 for none
+   void SetShards( int nShards );
+
+   //! Writes the detected events of every flight to a CSV file.
+   //! @param sEventFile  Path of the file, "-" for the standard output
+   void SetEventFile( const QString& sEventFile );
+
+   //! Finds the flights to load.  Directories are searched for CSV files.
+   //! @param paths  Files and directories
+   //! @return  CSV files in the order given, each directory sorted by name
+   static QStringList FindFiles( const QStringList& paths );
+
+   //! Loads every file and prints the report.
+   //! @param files  CSV files to load
+   //! @return  0 if every flight loaded, 2 otherwise
+   int Run( const QStringList& files );
+
+private slots:
+   //! Slot that detects the events of a flight once it is stored.
+   void FlightComplete(QString sFlightName);
+
+   //! Slot that handles the completion of a CSV file parse job.
+   void CsvFileDone(int nJob, QString sFlightName, bool bSuccess, bool bCommitted);
+
+private:
+   //! Makes a unique table name from the name of a file.
+   QString FlightName( const QString& sFilename );
+
+   //! Counts down the flights still loading, taking the ingest time at zero.
+   void FlightDone();
+
+   //! Ends the run once every file is parsed and every flight is done, 
+   //! whichever of them happens last.
+   void CheckDone();
+
+   //! Prints the time taken by each stage.
+   void Report( qint64 llBytes ) const;
+
+   //! Writes the events of every flight to the event file.
+   bool WriteEvents() const;
+
+   //! Returns the peak resident memory of the process in bytes.
+   static qint64 PeakMemory();
+
+   Data::DataMgmt      m_dataMgmt;    //!< Abstraction of the data management
+   Parser::IngestPool  m_ingestPool;  //!< Threads parsing the files
+   QEventLoop          m_loop;        //!< Runs until every flight is done
+   QTime               m_timer;       //!< Started when the first file is submitted
+   QString             m_sDatabase;   //!< Database on disk, empty for memory
+   QString             m_sEventFile;  //!< File receiving the events, empty for none
+   Data::DataMgmt::IngestMode m_eIngestMode; //!< How the flights are stored
+   bool                m_bIngestMode; //!< Flag indicating the ingest mode was selected
+   QStringList         m_flights;     //!< Flights in the order submitted
+   QStringList         m_failed;      //!< Flights that could not be completely loaded
+   int                 m_nThreads;    //!< Files parsed at the same time
+   int                 m_nShards;     //!< Shards the flights are spread over
+   int                 m_nPending;    //!< Flights still loading
+   int                 m_nParsing;    //!< Files still being parsed
+   int                 m_nParseMsec;  //!< Time until the last file was parsed
+   int                 m_nIngestMsec; //!< Time until the last flight was stored
+   int                 m_nEventMsec;  //!< Time spent detecting events
+   qint64              m_llRows;      //!< Rows stored across every flight
+};
+
+#endif // FLIGHTBATCH_H
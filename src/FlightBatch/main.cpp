@@ -0,0 +1,110 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+
+#include <QtCore/QCoreApplication>
+#include <QStringList>
+
+#include "FlightBatch.h"
+
+using namespace std;
+
+
+// Prints the command line options.
+void Usage( const char* sProgram )
+{
+   cerr << "Usage: " << sProgram << " [options] <file or directory>..." << endl
+      << "   -t, --threads <n>      Number of files parsed at the same time" << endl
+      << "   -d, --database <file>  SQLite database on disk, in memory by default" << endl
+      << "   -i, --ingest <mode>    Storage of the flights: database, columns or deferred" << endl
+      << "   -s, --shards <n>       Commit the flights to n database shards in parallel" << endl
+      << "   -e, --events <file>    Write the detected events as CSV, - for stdout" << endl;
+}
+
+// Loads a batch of flights without the user interface.  Directories are 
+// searched for *.csv and *.csv.gz files.
+int main(int argc, char *argv[])
+{
+   QCoreApplication a(argc, argv);
+   FlightBatch batch;
+
+   QStringList args = a.arguments();
+   QStringList paths;
+   for( int i = 1; i < args.size(); ++i )
+   {
+      const QString& sArg = args.at(i);
+      bool bValue = i+1 < args.size();
+      if( (sArg == "-t" || sArg == "--threads") && bValue )
+      {
+         bool bOk = false;
+         int nThreads = args.at(++i).toInt( &bOk );
+         if( !bOk || nThreads < 1 )
+         {
+            Usage( argv[0] );
+            return 1;
+         }
+         batch.SetThreads( nThreads );
+      }
+      else if( (sArg == "-d" || sArg == "--database") && bValue )
+      {
+         batch.SetDatabase( args.at(++i) );
+      }
+      else if( (sArg == "-i" || sArg == "--ingest") && bValue )
+      {
+         Data::DataMgmt::IngestMode eMode;
+         if( !Data::DataMgmt::ParseIngestMode( args.at(++i), eMode ) )
+         {
+            Usage( argv[0] );
+            return 1;
+         }
+         batch.SetIngestMode( eMode );
+      }
+      else if( (sArg == "-s" || sArg == "--shards") && bValue )
+      {
+         bool bOk = false;
+         int nShards = args.at(++i).toInt( &bOk );
+         if( !bOk || nShards < 0 || nShards > Data::DataMgmt::nMaxShards )
+         {
+            Usage( argv[0] );
+            return 1;
+         }
+         batch.SetShards( nShards );
+      }
+      else if( (sArg == "-e" || sArg == "--events") && bValue )
+      {
+         batch.SetEventFile( args.at(++i) );
+      }
+      else if( sArg.startsWith("-") )
+      {
+         Usage( argv[0] );
+         return 1;
+      }
+      else
+      {
+         paths.append( sArg );
+      }
+   }
+
+   QStringList files = FlightBatch::FindFiles( paths );
+   if( files.empty() )
+   {
+      Usage( argv[0] );
+      return 1;
+   }
+   return batch.Run( files );
+}
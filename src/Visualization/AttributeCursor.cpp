@@ -0,0 +1,231 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QSqlRecord>
+#include <QSqlField>
+#include <qnumeric.h>
+
+#include "AttributeCursor.h"
+
+
+namespace Data
+{
+   // Large enough that a block is read with little overhead, small enough 
+   // that it is drawn or processed soon after the read starts.
+   const int AttributeCursor::nDefaultBlockRows = 4096;
+
+   // ==========================================================================
+   // ==========================================================================
+   AttributeCursor::AttributeCursor()
+      : m_bOpen(false)
+      , m_nBlockRows(nDefaultBlockRows)
+      , m_nRead(0)
+      , m_bColumns(false)
+      , m_nTime(-1)
+      , m_nNext(0)
+      , m_nEnd(0)
+      , m_nStride(1)
+      , m_nQueryRow(0)
+   {
+   }
+
+   AttributeCursor::~AttributeCursor()
+   {
+      Close();
+   }
+
+   bool AttributeCursor::IsOpen() const
+   {
+      return m_bOpen;
+   }
+
+   bool AttributeCursor::Next( Data::Buffer& block )
+   {
+      // The block keeps the memory of its columns from one call to the next.
+      block.Clear();
+      block.SetAttributeCount( m_running.size() );
+      block.Reserve( m_nBlockRows );
+      if( m_bOpen )
+      {
+         if( m_bColumns )
+         {
+            NextColumns( block );
+         }
+         else
+         {
+            NextQuery( block );
+         }
+         m_nRead += block.RowCount();
+      }
+      block._metadata = GetMetadata();
+
+      return block.RowCount() > 0;
+   }
+
+   int AttributeCursor::GetRowCount() const
+   {
+      return m_nRead;
+   }
+
+   QList<Metadata> AttributeCursor::GetMetadata() const
+   {
+      if( !m_stored.empty() )
+      {
+         return m_stored;
+      }
+
+      QList<Metadata> metadata;
+      for( int m = 0; m < m_running.size(); ++m )
+      {
+         metadata.push_back( m_running.at(m).ToMetadata() );
+      }
+      return metadata;
+   }
+
+   void AttributeCursor::Close()
+   {
+      m_bOpen = false;
+      m_store = DataBuffer();
+      m_rows.clear();
+      m_query.finish();
+      m_query = QSqlQuery();
+   }
+
+   // ==========================================================================
+   // ==========================================================================
+   void AttributeCursor::NextColumns( Data::Buffer& block )
+   {
+      // The rows of the block are found first so the columns are copied 
+      // one after the other.
+      m_block.resize( 0 );
+      while( m_nNext < m_nEnd && m_block.size() < m_nBlockRows )
+      {
+         if( m_rows.empty() )
+         {
+            m_block.push_back( m_nNext );
+            m_nNext += m_nStride;
+         }
+         else
+         {
+            m_block.push_back( m_rows.at(m_nNext++) );
+         }
+      }
+
+      int nRows = m_block.size();
+      for( int n = 0; n < nRows; ++n )
+      {
+         double time = qQNaN();
+         if( m_nTime >= 0 )
+         {
+            time = m_store.numeric.at(m_nTime).at( m_block.at(n) );
+         }
+         // Convert hours to the 100 microsecond increments.
+         block._times.push_back( qIsNaN(time) ? 0 : time * HoursTo100MicroSeconds );
+      }
+
+      for( int m = 0; m < m_columns.size(); ++m )
+      {
+         int i = m_columns.at(m);
+         QVector<double>& values = block._values[m];
+         values.resize( nRows );
+         if( m_store.columns.at(i).eParamType == ParamType_String )
+         {
+            // Strings are converted the same as when they're read from the
+            // database.
+            const QStringList& text = m_store.text.at(i);
+            for( int n = 0; n < nRows; ++n )
+            {
+               bool bSuccess = false;
+               double value = QVariant(text.at( m_block.at(n) )).toDouble(&bSuccess);
+               values[n] = bSuccess ? value : qQNaN();
+            }
+         }
+         else
+         {
+            const NumericColumn& numeric = m_store.numeric.at(i);
+            for( int n = 0; n < nRows; ++n )
+            {
+               values[n] = numeric.at( m_block.at(n) );
+            }
+         }
+
+         // Update the running statistics.
+         if( m_stored.empty() )
+         {
+            const double* pValues = values.constData();
+            for( int n = 0; n < nRows; ++n )
+            {
+               m_running[m].Add( pValues[n] );
+            }
+         }
+      }
+
+      // The columns are released as soon as they're read.
+      if( m_nNext >= m_nEnd )
+      {
+         Close();
+      }
+   }
+
+   void AttributeCursor::NextQuery( Data::Buffer& block )
+   {
+      bool bSuccess = false;
+      while( block.RowCount() < m_nBlockRows )
+      {
+         if( !m_query.next() )
+         {
+            // The statement is finished so it no longer holds the database.
+            Close();
+            break;
+         }
+         if( m_nQueryRow++ % m_nStride != 0 )
+         {
+            continue;
+         }
+
+         QSqlRecord rec = m_query.record();
+
+         // The first record should always be time.
+         QSqlField field = rec.field(0);
+         double time = field.value().toDouble(&bSuccess);
+         //! @todo Time conversion might be better as a process into
+         //!       database vs. coming out but at least it's all
+         //!       abstracted behind this class.
+         // Convert hours to the 100 microsecond increments.
+         int nRow = block.AppendRow( bSuccess ? time * HoursTo100MicroSeconds : 0 );
+
+         for( int i = 1; i < rec.count(); ++i )
+         {
+            int m = i-1;
+            field = rec.field(i);
+
+            // Extract the data value, a NULL is left missing.
+            double value = field.value().toDouble(&bSuccess);
+            if( bSuccess )
+            {
+               block.SetValue( nRow, m, value );
+            }
+
+            // Update the running statistics.
+            if( m_stored.empty() )
+            {
+               m_running[m].Add( bSuccess ? value : qQNaN() );
+            }
+         }
+      }
+   }
+};
@@ -0,0 +1,108 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _ATTRIBUTECURSOR_H_
+#define _ATTRIBUTECURSOR_H_
+
+#include <QList>
+#include <QVector>
+#include <QSqlQuery>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   class DataMgmt;
+
+
+   //! Reads the attributes of a flight a block of rows at a time so that the
+   //! rows can be processed as they're read.  Only a block is held at once,
+   //! however long the flight.  A cursor is opened by DataMgmt::OpenCursor()
+   //! and reads the flight's columns or table the same as 
+   //! DataMgmt::GetDataAttributes() does.
+   //!
+   //! A cursor reading a table keeps a statement open on the database until
+   //! every row is read or it is closed, so it should be read through 
+   //! rather than kept.
+   class AttributeCursor
+   {
+   public:
+      //! Default number of rows in a block.
+      static const int nDefaultBlockRows;
+
+      AttributeCursor();
+      ~AttributeCursor();
+
+      //! Returns true if the cursor has been opened and not closed.
+      bool IsOpen() const;
+
+      //! Reads the next block of rows.
+      //! @param block  Receives the rows of the block in place of the ones it
+      //!               held, along with the statistics, see GetMetadata().
+      //! @retval true  If the block holds at least one row
+      //! @retval false Once every row has been read
+      bool Next( Data::Buffer& block );
+
+      //! Returns the number of rows read so far.
+      int GetRowCount() const;
+
+      //! Returns the statistics of the attributes.  Those of a completed 
+      //! flight are known when the cursor is opened on all of its rows, 
+      //! otherwise they cover the rows read so far.
+      QList<Metadata> GetMetadata() const;
+
+      //! Releases the rows and the statement of the flight.
+      void Close();
+
+   private:
+      friend class DataMgmt;
+
+      // Cursors hold a statement so they aren't copied.
+      AttributeCursor( const AttributeCursor& );
+      AttributeCursor& operator=( const AttributeCursor& );
+
+      //! Adds the next block of rows held in columns.
+      void NextColumns( Data::Buffer& block );
+
+      //! Adds the next block of rows read from the table.
+      void NextQuery( Data::Buffer& block );
+
+      bool            m_bOpen;      //!< Flag indicating the cursor is open
+      int             m_nBlockRows; //!< Most rows in a block
+      int             m_nRead;      //!< Number of rows read so far
+      QList<Metadata> m_stored;     //!< Statistics gathered as the flight loaded, if any
+      QVector<RunningStatistics> m_running; //!< Statistics of the rows read, if none are stored
+
+      // Flights held in columns.
+      bool            m_bColumns;   //!< Flag indicating the rows are read from m_store
+      DataBuffer      m_store;      //!< Columns of the flight
+      QVector<int>    m_columns;    //!< Column of each attribute
+      int             m_nTime;      //!< Column of the time, -1 if there is none
+      QVector<int>    m_rows;       //!< Rows to read in order, if not every m_nStride-th one
+      QVector<int>    m_block;      //!< Rows of the block being read
+      int             m_nNext;      //!< Next row, or position in m_rows, to read
+      int             m_nEnd;       //!< Row, or position in m_rows, reading ends before
+      int             m_nStride;    //!< Only every m_nStride-th row is read
+
+      // Flights read from their table.
+      QSqlQuery       m_query;      //!< Statement reading the table
+      int             m_nQueryRow;  //!< Number of rows the statement has returned
+   };
+};
+
+#endif // _ATTRIBUTECURSOR_H_
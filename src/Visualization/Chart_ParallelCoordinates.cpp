@@ -33,8 +33,8 @@
 
 #include <QPainter>
 #include <QPixmap>
+#include <qnumeric.h>
 
-#include "DataNormalizer.h"
 
 #include "Chart_ParallelCoordinates.h"
 
@@ -60,16 +60,13 @@ namespace Chart
 
       if( m_selections )
       {
-
-         Data::Normalizer normalize;
-
-         // Retrieve and process the data.
-         m_selections->GetDataAttributes( m_data );
+         // Retrieve the data, normalized and likely kept from an earlier 
+         // query of the same selections.
+         m_selections->GetDataAttributes( m_data, true );
 
          Data::FlightDatabase::iterator i;
          for( i = m_data.begin() ; i != m_data.end(); ++i )
          {
-            normalize.Process( i.value() );
             m_nNumAttrs += i.value()._metadata.size();
             if( i.value()._metadata.size() < 2 )
             {
@@ -139,25 +136,27 @@ namespace Chart
                int yoffset = nLineLength*(nFlightNum+1);
                int xIncrements = 0;
                int yIncrements = 0;
-               bool success = false;
-               for( int g =  0; g < i.value()._params.size(); g+=10 )
+               const Data::Buffer& data = i.value();
+               int nRows = data.RowCount();
+               int nColumns = qMin( nAttr, data.AttributeCount() );
+               for( int g =  0; g < nRows; g+=10 )
                {
                   int pt = 0;
                   int x = xoffset;
                   int y = 0;
 
-                  for( int j = 0; j < i.value()._params[g]._dataVector.size(); ++j )
+                  for( int j = 0; j < nColumns; ++j )
                   {
-                     const qreal& data = i.value()._params[g]._dataVector[j].toDouble(&success);
-
-                     y = data * nLineLength;
+                     // A missing value is drawn at the bottom of its axis.
+                     qreal value = data.Value( g, j );
+                     y = qIsNaN(value) ? 0 : value * nLineLength;
                      points[pt].setX(x);
                      points[pt].setY(yoffset-y);
                      pt++;
                      x += nLineSpacing;
                   }
 
-                  painter.drawPolyline(points, nAttr);
+                  painter.drawPolyline(points, pt);
                }
 
                // Draw the actual parallel coordinates last so they are visible on top.
@@ -16,14 +16,23 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <iostream>
+#include <cstring>
 
 #include <QPixmap>
 #include <QFile>
-#include <QTextStream>
 #include <QRegExp>
 #include <QVariant>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include <QThreadPool>
+#include <QEventLoop>
+#include <QFileSystemWatcher>
+#include <QTimer>
 
 #include "DataMgmt.h"
+#include "FlightCache.h"
+#include "CsvTokenizer.h"
+#include "GzipReader.h"
 #include "CsvParser.h"
 
 using namespace std;
@@ -34,7 +43,11 @@ namespace Parser
       : m_dataMgmt(0)
       , m_cDelim(',')
       , m_bStop(false)
+      , m_bCommitted(false)
       , m_bHasHeader(true)
+      , m_bParallel(false)
+      , m_bFollow(false)
+      , m_bReuse(false)
    {
    }
 
@@ -67,8 +80,48 @@ namespace Parser
       return m_sFlightName;
    }
 
+   bool CsvParser::FlightCommitted() const
+   {
+      return m_bCommitted;
+   }
+
+   void CsvParser::SetParallel( bool bParallel )
+   {
+      m_mutex.lock();
+      m_bParallel = bParallel;
+      m_mutex.unlock();
+   }
+
+   void CsvParser::SetFollow( bool bFollow )
+   {
+      m_mutex.lock();
+      m_bFollow = bFollow;
+      m_mutex.unlock();
+   }
+
+   void CsvParser::SetReuse( bool bReuse )
+   {
+      m_mutex.lock();
+      m_bReuse = bReuse;
+      m_mutex.unlock();
+   }
+
    const int nProgressIncrements = 100;
+
+   // Interval at which a followed file is checked for appended rows in case
+   // the file system doesn't report the change.
+   const int nFollowPollMsec = 250;
+
+   // Approximate number of bytes parsed by each worker when a file is parsed
+   // in parallel.  Chunks are extended to the end of the row they split.
+   const qint64 llChunkSize = 8*1024*1024;
+
    void CsvParser::run()
+   {
+      Parse();
+   }
+
+   void CsvParser::Parse()
    {
       if( !m_dataMgmt )
       {
@@ -77,82 +130,551 @@ namespace Parser
          return;
       }
 
+      // A flight loaded before is used from the database, or else read back
+      // from its cache, instead.
+      if( m_bReuse && LoadStored() )
+      {
+         return;
+      }
+
+      // Compressed files are streamed rather than mapped.
+      if( GzipReader::IsCompressed( m_sFilename ) )
+      {
+         ParseCompressed();
+         return;
+      }
+
       QFile file( m_sFilename );
-      if( file.open( QIODevice::ReadOnly ) )
-      {
-         QStringList tokens;
-
-         QTextStream stream(&file);
-         QString line = stream.readLine();
-
-         // Setup the progress indication.
-         qint64 llFileSize = file.size();
-         qint64 llFilePos = stream.pos();
-         qint64 llFileInc = llFileSize/nProgressIncrements;
-         int    nLastProg = 0;
-         emit( setProgressRange(0, nProgressIncrements) );
-         emit( setCurrentProgress(0) );
-
-         // Process header information.
-         //! @todo The algorithm currently requires header information.  This
-         //!       isn't specifically required because we could just make up 
-         //!       names for the parameters or add the ability to hand in the
-         //!       definition data through the API.
-         if( m_bHasHeader && !line.isNull() )
-         {
-            QStringList hdrTokens;
-            QString header = line;
-            if( ExtractTokens(header, hdrTokens) )
-            {
-               line = stream.readLine();
-               if( !line.isNull() && ExtractTokens( line, tokens ) )
-               {
-                  if( !m_dataMgmt->ProcessHeader( m_sFlightName, hdrTokens, tokens ) )
-                  {
-                     cerr << qPrintable(tr("Error extracting header information.")) << endl;
-                     emit( fileDoneStatus(false, m_sFilename) );
-                     return;
-                  }
-               }
-            }
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         cerr << qPrintable(tr("CsvParser: Unable to open ")) 
+            << qPrintable(m_sFilename) << endl;
+         emit( fileDoneStatus(false, m_sFilename) );
+         return;
+      }
+
+      // Map the file into memory so that each field can be referenced in 
+      // place rather than copied into a string.  If the file cannot be 
+      // mapped, e.g. it isn't a regular file, it is read into memory instead.
+      qint64      llFileSize = file.size();
+      QByteArray  contents;
+      const char* pBegin = 0;
+      if( llFileSize > 0 )
+      {
+         uchar* pMap = file.map( 0, llFileSize );
+         if( pMap )
+         {
+            pBegin = reinterpret_cast<const char*>(pMap);
+         }
+         else
+         {
+            contents   = file.readAll();
+            pBegin     = contents.constData();
+            llFileSize = contents.size();
          }
+      }
 
-         // Read in the rest of the file.
-         while( !line.isNull() )
+      // A file being followed may end partway through a line that is still
+      // being written.  That line is left for Follow().
+      if( m_bFollow )
+      {
+         while( llFileSize > 0 && pBegin[llFileSize-1] != '\n' )
          {
-            // Extract tokens from the current line.
-            ExtractTokens( line, tokens );
+            --llFileSize;
+         }
+      }
+
+      CsvTokenizer tokenizer( m_cDelim.toLatin1() );
+      tokenizer.SetData( pBegin, pBegin+llFileSize );
+
+      // Two rows are used so that the next row can be read ahead of 
+      // processing the current one in order to flag the last buffer.
+      Data::RowSpans rows[2];
+      int  nCur = 0;
+      bool bHaveRow = tokenizer.NextRow( rows[nCur] );
 
-            // Update progress.
-            if( (llFilePos - (llFileInc*nLastProg)) > llFileInc )
+      // Setup the progress indication.
+      int nLastProg = 0;
+      emit( setProgressRange(0, nProgressIncrements) );
+      emit( setCurrentProgress(0) );
+
+      // Process header information.
+      //! @todo The algorithm currently requires header information.  This
+      //!       isn't specifically required because we could just make up 
+      //!       names for the parameters or add the ability to hand in the
+      //!       definition data through the API.
+      bool bHeader = false;
+      if( m_bHasHeader && bHaveRow )
+      {
+         bHaveRow = tokenizer.NextRow( rows[1-nCur] );
+         bHeader  = bHaveRow;
+         if( bHaveRow )
+         {
+            QVector<Data::RowSpans> samples;
+            SampleRows( rows[1-nCur], pBegin+tokenizer.Position(), pBegin+llFileSize, samples );
+            if( !m_dataMgmt->ProcessHeader( m_sFlightName, rows[nCur], samples ) )
             {
-               // Calculate a progress increment
-               ++nLastProg;
-               emit( setCurrentProgress(nLastProg) );
+               cerr << qPrintable(tr("Error extracting header information.")) << endl;
+               emit( fileDoneStatus(false, m_sFilename) );
+               return;
             }
+         }
+         nCur = 1-nCur;
+      }
+
+      // Large files are split into chunks and parsed in parallel.  The first
+      // data row has already been read so it is processed ahead of the 
+      // chunks.
+      if( m_bParallel && bHaveRow && 
+          llFileSize - tokenizer.Position() >= 2*llChunkSize )
+      {
+         m_dataMgmt->ProcessData( m_sFlightName, rows[nCur], m_buffer );
+         ParseChunks( pBegin, tokenizer.Position(), llFileSize );
+         bHaveRow = false;
+      }
+
+      // Read in the rest of the file.
+      while( bHaveRow && !m_bStop )
+      {
+         // Update progress.
+         int nProg = static_cast<int>( 
+            (tokenizer.Position()*nProgressIncrements) / llFileSize );
+         if( nProg > nLastProg )
+         {
+            nLastProg = nProg;
+            emit( setCurrentProgress(nLastProg) );
+         }
 
-            // Try to get the next line in order to determine if this is the 
-            // last line in the file
-            line = stream.readLine();
-            llFilePos += line.length();
-            m_buffer.bLastBuffer = line.isNull();
+         // Try to get the next row in order to determine if this is the 
+         // last row in the file
+         bHaveRow = tokenizer.NextRow( rows[1-nCur] );
+         m_buffer.bLastBuffer = !bHaveRow;
+
+         // Process the current data
+         m_dataMgmt->ProcessData( m_sFlightName, rows[nCur], m_buffer );
+         nCur = 1-nCur;
+      }
 
-            // Process the current data
-            m_dataMgmt->ProcessData( m_sFlightName, tokens, m_buffer );
+      // A stopped parse leaves the flight incomplete.  The rows that were 
+      // not committed are dropped.
+      if( m_bStop )
+      {
+         m_buffer.Clear();
+         if( bHeader )
+         {
+            m_dataMgmt->AbortFlight( m_sFlightName );
          }
+         emit( fileDoneStatus(false, m_sFilename) );
+         return;
       }
 
       // Complete the data storage process.
-      if( m_buffer.data.size() )
+      if( m_buffer.data.size() || m_buffer.nRows )
       {
          m_buffer.bLastBuffer = true;
          m_dataMgmt->Commit(m_buffer);
       }
 
+      // The last row may have filled a buffer that was committed with it.
+      m_bCommitted = m_buffer.bLastBuffer;
+
       // The file is done loading indicate 100% progress and notify the application
       // that the parsing is complete.
       emit( setCurrentProgress(nProgressIncrements) );
       emit( fileDoneStatus(true, m_sFilename) );
+
+      // Pick up rows as they're appended.  If there weren't enough rows for
+      // the header the file is parsed again from the start.
+      if( m_bFollow )
+      {
+         Follow( file, bHeader ? llFileSize : 0, bHeader );
+      }
+   }
+
+   bool CsvParser::LoadStored()
+   {
+      bool bLoaded = m_dataMgmt->LoadCatalog( m_sFilename, m_sFlightName );
+      if( !bLoaded )
+      {
+         QString sCacheFile = Data::FlightCache::CacheFile( m_sFilename );
+         if( sCacheFile.isEmpty() )
+         {
+            return false;
+         }
+
+         bLoaded = QFile::exists( sCacheFile ) && 
+            m_dataMgmt->LoadCache( sCacheFile, m_sFlightName );
+         if( !bLoaded )
+         {
+            // The flight is written to its cache once it's parsed.
+            emit( cacheMissed(m_sFlightName, sCacheFile) );
+            return false;
+         }
+      }
+
+      // The stored flight completes the same as a parsed one.
+      m_bCommitted = true;
+      emit( setProgressRange(0, nProgressIncrements) );
+      emit( setCurrentProgress(nProgressIncrements) );
+      emit( fileDoneStatus(true, m_sFilename) );
+      return true;
+   }
+
+   void CsvParser::ParseCompressed()
+   {
+      GzipReader reader;
+      if( !reader.Open( m_sFilename ) )
+      {
+         cerr << qPrintable(tr("CsvParser: Unable to open ")) 
+            << qPrintable(m_sFilename) << endl;
+         emit( fileDoneStatus(false, m_sFilename) );
+         return;
+      }
+      if( m_bFollow )
+      {
+         cerr << qPrintable(tr("CsvParser: Compressed files cannot be followed, loading ")) 
+            << qPrintable(m_sFilename) << endl;
+      }
+      qint64 llCompressedSize = qMax<qint64>( reader.CompressedSize(), 1 );
+      reader.start();
+
+      // Setup the progress indication.
+      int nLastProg = 0;
+      emit( setProgressRange(0, nProgressIncrements) );
+      emit( setCurrentProgress(0) );
+
+      CsvTokenizer        tokenizer( m_cDelim.toLatin1() );
+      Data::RowSpans      hdr, row;
+      Data::ColumnDefList defList;
+      QByteArray          pending, block;
+      qint64              llCompressed = 0;
+      bool                bHeader  = false;
+      bool                bSuccess = true;
+      bool                bEnd     = false;
+      while( !m_bStop && !bEnd )
+      {
+         bEnd = !reader.NextBlock( block, llCompressed );
+         pending += block;
+         block.clear();
+
+         // A line split between blocks waits for the rest of it, except at
+         // the end of the file where the last line may not have a newline.
+         int nLength = bEnd ? pending.size() : pending.lastIndexOf('\n') + 1;
+         if( nLength == 0 )
+         {
+            continue;
+         }
+         tokenizer.SetData( pending.constData(), pending.constData()+nLength );
+
+         // Wait for the header and a first row of data to define the columns.
+         if( !bHeader )
+         {
+            if( !tokenizer.NextRow( hdr ) )
+            {
+               pending.remove( 0, nLength );
+               continue;
+            }
+            if( !tokenizer.NextRow( row ) )
+            {
+               continue;
+            }
+            // Only the rows already read are sampled rather than holding
+            // up the first rows for more of the file.
+            QVector<Data::RowSpans> samples;
+            SampleRows( row, pending.constData()+tokenizer.Position(), 
+               pending.constData()+nLength, samples );
+            if( !m_dataMgmt->ProcessHeader( m_sFlightName, hdr, samples ) )
+            {
+               cerr << qPrintable(tr("Error extracting header information.")) << endl;
+               bSuccess = false;
+               break;
+            }
+            bHeader = true;
+            defList = m_dataMgmt->GetColumnDefinitions( m_sFlightName );
+            Data::DataMgmt::AppendData( defList, row, m_buffer );
+         }
+
+         // A full buffer is committed before the next row is added so the 
+         // last buffer of the flight always has rows to flag.
+         while( tokenizer.NextRow( row ) )
+         {
+            if( m_buffer.nRows > Data::DataMgmt::nTransactionSwitch )
+            {
+               m_dataMgmt->Commit( m_buffer );
+            }
+            Data::DataMgmt::AppendData( defList, row, m_buffer );
+         }
+         pending = pending.mid( nLength );
+
+         // Update progress.
+         int nProg = static_cast<int>( 
+            (llCompressed*nProgressIncrements) / llCompressedSize );
+         if( nProg > nLastProg )
+         {
+            nLastProg = nProg;
+            emit( setCurrentProgress(nLastProg) );
+         }
+      }
+
+      reader.Stop();
+      reader.wait();
+      if( reader.HasError() )
+      {
+         cerr << qPrintable(tr("CsvParser: Unable to decompress all of ")) 
+            << qPrintable(m_sFilename) << endl;
+         bSuccess = false;
+      }
+
+      // A stopped parse leaves the flight incomplete.
+      if( m_bStop )
+      {
+         m_buffer.Clear();
+         if( bHeader )
+         {
+            m_dataMgmt->AbortFlight( m_sFlightName );
+         }
+         emit( fileDoneStatus(false, m_sFilename) );
+         return;
+      }
+
+      // Complete the data storage process with the rows that were read.
+      if( m_buffer.nRows )
+      {
+         m_buffer.bLastBuffer = true;
+         m_dataMgmt->Commit(m_buffer);
+         m_bCommitted = true;
+      }
+
+      emit( setCurrentProgress(nProgressIncrements) );
+      emit( fileDoneStatus(bSuccess && bHeader, m_sFilename) );
+   }
+
+   void CsvParser::Follow( QFile& file, qint64 llOffset, bool bHeader )
+   {
+      // The watcher reports changes through inotify where it's available.
+      // The timer polls for changes it misses and checks for a stop.
+      QEventLoop         loop;
+      QTimer             timer;
+      QFileSystemWatcher watcher;
+      watcher.addPath( m_sFilename );
+      connect( &watcher, SIGNAL(fileChanged(QString)), &loop, SLOT(quit()) );
+      connect( &timer,   SIGNAL(timeout()),            &loop, SLOT(quit()) );
+      timer.start( nFollowPollMsec );
+
+      // The flight completes with the first rows committed.
+      bool bComplete = bHeader;
+
+      CsvTokenizer        tokenizer( m_cDelim.toLatin1() );
+      Data::RowSpans      hdr, row;
+      Data::ColumnDefList defList = m_dataMgmt->GetColumnDefinitions( m_sFlightName );
+      QByteArray          pending;
+      while( !m_bStop )
+      {
+         loop.exec();
+
+         // A file that is replaced drops out of the watch.
+         if( watcher.files().isEmpty() && QFile::exists(m_sFilename) )
+         {
+            watcher.addPath( m_sFilename );
+         }
+
+         qint64 llSize = file.size();
+         if( llSize < llOffset )
+         {
+            cerr << qPrintable(tr("CsvParser: Stopped following truncated file ")) 
+               << qPrintable(m_sFilename) << endl;
+            break;
+         }
+         if( llSize == llOffset || !file.seek(llOffset) )
+         {
+            continue;
+         }
+         QByteArray appended = file.read( llSize-llOffset );
+         llOffset += appended.size();
+         pending  += appended;
+
+         // Only parse up through the last complete line.
+         int nLength = pending.lastIndexOf('\n') + 1;
+         if( nLength == 0 )
+         {
+            continue;
+         }
+         tokenizer.SetData( pending.constData(), pending.constData()+nLength );
+
+         // Wait for the header and a first row of data to define the columns.
+         if( !bHeader )
+         {
+            if( !tokenizer.NextRow( hdr ) )
+            {
+               pending.remove( 0, nLength );
+               continue;
+            }
+            if( !tokenizer.NextRow( row ) )
+            {
+               continue;
+            }
+            // Only the rows already read are sampled rather than holding
+            // up the first rows for more of the file.
+            QVector<Data::RowSpans> samples;
+            SampleRows( row, pending.constData()+tokenizer.Position(), 
+               pending.constData()+nLength, samples );
+            if( !m_dataMgmt->ProcessHeader( m_sFlightName, hdr, samples ) )
+            {
+               cerr << qPrintable(tr("Error extracting header information.")) << endl;
+               break;
+            }
+            bHeader = true;
+            defList = m_dataMgmt->GetColumnDefinitions( m_sFlightName );
+            Data::DataMgmt::AppendData( defList, row, m_buffer );
+         }
+
+         // Commit as each batch is parsed so the rows show up promptly.
+         while( tokenizer.NextRow( row ) )
+         {
+            Data::DataMgmt::AppendData( defList, row, m_buffer );
+         }
+         pending.remove( 0, nLength );
+
+         if( m_buffer.nRows > 0 )
+         {
+            m_buffer.bLastBuffer = !bComplete;
+            bComplete = true;
+            m_dataMgmt->Commit( m_buffer );
+            m_bCommitted = true;
+         }
+      }
+   }
+
+   void CsvParser::ParseChunks( const char* pData, qint64 llBegin, qint64 llFileSize )
+   {
+      // Split the file at the first newline past each chunk size.  A row 
+      // always ends at a newline, even within quotes, so every chunk starts 
+      // on a row regardless of where the quotes fall.
+      QList<Chunk> chunks;
+      const char* p    = pData + llBegin;
+      const char* pEnd = pData + llFileSize;
+      while( p < pEnd )
+      {
+         Chunk chunk;
+         chunk.pBegin = p;
+         chunk.pEnd   = pEnd;
+         if( pEnd - p > llChunkSize )
+         {
+            const char* pSplit = p + llChunkSize;
+            const char* pEol = static_cast<const char*>( memchr(pSplit, '\n', pEnd-pSplit) );
+            if( pEol )
+            {
+               chunk.pEnd = pEol+1;
+            }
+         }
+         chunks.append( chunk );
+         p = chunk.pEnd;
+      }
+
+      // Every worker uses its own copy of the column definitions.  Only as
+      // many chunks as the pool has threads are parsed ahead of the one 
+      // being stitched, so the parsed rows held at once stay bounded 
+      // however large the file is.
+      Data::ColumnDefList defList = m_dataMgmt->GetColumnDefinitions( m_sFlightName );
+      int nMaxInFlight = qMax( 1, QThreadPool::globalInstance()->maxThreadCount() );
+      QList< QFuture<void> > futures;
+      while( futures.size() < chunks.size() && futures.size() < nMaxInFlight )
+      {
+         futures.append( QtConcurrent::run( 
+            this, &CsvParser::ParseChunk, &chunks[futures.size()], defList ) );
+      }
+
+      // Stitch the chunks back together in file order, starting the next 
+      // chunk as each one is stitched.  Each buffer is committed once the 
+      // next is available so the last one is left for the caller to flag as
+      // the end of the flight.  Once stopped, the workers finish early, no
+      // more chunks start and nothing more is committed.
+      int nLastProg = 0;
+      for( int i = 0; i < futures.size(); ++i )
+      {
+         futures[i].waitForFinished();
+
+         Chunk& chunk = chunks[i];
+         for( int b = 0; b < chunk.buffers.size(); ++b )
+         {
+            if( !m_bStop )
+            {
+               if( m_buffer.nRows > 0 )
+               {
+                  m_dataMgmt->Commit( m_buffer );
+               }
+               m_buffer.Swap( chunk.buffers[b] );
+            }
+
+            // Buffers dropped by a stop go back to the pool as well.
+            m_dataMgmt->ReleaseBuffer( chunk.buffers[b] );
+         }
+         chunk.buffers.clear();
+
+         if( !m_bStop && futures.size() < chunks.size() )
+         {
+            futures.append( QtConcurrent::run( 
+               this, &CsvParser::ParseChunk, &chunks[futures.size()], defList ) );
+         }
+
+         int nProg = static_cast<int>( 
+            ((chunk.pEnd-pData)*nProgressIncrements) / llFileSize );
+         if( nProg > nLastProg )
+         {
+            nLastProg = nProg;
+            emit( setCurrentProgress(nLastProg) );
+         }
+      }
+   }
+
+   void CsvParser::ParseChunk( Chunk* pChunk, const Data::ColumnDefList& defList )
+   {
+      CsvTokenizer tokenizer( m_cDelim.toLatin1() );
+      tokenizer.SetData( pChunk->pBegin, pChunk->pEnd );
+
+      Data::RowSpans   row;
+      Data::DataBuffer buffer;
+      m_dataMgmt->AcquireBuffer( buffer );
+      buffer.sFlightName = m_sFlightName;
+      while( !m_bStop && tokenizer.NextRow( row ) )
+      {
+         if( Data::DataMgmt::AppendData( defList, row, buffer ) &&
+             buffer.nRows > Data::DataMgmt::nTransactionSwitch )
+         {
+            pChunk->buffers.append( Data::DataBuffer() );
+            pChunk->buffers.last().Swap( buffer );
+            m_dataMgmt->AcquireBuffer( buffer );
+            buffer.sFlightName = m_sFlightName;
+         }
+      }
+
+      if( buffer.nRows > 0 )
+      {
+         pChunk->buffers.append( Data::DataBuffer() );
+         pChunk->buffers.last().Swap( buffer );
+      }
+      else
+      {
+         m_dataMgmt->ReleaseBuffer( buffer );
+      }
+   }
+
+   void CsvParser::SampleRows( 
+      const Data::RowSpans& first,
+      const char* pBegin,
+      const char* pEnd,
+      QVector<Data::RowSpans>& samples ) const
+   {
+      samples.clear();
+      samples.append( first );
+
+      CsvTokenizer   tokenizer( m_cDelim.toLatin1() );
+      Data::RowSpans row;
+      tokenizer.SetData( pBegin, pEnd );
+      while( samples.size() < Data::DataMgmt::nTypeSampleRows && tokenizer.NextRow( row ) )
+      {
+         samples.append( row );
+      }
    }
 
    void CsvParser::stopParse()
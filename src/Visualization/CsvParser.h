@@ -20,9 +20,13 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QList>
+#include <QVector>
 
 #include "DataTypes.h"
 
+class QFile;
+
 // Forward declaration to minimize include dependence.
 namespace Data
 {
@@ -57,8 +61,41 @@ namespace Parser
       //! @retval "Flight Name"  sFlightName parameter from the last SetParseInformation
       const QString& GetFlightName() const;
 
+      //! Enables splitting a large file into chunks that are parsed in 
+      //! parallel on the global thread pool.  The rows are still committed
+      //! in file order.  Files too small to split are parsed serially.
+      //! @param bParallel  True to parse chunks in parallel
+      void SetParallel( bool bParallel );
+
+      //! Enables following a file that is still being written.  Once the 
+      //! existing rows are parsed the flight completes as usual and the file
+      //! is watched for appended rows, which are committed in small batches
+      //! as they arrive.  Parsing continues until stopParse() is called.
+      //! @param bFollow  True to follow the file
+      void SetFollow( bool bFollow );
+
+      //! Enables using the flight from the database catalog, or reading it
+      //! back from its cache file, see Data::FlightCache, rather than 
+      //! parsing it.  Either may read the whole file, so it's left to 
+      //! Parse().  A flight that is parsed reports its cache file through
+      //! cacheMissed().
+      //! @param bReuse  True to reuse a stored flight
+      void SetReuse( bool bReuse );
+
+      //! Parses the file on the calling thread, e.g. a worker of an 
+      //! IngestPool.  Returns once the file is parsed, or once it is no 
+      //! longer followed, or once parsing is stopped.
+      void Parse();
+
+      //! Indicates the last buffer of the flight was committed, after which
+      //! DataMgmt reports the flight complete.  A stopped parse never commits
+      //! it.
+      bool FlightCommitted() const;
+
    public slots:
-      //! Slot to handle an interrupt signal.  This will stop the file parsing.
+      //! Slot to handle an interrupt signal.  This will stop the file parsing,
+      //! even part of the way through the file.  The flight is left 
+      //! incomplete and fileDoneStatus() reports a failure.
       void stopParse();
 
    signals:
@@ -67,6 +104,12 @@ namespace Parser
       //! @param sFileName Provides the file that was parsed.
       void fileDoneStatus(bool bSuccess, QString sFileName);
 
+      //! Signal indicating the flight is parsed because it had no cache.  It
+      //! arrives ahead of the flight's completion.
+      //! @param sFlightName  Name of the flight
+      //! @param sCacheFile   Path of the cache file to write once it completes
+      void cacheMissed(QString sFlightName, QString sCacheFile);
+
 
       //! Emits the range of progress increments that will be reported during
       //! parsing of the file by setCurrentProgress() signal.
@@ -80,17 +123,73 @@ namespace Parser
       void setCurrentProgress(int value);
 
    protected:
-      //! The threaded functionality.
+      //! The threaded functionality, see Parse().
       void run();
 
       //! Pulls out the content of each field and places it as a single entry
       //! in the tokens.  This handles quoted strings as a single token.
+      //! The file itself is tokenized in place by CsvTokenizer; this is kept
+      //! for callers that only have a line of text.
       //! @param line    Input line of CSV values
       //! @param tokens  Processed list of values from the input line
       //! @retval  true  If the extraction was successful
       //! @retval  false Otherwise.
       bool ExtractTokens( const QString& line, QStringList& tokens );
 
+      //! Range of whole rows in the file parsed by a single worker.
+      struct Chunk
+      {
+         const char*             pBegin;  //!< First byte of the chunk
+         const char*             pEnd;    //!< One past the last byte of the chunk
+         QList<Data::DataBuffer> buffers; //!< Rows parsed from the chunk in order
+      };
+
+      //! Parses the data rows between llBegin and the end of the file in 
+      //! chunks on the global thread pool and commits them in order.  At
+      //! most one chunk per pool thread is parsed at a time.  The last 
+      //! buffer is left in m_buffer for the caller to commit.
+      //! @param pData       First byte of the file
+      //! @param llBegin     Offset of the first row to parse
+      //! @param llFileSize  Number of bytes in the file
+      void ParseChunks( const char* pData, qint64 llBegin, qint64 llFileSize );
+
+      //! Parses the rows of a single chunk into its buffers.
+      //! @param pChunk   Chunk to parse
+      //! @param defList  Column definitions of the flight
+      void ParseChunk( Chunk* pChunk, const Data::ColumnDefList& defList );
+
+      //! Parses a gzip compressed file as it is decompressed on another 
+      //! thread.  Progress is reported against the compressed bytes consumed.
+      //! Compressed files are neither split into chunks nor followed.
+      void ParseCompressed();
+
+      //! Watches the file for appended rows until parsing is stopped.  Only 
+      //! whole lines are parsed, a partially written line waits for the rest.
+      //! @param file      Open file being followed
+      //! @param llOffset  Offset of the first byte not yet parsed
+      //! @param bHeader   Whether the header has already been processed
+      void Follow( QFile& file, qint64 llOffset, bool bHeader );
+
+      //! Collects the rows ProcessHeader() works out the column types from.
+      //! The rows after the first are read from the block without consuming 
+      //! anything, so parsing carries on from the first row as before.
+      //! @param first    First row of data, already read
+      //! @param pBegin   First byte after the first row
+      //! @param pEnd     One past the last whole row available
+      //! @param samples  The first row followed by up to 
+      //!                 DataMgmt::nTypeSampleRows-1 more
+      void SampleRows( 
+         const Data::RowSpans& first,
+         const char* pBegin,
+         const char* pEnd,
+         QVector<Data::RowSpans>& samples ) const;
+
+      //! Uses the flight from the catalog, or else reads it back from its 
+      //! cache file, if either has it.
+      //! @retval true  If the flight was reused
+      //! @retval false If it must be parsed
+      bool LoadStored();
+
 
    private:
       QMutex              m_mutex;       //!< Mutex for thread safety
@@ -101,7 +200,11 @@ namespace Parser
       QString             m_sFlightName; //!< Name of the flight
       QChar               m_cDelim;      //!< Character matching the delimiter, e.g. ','
       bool                m_bStop;       //!< Flag indicating that parsing should stop
+      bool                m_bCommitted;  //!< Flag indicating the last buffer was committed
       bool                m_bHasHeader;  //!< Flag indicating whether the data has a header
+      bool                m_bParallel;   //!< Flag indicating chunks are parsed in parallel
+      bool                m_bFollow;     //!< Flag indicating the file is followed for appended rows
+      bool                m_bReuse;      //!< Flag indicating a stored copy of the flight may be used
    };
 };
 #endif // CSVPARSER_H
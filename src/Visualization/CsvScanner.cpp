@@ -0,0 +1,245 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+
+#include "CsvScanner.h"
+
+// The vector kernels are only available on x86 processors.  Other processors
+// use the scalar kernel.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define CSVSCANNER_X86
+#  include <emmintrin.h>
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#     include <intrin.h>
+#  endif
+#endif
+
+// GCC and Clang need to be told that a function may use instructions beyond
+// the ones enabled for the whole build.  Visual Studio always allows them.
+#if defined(CSVSCANNER_X86) && defined(__GNUC__)
+#  define CSVSCANNER_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define CSVSCANNER_TARGET(isa)
+#endif
+
+
+namespace Parser
+{
+   // ==========================================================================
+   // Kernels.  Each scans exactly CsvScanner::nBlockSize bytes.
+   // ==========================================================================
+   static quint64 ScanScalar( const char* pBlock, char cDelim )
+   {
+      quint64 uBits = 0;
+      for( int i = 0; i < CsvScanner::nBlockSize; ++i )
+      {
+         char c = pBlock[i];
+         if( c == cDelim || c == '\"' || c == '\n' )
+         {
+            uBits |= (Q_UINT64_C(1) << i);
+         }
+      }
+      return uBits;
+   }
+
+#  if defined(CSVSCANNER_X86)
+   CSVSCANNER_TARGET("sse2")
+   static quint64 ScanSse2( const char* pBlock, char cDelim )
+   {
+      const __m128i delim   = _mm_set1_epi8( cDelim );
+      const __m128i quote   = _mm_set1_epi8( '\"' );
+      const __m128i newline = _mm_set1_epi8( '\n' );
+
+      quint64 uBits = 0;
+      for( int i = 0; i < CsvScanner::nBlockSize; i += 16 )
+      {
+         __m128i data = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pBlock+i) );
+         __m128i hits = _mm_or_si128(
+            _mm_or_si128( _mm_cmpeq_epi8(data, delim), _mm_cmpeq_epi8(data, quote) ),
+            _mm_cmpeq_epi8(data, newline) );
+         uBits |= static_cast<quint64>(
+            static_cast<unsigned int>(_mm_movemask_epi8(hits)) ) << i;
+      }
+      return uBits;
+   }
+
+   CSVSCANNER_TARGET("avx2")
+   static quint64 ScanAvx2( const char* pBlock, char cDelim )
+   {
+      const __m256i delim   = _mm256_set1_epi8( cDelim );
+      const __m256i quote   = _mm256_set1_epi8( '\"' );
+      const __m256i newline = _mm256_set1_epi8( '\n' );
+
+      quint64 uBits = 0;
+      for( int i = 0; i < CsvScanner::nBlockSize; i += 32 )
+      {
+         __m256i data = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pBlock+i) );
+         __m256i hits = _mm256_or_si256(
+            _mm256_or_si256( _mm256_cmpeq_epi8(data, delim), _mm256_cmpeq_epi8(data, quote) ),
+            _mm256_cmpeq_epi8(data, newline) );
+         uBits |= static_cast<quint64>(
+            static_cast<unsigned int>(_mm256_movemask_epi8(hits)) ) << i;
+      }
+      return uBits;
+   }
+#  endif
+
+   // Queries the processor for AVX2 support, including the operating system
+   // saving the wider registers.
+   static bool HasAvx2()
+   {
+#  if defined(CSVSCANNER_X86) && defined(_MSC_VER)
+      int info[4];
+      __cpuid( info, 0 );
+      if( info[0] < 7 )
+      {
+         return false;
+      }
+      __cpuid( info, 1 );
+      const bool bOsXsave = (info[2] & (1 << 27)) != 0;
+      const bool bAvx     = (info[2] & (1 << 28)) != 0;
+      if( !bOsXsave || !bAvx || (_xgetbv(0) & 0x6) != 0x6 )
+      {
+         return false;
+      }
+      __cpuidex( info, 7, 0 );
+      return (info[1] & (1 << 5)) != 0;
+#  elif defined(CSVSCANNER_X86) && defined(__GNUC__)
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") != 0;
+#  else
+      return false;
+#  endif
+   }
+
+   static bool HasSse2()
+   {
+#  if defined(__x86_64__) || defined(_M_X64)
+      // SSE2 is part of the 64-bit instruction set.
+      return true;
+#  elif defined(CSVSCANNER_X86) && defined(_MSC_VER)
+      int info[4];
+      __cpuid( info, 1 );
+      return (info[3] & (1 << 26)) != 0;
+#  elif defined(CSVSCANNER_X86) && defined(__GNUC__)
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2") != 0;
+#  else
+      return false;
+#  endif
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   CsvScanner::CsvScanner( char cDelim )
+      : m_pfnScan(ScanScalar)
+      , m_eKernel(Kernel_Scalar)
+      , m_cDelim(cDelim)
+   {
+      SetKernel( BestKernel() );
+   }
+
+   void CsvScanner::SetKernel( Kernel eKernel )
+   {
+      if( !IsSupported(eKernel) )
+      {
+         eKernel = BestKernel();
+      }
+
+      m_eKernel = eKernel;
+      switch( eKernel )
+      {
+#  if defined(CSVSCANNER_X86)
+      case Kernel_Avx2:
+         m_pfnScan = ScanAvx2;
+         break;
+      case Kernel_Sse2:
+         m_pfnScan = ScanSse2;
+         break;
+#  endif
+      default:
+         m_eKernel = Kernel_Scalar;
+         m_pfnScan = ScanScalar;
+      }
+   }
+
+   CsvScanner::Kernel CsvScanner::GetKernel() const
+   {
+      return m_eKernel;
+   }
+
+   CsvScanner::Kernel CsvScanner::BestKernel()
+   {
+      // The processor doesn't change while running so only ask once.
+      static const Kernel eBest =
+         HasAvx2() ? Kernel_Avx2 : (HasSse2() ? Kernel_Sse2 : Kernel_Scalar);
+      return eBest;
+   }
+
+   bool CsvScanner::IsSupported( Kernel eKernel )
+   {
+      switch( eKernel )
+      {
+      case Kernel_Scalar:
+         return true;
+      case Kernel_Sse2:
+         return BestKernel() >= Kernel_Sse2;
+      case Kernel_Avx2:
+         return BestKernel() >= Kernel_Avx2;
+      default:
+         return false;
+      }
+   }
+
+   const char* CsvScanner::KernelName( Kernel eKernel )
+   {
+      switch( eKernel )
+      {
+      case Kernel_Scalar:
+         return "Scalar";
+      case Kernel_Sse2:
+         return "SSE2";
+      case Kernel_Avx2:
+         return "AVX2";
+      default:
+         return "Unknown";
+      }
+   }
+
+   quint64 CsvScanner::Scan( const char* pBlock, int nLength ) const
+   {
+      if( nLength >= nBlockSize )
+      {
+         return m_pfnScan( pBlock, m_cDelim );
+      }
+
+      // The end of the data is usually the end of a mapped file, so the
+      // kernel cannot read past it.  Scan a padded copy instead and drop
+      // the bits for the padding.
+      if( nLength <= 0 )
+      {
+         return 0;
+      }
+      char tail[nBlockSize];
+      memset( tail, 0, sizeof(tail) );
+      memcpy( tail, pBlock, nLength );
+      return m_pfnScan( tail, m_cDelim ) & ((Q_UINT64_C(1) << nLength) - 1);
+   }
+};
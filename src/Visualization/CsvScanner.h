@@ -0,0 +1,79 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CSVSCANNER_H
+#define CSVSCANNER_H
+
+#include <QtGlobal>
+
+
+namespace Parser
+{
+   //! Finds the structural characters of CSV text, i.e. the delimiter, quote
+   //! and newline, a block at a time.  The result is a bitmap per block where
+   //! bit n is set when byte n of the block is structural, which the
+   //! tokenizer walks instead of testing every byte.  The scan is vectorized
+   //! when the processor supports it and the kernel is chosen at run time.
+   class CsvScanner
+   {
+   public:
+      //! Number of bytes described by a single bitmap.
+      static const int nBlockSize = 64;
+
+      //! Enumeration of the available scanning implementations.
+      enum Kernel
+      {
+         Kernel_Scalar, //!< Portable byte at a time scan
+         Kernel_Sse2,   //!< 16 bytes per compare
+         Kernel_Avx2    //!< 32 bytes per compare
+      };
+
+      CsvScanner( char cDelim = ',' );
+
+      //! Selects the kernel to use.  Requesting a kernel the processor does
+      //! not support selects the best supported kernel instead.
+      void SetKernel( Kernel eKernel );
+
+      //! Returns the kernel currently in use.
+      Kernel GetKernel() const;
+
+      //! Returns the fastest kernel supported by this processor.
+      static Kernel BestKernel();
+
+      //! Indicates whether the processor supports the given kernel.
+      static bool IsSupported( Kernel eKernel );
+
+      //! Provides a readable name for the kernel, e.g. for reporting.
+      static const char* KernelName( Kernel eKernel );
+
+      //! Builds the structural bitmap for a block.
+      //! @param pBlock   First byte of the block
+      //! @param nLength  Number of bytes in the block, at most nBlockSize.
+      //!                 Bytes past nLength are never read.
+      //! @return Bitmap of the delimiter, quote and newline characters
+      quint64 Scan( const char* pBlock, int nLength ) const;
+
+   private:
+      //! Signature shared by the kernels.
+      typedef quint64 (*ScanFunction)( const char* pBlock, char cDelim );
+
+      ScanFunction m_pfnScan; //!< Kernel scanning a full block
+      Kernel       m_eKernel; //!< Kernel identifier
+      char         m_cDelim;  //!< Character matching the delimiter, e.g. ','
+   };
+};
+#endif // CSVSCANNER_H
@@ -0,0 +1,266 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#include "CsvTokenizer.h"
+
+
+namespace Parser
+{
+   // Number of fields reserved in a row up front.  Reserving keeps the
+   // capacity of the field list when it is reset for the next row so that
+   // steady state tokenizing does not allocate.
+   const int nReservedFields = 128;
+
+   // Builds the span for the field between nBegin and nEnd, applying the same
+   // trimming and quote rules as CsvParser::ExtractTokens.
+   static void MakeSpan(
+      const char* pLine,
+      int nBegin,
+      int nEnd,
+      bool bHasQuotes,
+      Data::FieldSpan& span )
+   {
+      // Trim whitespace from the leading edge of the field.
+      while( nBegin < nEnd && pLine[nBegin] == ' ' )
+      {
+         ++nBegin;
+      }
+
+      span.bQuoted = false;
+      if( bHasQuotes )
+      {
+         // The common case is a field wrapped in a single pair of quotes.
+         // That can still be referenced directly by dropping the quotes.
+         // Anything else is flagged so the quotes are removed when the field
+         // is converted.
+         if( nEnd - nBegin >= 2 &&
+             pLine[nBegin] == '\"' && pLine[nEnd-1] == '\"' &&
+             !memchr(pLine+nBegin+1, '\"', nEnd-nBegin-2) )
+         {
+            ++nBegin;
+            --nEnd;
+            while( nBegin < nEnd && pLine[nBegin] == ' ' )
+            {
+               ++nBegin;
+            }
+         }
+         else
+         {
+            span.bQuoted = true;
+         }
+      }
+
+      span.nOffset = nBegin;
+      span.nLength = nEnd - nBegin;
+   }
+
+
+   // Index of the lowest set bit.  The value must not be zero.
+   static inline int LowestBit( quint64 uBits )
+   {
+#  if defined(__GNUC__)
+      return __builtin_ctzll( uBits );
+#  elif defined(_MSC_VER) && defined(_M_X64)
+      unsigned long nIndex;
+      _BitScanForward64( &nIndex, uBits );
+      return static_cast<int>(nIndex);
+#  else
+      int nIndex = 0;
+      while( !(uBits & 1) )
+      {
+         uBits >>= 1;
+         ++nIndex;
+      }
+      return nIndex;
+#  endif
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   CsvTokenizer::CsvTokenizer( char cDelim )
+      : m_scanner(cDelim)
+      , m_pBegin(0)
+      , m_pCur(0)
+      , m_pEnd(0)
+      , m_llScan(-CsvScanner::nBlockSize)
+      , m_uBits(0)
+      , m_cDelim(cDelim)
+   {
+   }
+
+   void CsvTokenizer::SetData( const char* pBegin, const char* pEnd )
+   {
+      m_pBegin = pBegin;
+      m_pCur   = pBegin;
+      m_pEnd   = pEnd;
+      m_llScan = -CsvScanner::nBlockSize;
+      m_uBits  = 0;
+   }
+
+   void CsvTokenizer::SetKernel( CsvScanner::Kernel eKernel )
+   {
+      m_scanner.SetKernel( eKernel );
+   }
+
+   CsvScanner::Kernel CsvTokenizer::GetKernel() const
+   {
+      return m_scanner.GetKernel();
+   }
+
+   const char* CsvTokenizer::NextStructural()
+   {
+      while( !m_uBits )
+      {
+         m_llScan += CsvScanner::nBlockSize;
+         qint64 llRemaining = (m_pEnd-m_pBegin) - m_llScan;
+         if( llRemaining <= 0 )
+         {
+            return 0;
+         }
+         m_uBits = m_scanner.Scan( m_pBegin+m_llScan, 
+            static_cast<int>(qMin<qint64>(llRemaining, CsvScanner::nBlockSize)) );
+      }
+
+      int nBit = LowestBit( m_uBits );
+      m_uBits &= m_uBits-1;
+      return m_pBegin + m_llScan + nBit;
+   }
+
+   bool CsvTokenizer::NextRow( Data::RowSpans& row )
+   {
+      if( row.fields.capacity() < nReservedFields )
+      {
+         row.fields.reserve( nReservedFields );
+      }
+
+      Data::FieldSpan span;
+      while( m_pCur < m_pEnd )
+      {
+         const char* pLine = m_pCur;
+         const char* pEol  = m_pEnd;
+         row.fields.resize(0);
+         row.pBase = pLine;
+
+         // Walk the structural characters up to the end of the line.  The 
+         // quote and delimiter rules are the same as TokenizeLine.
+         bool bInQuotes  = false;
+         bool bHasQuotes = false;
+         int  nStart     = 0;
+         const char* p;
+         while( (p = NextStructural()) != 0 )
+         {
+            if( *p == '\n' )
+            {
+               pEol = p;
+               break;
+            }
+            else if( *p == '\"' )
+            {
+               bInQuotes  = !bInQuotes;
+               bHasQuotes = true;
+            }
+            else if( !bInQuotes )
+            {
+               int nEnd = static_cast<int>(p-pLine);
+               MakeSpan( pLine, nStart, nEnd, bHasQuotes, span );
+               row.fields.append( span );
+               nStart     = nEnd+1;
+               bHasQuotes = false;
+            }
+         }
+         m_pCur = (pEol < m_pEnd) ? pEol+1 : m_pEnd;
+
+         // Drop the carriage return of Windows line endings.
+         int nLength = static_cast<int>(pEol-pLine);
+         if( nLength > nStart && pLine[nLength-1] == '\r' )
+         {
+            --nLength;
+         }
+
+         // Make sure we got the last column.  Like ExtractTokens, an empty
+         // trailing field is not a column.
+         MakeSpan( pLine, nStart, nLength, bHasQuotes, span );
+         if( span.nLength > 0 )
+         {
+            row.fields.append( span );
+         }
+
+         // Blank lines do not produce a row.
+         if( row.size() > 0 )
+         {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   qint64 CsvTokenizer::Position() const
+   {
+      return m_pCur - m_pBegin;
+   }
+
+   void CsvTokenizer::TokenizeLine(
+      const char* pLine,
+      int nLength,
+      char cDelim,
+      Data::RowSpans& row )
+   {
+      if( row.fields.capacity() < nReservedFields )
+      {
+         row.fields.reserve( nReservedFields );
+      }
+      row.fields.resize(0);
+      row.pBase = pLine;
+
+      Data::FieldSpan span;
+      bool bInQuotes  = false;
+      bool bHasQuotes = false;
+      int  nStart     = 0;
+      for( int i = 0; i < nLength; ++i )
+      {
+         char c = pLine[i];
+         if( c == '\"' )
+         {
+            bInQuotes  = !bInQuotes;
+            bHasQuotes = true;
+         }
+         else if( !bInQuotes && c == cDelim )
+         {
+            MakeSpan( pLine, nStart, i, bHasQuotes, span );
+            row.fields.append( span );
+            nStart     = i+1;
+            bHasQuotes = false;
+         }
+      }
+
+      // Make sure we got the last column.  Like ExtractTokens, an empty
+      // trailing field is not a column.
+      MakeSpan( pLine, nStart, nLength, bHasQuotes, span );
+      if( span.nLength > 0 )
+      {
+         row.fields.append( span );
+      }
+   }
+};
@@ -0,0 +1,84 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CSVTOKENIZER_H
+#define CSVTOKENIZER_H
+
+#include "DataTypes.h"
+#include "CsvScanner.h"
+
+
+namespace Parser
+{
+   //! Splits a block of CSV text into rows of fields without copying any of
+   //! the text.  Each row is returned as spans into the block, so the block
+   //! must remain valid while the rows are in use.  A row ends at a newline
+   //! regardless of quoting, the same as reading the file a line at a time.
+   //! Field and row boundaries are found from the bitmaps of CsvScanner so
+   //! only the structural characters are visited.
+   class CsvTokenizer
+   {
+   public:
+      CsvTokenizer( char cDelim = ',' );
+
+      //! Sets the block of text to be tokenized and rewinds to its start.
+      //! @param pBegin  First byte of the block
+      //! @param pEnd    One past the last byte of the block
+      void SetData( const char* pBegin, const char* pEnd );
+
+      //! Extracts the next non-empty row from the block.
+      //! @param row  Fields of the row
+      //! @retval true  If a row was extracted
+      //! @retval false If the end of the block was reached
+      bool NextRow( Data::RowSpans& row );
+
+      //! Number of bytes of the block consumed so far.
+      qint64 Position() const;
+
+      //! Selects the scanning kernel, e.g. to compare implementations.
+      void SetKernel( CsvScanner::Kernel eKernel );
+
+      //! Returns the scanning kernel in use.
+      CsvScanner::Kernel GetKernel() const;
+
+      //! Splits a single line into fields.  This handles quoted strings as
+      //! a single field and trims leading whitespace from each field.
+      //! @param pLine    First byte of the line, without the line ending
+      //! @param nLength  Number of bytes in the line
+      //! @param cDelim   Field delimiter, e.g. ','
+      //! @param row      Fields of the line
+      static void TokenizeLine(
+         const char* pLine,
+         int nLength,
+         char cDelim,
+         Data::RowSpans& row );
+
+   private:
+      //! Returns the next structural character in the block or null at the 
+      //! end of the block.  Each character is returned once.
+      const char* NextStructural();
+
+      CsvScanner  m_scanner; //!< Finds the structural characters
+      const char* m_pBegin;  //!< Start of the block
+      const char* m_pCur;    //!< Next byte to be tokenized
+      const char* m_pEnd;    //!< One past the end of the block
+      qint64      m_llScan;  //!< Offset of the bitmap in m_uBits
+      quint64     m_uBits;   //!< Structural characters not yet visited
+      char        m_cDelim;  //!< Character matching the delimiter, e.g. ','
+   };
+};
+#endif // CSVTOKENIZER_H
@@ -0,0 +1,117 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DataBufferPool.h"
+
+
+namespace Data
+{
+   // Enough buffers for a few parsers to each have one being filled while
+   // others wait in the queue.
+   const int DataBufferPool::nDefaultMaxBuffers = 64;
+
+   // ==========================================================================
+   // ==========================================================================
+   DataBufferPool::DataBufferPool()
+      : m_nMaxBuffers(nDefaultMaxBuffers)
+   {
+      m_free.reserve( m_nMaxBuffers );
+      ResetStatistics();
+   }
+
+   void DataBufferPool::SetMaxBuffers( int nMaxBuffers )
+   {
+      m_mutex.lock();
+      m_nMaxBuffers = nMaxBuffers;
+      if( m_free.size() > m_nMaxBuffers )
+      {
+         m_free.resize( m_nMaxBuffers );
+      }
+      m_free.reserve( m_nMaxBuffers );
+      m_mutex.unlock();
+   }
+
+   void DataBufferPool::Acquire( DataBuffer& buffer )
+   {
+      DataBuffer pooled;
+      m_mutex.lock();
+      if( !m_free.empty() )
+      {
+         pooled.Swap( m_free.last() );
+         m_free.remove( m_free.size()-1 );
+         ++m_stats.nHits;
+      }
+      else
+      {
+         ++m_stats.nMisses;
+      }
+      m_mutex.unlock();
+
+      buffer.Swap( pooled );
+   }
+
+   void DataBufferPool::Release( DataBuffer& buffer )
+   {
+      // The buffer is emptied outside of the lock.
+      DataBuffer pooled;
+      pooled.Swap( buffer );
+      pooled.Clear();
+      for( int i = 0; i < pooled.numeric.size(); ++i )
+      {
+         // Parsers fill plain columns, e.g. not ones read from the cache.
+         if( pooled.numeric.at(i).IsNarrowed() )
+         {
+            pooled.numeric[i] = NumericColumn();
+         }
+      }
+      pooled.sFlightName.clear();
+      pooled.bFirstBuffer = false;
+      pooled.bLastBuffer  = false;
+      pooled.bAborted     = false;
+
+      m_mutex.lock();
+      if( m_free.size() < m_nMaxBuffers )
+      {
+         m_free.resize( m_free.size()+1 );
+         m_free.last().Swap( pooled );
+         ++m_stats.nReleased;
+      }
+      else
+      {
+         ++m_stats.nDropped;
+      }
+      m_mutex.unlock();
+   }
+
+   DataBufferPool::Statistics DataBufferPool::GetStatistics() const
+   {
+      m_mutex.lock();
+      Statistics stats = m_stats;
+      m_mutex.unlock();
+      return stats;
+   }
+
+   void DataBufferPool::ResetStatistics()
+   {
+      m_mutex.lock();
+      m_stats.nHits     = 0;
+      m_stats.nMisses   = 0;
+      m_stats.nReleased = 0;
+      m_stats.nDropped  = 0;
+      m_mutex.unlock();
+   }
+};
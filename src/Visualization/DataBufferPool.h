@@ -0,0 +1,77 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _DATABUFFERPOOL_H_
+#define _DATABUFFERPOOL_H_
+
+#include <QMutex>
+#include <QVector>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   //! Thread safe pool of emptied data buffers.  A buffer returned to the 
+   //! pool keeps the capacity of its value columns so a parser that takes
+   //! it back fills it without allocating.  Buffers are handed between 
+   //! threads with DataBuffer::Swap() rather than copied.
+   class DataBufferPool
+   {
+   public:
+      //! Default maximum number of buffers held by the pool.
+      static const int nDefaultMaxBuffers;
+
+      //! Counts of how often the pool had a buffer ready.
+      struct Statistics
+      {
+         int nHits;     //!< Acquire() calls given a pooled buffer
+         int nMisses;   //!< Acquire() calls that had to start an empty buffer
+         int nReleased; //!< Buffers returned to the pool
+         int nDropped;  //!< Buffers freed because the pool was full
+      };
+
+      DataBufferPool();
+
+      //! Sets the maximum number of buffers held by the pool.
+      void SetMaxBuffers( int nMaxBuffers );
+
+      //! Swaps an empty buffer from the pool into the buffer given.  The 
+      //! previous contents of the buffer are freed.
+      //! @param buffer  Receives the empty buffer
+      void Acquire( DataBuffer& buffer );
+
+      //! Empties a buffer and takes it into the pool, leaving the buffer 
+      //! given empty without any capacity.
+      //! @param buffer  Buffer to return
+      void Release( DataBuffer& buffer );
+
+      //! Returns the counts since the last ResetStatistics().
+      Statistics GetStatistics() const;
+
+      //! Restarts the counts.
+      void ResetStatistics();
+
+   private:
+      mutable QMutex      m_mutex;       //!< Mutex for thread safety
+      QVector<DataBuffer> m_free;        //!< Buffers ready to be acquired
+      int                 m_nMaxBuffers; //!< Maximum number of buffers in m_free
+      Statistics          m_stats;       //!< Counts of the pool use
+   };
+};
+
+#endif // _DATABUFFERPOOL_H_
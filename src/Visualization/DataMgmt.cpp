@@ -22,7 +22,17 @@
 #include <QSqlRecord>
 #include <QSqlField>
 #include <QSqlError>
-
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <qnumeric.h>
+#include <QtAlgorithms>
+#include <QtConcurrentRun>
+
+#include "NumberParser.h"
+#include "FlightCache.h"
+#include "ShardWriter.h"
+#include "DataNormalizer.h"
 #include "DataMgmt.h"
 
 using namespace std;
@@ -31,17 +41,235 @@ using namespace std;
 namespace Data
 {
 
-   // Conversion from hours to 100 microsecond increments.
-   // 60 minutes per hour, 60 seconds per minute, 
-   // 1,000 milliseconds per second,
-   // 10 100 microsecond increments per millisecond
-   const unsigned int HoursTo100MicroSeconds = 60*60*1000*10;
-
    // This ends up being a performance switch.  The number is how many data rows
    // are added to a transaction before a commit is called.  A higher number may
    // improve the time it takes to add data to the database.
    const int DataMgmt::nTransactionSwitch = 500;
 
+   // SQLite attaches at most 10 databases unless it is built otherwise.
+   const int DataMgmt::nMaxShards = 10;
+
+   // A value that only turns up now and then, e.g. a status that is blank
+   // or numeric until something goes wrong, is missed by the first row.
+   const int DataMgmt::nTypeSampleRows = 100;
+
+   // Longest time the consumer waits for data before checking for a stop.
+   const unsigned long nIdleWaitMsec = 500;
+
+   // Name of the column holding the time of each row.
+   const char* const TimeColumn = "Time_Hours";
+
+
+   // Extends the statistics of each numeric column of a flight with the 
+   // rows of a buffer, in one pass over their values.  Missing values are
+   // counted and the statistics of other columns are left at zero.
+   static void UpdateStatistics( QList<Metadata>& stats, const DataBuffer& buffer )
+   {
+      while( stats.size() < buffer.columns.size() )
+      {
+         stats.push_back( RunningStatistics().ToMetadata() );
+      }
+
+      for( int i = 0; i < buffer.columns.size(); ++i )
+      {
+         if( buffer.columns.at(i).bGood && 
+             buffer.columns.at(i).eParamType == ParamType_Numeric &&
+             i < buffer.numeric.size() )
+         {
+            RunningStatistics running( stats.at(i) );
+            const NumericColumn& values = buffer.numeric.at(i);
+            int nValues = values.size();
+            for( int r = 0; r < nValues; ++r )
+            {
+               running.Add( values.at(r) );
+            }
+            stats[i] = running.ToMetadata();
+         }
+      }
+   }
+
+   // Computes the statistics of each numeric column held in a store.
+   static QList<Metadata> ComputeStatistics( const DataBuffer& store )
+   {
+      QList<Metadata> stats;
+      UpdateStatistics( stats, store );
+      return stats;
+   }
+
+   // Finds the column of a flight by its database name.
+   // @return Index of the column or -1 if it isn't available
+   static int FindColumn( const ColumnDefList& defList, const QString& sName )
+   {
+      for( int i = 0; i < defList.size(); ++i )
+      {
+         if( defList.at(i).bGood && defList.at(i).sParamNameComp == sName )
+         {
+            return i;
+         }
+      }
+      return -1;
+   }
+
+   // Finds the earliest and latest time held in the buffer's time column.
+   // The times are left as NaN if there are none.
+   static void GetTimeRange( const DataBuffer& buffer, double& fMin, double& fMax )
+   {
+      int nTime = FindColumn( buffer.columns, TimeColumn );
+      if( nTime < 0 || buffer.columns.at(nTime).eParamType != ParamType_Numeric )
+      {
+         return;
+      }
+
+      const NumericColumn& times = buffer.numeric.at(nTime);
+      for( int r = 0; r < times.size(); ++r )
+      {
+         double fTime = times.at(r);
+         if( qIsNaN(fTime) )
+         {
+            continue;
+         }
+         if( qIsNaN(fMin) || fTime < fMin )
+         {
+            fMin = fTime;
+         }
+         if( qIsNaN(fMax) || fTime > fMax )
+         {
+            fMax = fTime;
+         }
+      }
+   }
+
+
+   // Extends the time index of a store with the rows from nFirst on.
+   static void IndexTimes( const DataBuffer& store, int nFirst, TimeIndex& index )
+   {
+      int nTime = FindColumn( store.columns, TimeColumn );
+      if( nTime < 0 || store.columns.at(nTime).eParamType != ParamType_Numeric )
+      {
+         return;
+      }
+
+      const NumericColumn& times = store.numeric.at(nTime);
+      for( int r = nFirst; r < times.size(); ++r )
+      {
+         double fTime = times.at(r);
+         if( qIsNaN(fTime) )
+         {
+            index.bMissing = true;
+            continue;
+         }
+         if( index.bMissing || (!qIsNaN(index.fLast) && fTime < index.fLast) )
+         {
+            index.bSorted = false;
+         }
+         if( qIsNaN(index.fMin) || fTime < index.fMin )
+         {
+            index.fMin = fTime;
+         }
+         if( qIsNaN(index.fMax) || fTime > index.fMax )
+         {
+            index.fMax = fTime;
+         }
+         index.fLast = fTime;
+      }
+   }
+
+   // Orders row numbers by their time.  Rows without a time go last.
+   class TimeOrder
+   {
+   public:
+      TimeOrder( const NumericColumn& times )
+         : m_times(times)
+      {
+      }
+
+      bool operator()( int a, int b ) const
+      {
+         double fA = m_times.at(a);
+         double fB = m_times.at(b);
+         if( qIsNaN(fB) )
+         {
+            return !qIsNaN(fA);
+         }
+         return !qIsNaN(fA) && fA < fB;
+      }
+
+   private:
+      const NumericColumn& m_times;
+   };
+
+   // Finds the first row whose time, in 100 microsecond increments, isn't 
+   // before uTime.  The rows must be in time order, see TimeIndex.
+   static int LowerBoundTime( const NumericColumn& times, unsigned int uTime )
+   {
+      int nFirst = 0;
+      int nCount = times.size();
+      while( nCount > 0 )
+      {
+         int nHalf = nCount / 2;
+         double fTime = times.at( nFirst+nHalf );
+         if( !qIsNaN(fTime) && fTime * HoursTo100MicroSeconds < uTime )
+         {
+            nFirst += nHalf + 1;
+            nCount -= nHalf + 1;
+         }
+         else
+         {
+            nCount = nHalf;
+         }
+      }
+      return nFirst;
+   }
+
+   // Puts the rows of a store in time order.  Rows with the same time keep 
+   // their order.
+   static void SortByTime( DataBuffer& store )
+   {
+      int nTime = FindColumn( store.columns, TimeColumn );
+      if( nTime < 0 || store.columns.at(nTime).eParamType != ParamType_Numeric )
+      {
+         return;
+      }
+
+      QVector<int> order( store.nRows );
+      for( int r = 0; r < store.nRows; ++r )
+      {
+         order[r] = r;
+      }
+      qStableSort( order.begin(), order.end(), TimeOrder(store.numeric.at(nTime)) );
+
+      for( int i = 0; i < store.numeric.size(); ++i )
+      {
+         const NumericColumn& values = store.numeric.at(i);
+         if( values.size() != store.nRows )
+         {
+            continue;
+         }
+         NumericColumn sorted;
+         sorted.reserve( store.nRows );
+         for( int r = 0; r < store.nRows; ++r )
+         {
+            sorted.append( values.at(order.at(r)) );
+         }
+         store.numeric[i] = sorted.Narrowed();
+      }
+      for( int i = 0; i < store.text.size(); ++i )
+      {
+         const QStringList& values = store.text.at(i);
+         if( values.size() != store.nRows )
+         {
+            continue;
+         }
+         QStringList sorted;
+         sorted.reserve( store.nRows );
+         for( int r = 0; r < store.nRows; ++r )
+         {
+            sorted.append( values.at(order.at(r)) );
+         }
+         store.text[i] = sorted;
+      }
+   }
+
 
    // ==========================================================================
    // ==========================================================================
@@ -49,15 +277,46 @@ namespace Data
       : m_sConnectionName( "" )
       , m_bStop(false)
       , m_nProcessed(0)
+      , m_eIngestMode(IngestMode_Database)
+      , m_eLoadProfile(LoadProfile_Safe)
+      , m_bBulkLoading(false)
+      , m_bPyramids(true)
+      , m_bTempShards(false)
    {
    }
 
    DataMgmt::~DataMgmt()
    {
+      // Cache files being written report back to this object.
+      m_cacheWrites.waitForFinished();
+
+      // Parsers still waiting for room in the queue give up.
+      m_queue.Close();
       stopProcessing();
       wait();
 
+      // The writers return their buffers to the pool so they go first.
+      QStringList shardFiles;
+      for( int i = 0; i < m_shards.size(); ++i )
+      {
+         shardFiles.push_back( m_shards.at(i)->GetFileName() );
+      }
+      qDeleteAll( m_shards );
+      m_shards.clear();
+
+      m_inserts.clear();
       m_db.close();
+
+      // Shards of a database in memory don't outlive it.
+      if( m_bTempShards )
+      {
+         for( int i = 0; i < shardFiles.size(); ++i )
+         {
+            QFile::remove( shardFiles.at(i) );
+            QFile::remove( shardFiles.at(i) + "-wal" );
+            QFile::remove( shardFiles.at(i) + "-shm" );
+         }
+      }
    }
 
 
@@ -67,7 +326,9 @@ namespace Data
    bool DataMgmt::Connect( const QString& sConnectionName )
    {	
       // Reset the cached data.
+      m_mutex.lock();
       m_columns.clear();
+      m_mutex.unlock();
 
       // Create the connection to the database.
       m_db = QSqlDatabase::addDatabase("QSQLITE", sConnectionName);
@@ -88,41 +349,150 @@ namespace Data
       return true;
    }
 
+   void DataMgmt::SetIngestMode( IngestMode eMode )
+   {
+      m_mutex.lock();
+      m_eIngestMode = eMode;
+      m_mutex.unlock();
+   }
+
+   DataMgmt::IngestMode DataMgmt::GetIngestMode() const
+   {
+      return m_eIngestMode;
+   }
+
+   bool DataMgmt::ParseIngestMode( const QString& sMode, IngestMode& eMode )
+   {
+      QString sLower = sMode.toLower();
+      if( sLower == "database" )
+      {
+         eMode = IngestMode_Database;
+      }
+      else if( sLower == "columns" )
+      {
+         eMode = IngestMode_Columns;
+      }
+      else if( sLower == "deferred" )
+      {
+         eMode = IngestMode_Deferred;
+      }
+      else
+      {
+         return false;
+      }
+      return true;
+   }
+
+   void DataMgmt::SetLoadProfile( LoadProfile eProfile )
+   {
+      m_mutex.lock();
+      m_eLoadProfile = eProfile;
+      m_mutex.unlock();
+   }
+
+   DataMgmt::LoadProfile DataMgmt::GetLoadProfile() const
+   {
+      return m_eLoadProfile;
+   }
+
+   bool DataMgmt::SetShards( int nShards )
+   {
+      if( !m_db.isOpen() || !m_shards.isEmpty() )
+      {
+         return false;
+      }
+      nShards = qBound( 0, nShards, nMaxShards );
+
+      // Shards of a database on disk are kept next to it.  A database in
+      // memory has its shards in temporary files.
+      QString sBase = m_db.databaseName();
+      m_bTempShards = sBase.isEmpty() || sBase == ":memory:";
+
+      QSqlQuery q(m_db);
+      for( int i = 0; i < nShards; ++i )
+      {
+         QString sFile;
+         if( m_bTempShards )
+         {
+            sFile = QDir::temp().filePath( QString("Visualization_%1.shard%2")
+               .arg(QCoreApplication::applicationPid()).arg(i) );
+            QFile::remove( sFile );
+         }
+         else
+         {
+            sFile = QString("%1.shard%2").arg(sBase).arg(i);
+         }
+
+         q.prepare( QString("ATTACH DATABASE ? AS shard%1").arg(i) );
+         q.addBindValue( sFile );
+         if( !q.exec() )
+         {
+            cerr << "Unable to attach shard " << qPrintable(sFile) << endl;
+            cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+            break;
+         }
+
+         ShardWriter* pShard = new ShardWriter( sFile, m_eLoadProfile, m_pool );
+         connect( pShard, SIGNAL(BufferStored(QString,int,bool)),
+                  this, SLOT(ShardStored(QString,int,bool)), Qt::DirectConnection );
+         m_shards.push_back( pShard );
+      }
+
+      return m_shards.size() == nShards;
+   }
+
+   int DataMgmt::GetShards() const
+   {
+      return m_shards.size();
+   }
+
+   void DataMgmt::SetQueueCapacity( int nMaxBuffers, qint64 llMaxBytes )
+   {
+      m_queue.SetCapacity( nMaxBuffers, llMaxBytes );
+   }
+
+   DataQueue::Statistics DataMgmt::GetQueueStatistics() const
+   {
+      return m_queue.GetStatistics();
+   }
+
    bool DataMgmt::ProcessHeader( 
       const QString& sFlightName,
       const QStringList& hdr,
       const QStringList& data )
+   {
+      QByteArray hdrStorage, dataStorage;
+      RowSpans   hdrRow;
+      QVector<RowSpans> samples(1);
+      RowSpans::FromStringList( hdr, hdrStorage, hdrRow );
+      RowSpans::FromStringList( data, dataStorage, samples[0] );
+      return ProcessHeader( sFlightName, hdrRow, samples );
+   }
+
+   bool DataMgmt::ProcessHeader( 
+      const QString& sFlightName,
+      const RowSpans& hdr,
+      const QVector<RowSpans>& samples )
    {
       // Verify that the input data matches between the header row and the
       // data row.
-      if( hdr.size() != data.size() )
+      if( samples.isEmpty() || hdr.size() != samples.at(0).size() )
       {
          cerr << "DataMgmt::ProcessHeader: Header names and first data row mismatch." << endl;
          return false;
       }
 
-      Data::DataBuffer buffer;
-      buffer.sFlightName = sFlightName;
-      
-      // If the database contains the indicated table already the procedure is
-      // to delete it and recreate it from the data in the file being parsed.
-      QSqlQuery q(m_db);
-      QString sQuery = "DROP TABLE IF EXISTS ";
-      sQuery.append( sFlightName );
-      buffer.data.push_back( sQuery );
-
-      // Construct the table based on information extracted from the CSV file.
-      // The table is given an auto-incrementing ID.
+      // Work out the columns from the information extracted from the CSV 
+      // file.
       //! @todo Future iterations would be better if they allowed the input file,
       //!       user, or other source provide intelligent indexing for the data.
       ColumnDef     def;
       ColumnDefList defList;
-      sQuery = "CREATE TABLE " + sFlightName + "(ID INTEGER PRIMARY KEY AUTOINCREMENT,";
-      bool bSuccess = true;
-      for( int i = 0; i < data.size(); ++i )
+      double value;
+      int nSamples = qMin( samples.size(), nTypeSampleRows );
+      for( int i = 0; i < hdr.size(); ++i )
       {
-         QString  column(hdr.at(i));
-         QVariant dim(data.at(i));
+         QString column(hdr.ToString(i));
 
          // Replace characters in the original name that aren't compatible 
          // with database naming conventions.
@@ -147,20 +517,39 @@ namespace Data
             }
          }
 
-         // If this column ColumnDef is good then figure out its data type
-         // add it as a column in the query.
+         // If this column ColumnDef is good then figure out its data type.
+         // The column is numeric only if a value in it is numeric and none
+         // of them are text.  A column that is empty in every sample stays
+         // text as it was when only the first row was looked at.  How a 
+         // numeric column is stored is worked out from the rows, see
+         // AppendColumns().
          if( def.bGood )
          {
-            sQuery.append(def.sParamNameComp);
-            dim.toFloat(&bSuccess);
-            if( bSuccess )
+            bool bNumeric = false;
+            bool bText    = false;
+            for( int j = 0; j < nSamples && !bText; ++j )
+            {
+               const RowSpans& data = samples.at(j);
+               if( data.size() != hdr.size() || data.Length(i) == 0 )
+               {
+                  continue;
+               }
+               if( Parser::NumberParser::ToDouble( data.Data(i), data.Length(i), value ) )
+               {
+                  bNumeric = true;
+               }
+               else
+               {
+                  bText = true;
+               }
+            }
+
+            if( bNumeric && !bText )
             {
-               sQuery.append(" NUMERIC,");
                def.eParamType = ParamType_Numeric;
             }
             else
             {
-               sQuery.append(" VARCHAR(255),");
                def.eParamType = ParamType_String;
             }
          }
@@ -172,8 +561,59 @@ namespace Data
          defList.push_back(def);
       }
 
-      // Save off the column definitions.
+      // Enqueue the commands onto the buffer for processing.
+      Data::DataBuffer buffer;
+      StartFlight( sFlightName, defList, buffer );
+      m_queue.Enqueue( buffer );
+
+      return true;
+   }
+
+   void DataMgmt::StartFlight( 
+      const QString& sFlightName,
+      const ColumnDefList& defList,
+      DataBuffer& buffer )
+   {
+      // Save off the column definitions.  Any columns held from an earlier
+      // load of the flight are replaced by this one.
+      m_mutex.lock();
       m_columns[sFlightName] = defList;
+      m_store.remove( sFlightName );
+      m_times.remove( sFlightName );
+      m_stats.remove( sFlightName );
+      m_pyramids.remove( sFlightName );
+      m_deferred.removeAll( sFlightName );
+      m_restored.remove( sFlightName );
+      m_mutex.unlock();
+
+      buffer.sFlightName  = sFlightName;
+      buffer.bFirstBuffer = true;
+      buffer.columns      = defList;
+      
+      // If the database contains the indicated table already the procedure is
+      // to delete it and recreate it from the column definitions.
+      QString sQuery = "DROP TABLE IF EXISTS ";
+      sQuery.append( sFlightName );
+      buffer.data.push_back( sQuery );
+
+      // The table is given an auto-incrementing ID.  Columns that are no 
+      // good are left out.
+      sQuery = "CREATE TABLE " + sFlightName + "(ID INTEGER PRIMARY KEY AUTOINCREMENT,";
+      for( int i = 0; i < defList.size(); ++i )
+      {
+         if( defList.at(i).bGood )
+         {
+            sQuery.append(defList.at(i).sParamNameComp);
+            if( defList.at(i).eParamType == ParamType_Numeric )
+            {
+               sQuery.append(" NUMERIC,");
+            }
+            else
+            {
+               sQuery.append(" VARCHAR(255),");
+            }
+         }
+      }
 
       // Replace the last comma separator with a parenthesis to close out the SQL
       // query.  The string logic above just blindly places a comma after every value.
@@ -181,44 +621,74 @@ namespace Data
 
       // Place the query in the buffer for processing.
       buffer.data.push_back( sQuery );
-
-      //! @todo Cache the column ColumnDef data in the database so that if
-      //!       the same file is read in while a backing database is still 
-      //!       available we can just recreate all the data we need from the
-      //!       database and save the time parsing the file again.
-      //! sQuery = "CREATE TABLE Columns(ID INTEGER PRIMARY KEY AUTOINCREMENT,
-      //!                                FriendlyName VARCHAR(32), Type VARCHAR(16))";
-
-      // Enqueue the commands onto the buffer for processing.
-      m_queue.Enqueue( buffer );
-
-      return true;
    }
 
-   // This takes in a string list of tokens that match the same order as the 
-   // header row.  Each token is processed according to a parallel ColumnDef
-   // that indicates whether the column is good and what data type it is.  The
-   // data is inserted into the database.
    void DataMgmt::ProcessData( 
       const QString& sFlightName,
       const QStringList& data,
       DataBuffer& buffer )
+   {
+      QByteArray storage;
+      RowSpans   row;
+      RowSpans::FromStringList( data, storage, row );
+      ProcessData( sFlightName, row, buffer );
+   }
+
+   void DataMgmt::ProcessData( 
+      const QString& sFlightName,
+      const RowSpans& data,
+      DataBuffer& buffer )
    {
       // Find the column names matching this flight.
-      FlightColumnMap::const_iterator i = m_columns.find(sFlightName);
-      if( i == m_columns.constEnd() )
+      ColumnDefList defList = GetColumnDefinitions( sFlightName );
+      if( defList.isEmpty() )
       {
          cerr << "Process data called on a flight without a header.  Cannot process" << endl;
          return;
       }
-      const ColumnDefList& defList = i.value();
-      
-      // Create a query class and start constructing the query string.
-      QString sQueryColumns = "INSERT INTO " + sFlightName + "(";
-      QString sQueryValues  = " VALUES(";
 
-      QString value;
-      bool bSuccess = true;
+      if( AppendData( defList, data, buffer ) &&
+          buffer.nRows > nTransactionSwitch )
+      {
+         Commit( buffer );
+      }
+   }
+
+   // This takes in a row of tokens that match the same order as the 
+   // header row.  Each token is processed according to a parallel ColumnDef
+   // that indicates whether the column is good and what data type it is.  The
+   // converted values are added to the buffer.
+   bool DataMgmt::AppendData( 
+      const ColumnDefList& defList,
+      const RowSpans& data,
+      DataBuffer& buffer )
+   {
+      // Rows that are short a column cannot be matched up with the header.
+      if( data.size() < defList.size() )
+      {
+         cerr << "Process data called with " << data.size() << " of "
+            << defList.size() << " columns.  Row ignored." << endl;
+         return false;
+      }
+
+      // The first row of a buffer sets up a value column per ColumnDef, 
+      // with room for the rows committed together.  A buffer from the pool
+      // already has the room.
+      if( buffer.nRows == 0 )
+      {
+         buffer.columns = defList;
+         buffer.numeric.resize( defList.size() );
+         buffer.text.resize( defList.size() );
+         for( int i = 0; i < defList.size(); ++i )
+         {
+            if( defList.at(i).bGood && defList.at(i).eParamType == ParamType_Numeric )
+            {
+               buffer.numeric[i].reserve( nTransactionSwitch+1 );
+            }
+         }
+      }
+
+      double value;
       for( int i = 0; i < defList.size(); ++i )
       {
          // If this is a column that was ignored from the data then
@@ -230,65 +700,37 @@ namespace Data
             continue;
          }
 
-         // Build the VALUES portion of the query according to the data
-         // ColumnDef, paying attention to the 
+         // Each value is converted once, here, according to the ColumnDef.
+         // Make sure that if the value isn't a number that results in a null.
          if( defList.at(i).eParamType == ParamType_String )
          {
-            value = "\"" + data.at(i) + "\"";
+            buffer.text[i].append( data.ToString(i) );
          }
-         else
+         else if( Parser::NumberParser::ToDouble( data.Data(i), data.Length(i), value ) )
          {
-            value = data.at(i);
-
-            // Make sure that if the value isn't a number that results in a null.
-            QVariant dim(data.at(i));
-            dim.toFloat(&bSuccess);
-            if( !bSuccess )
-            {
-               value = "";
-            }
+            buffer.numeric[i].append( value );
          }
-
-         // If there is no value for this column then just skip it in the query.
-         // Since the query specifies both the column name and value this works.
-         if( !value.isEmpty() )
+         else
          {
-            sQueryColumns.append(defList.at(i).sParamNameComp);
-            sQueryColumns.append(",");
-            sQueryValues.append(value);
-            sQueryValues.append(",");
+            buffer.numeric[i].append( qQNaN() );
          }
       }
-      // Replace the final comma with an end parenthesis instead.  When the query
-      // is generated the logic just blindly places the comma after each entry.  To
-      // create a proper query the trailing comma is replaced with a parenthesis.
-      sQueryColumns.replace(sQueryColumns.length()-1, 1, ')');
-      sQueryValues.replace (sQueryValues.length()-1, 1, ')');
-      QString sQuery = sQueryColumns + sQueryValues;
 
-      buffer.data.push_back(sQuery);
-      if( buffer.data.size() > nTransactionSwitch )
-      {
-         Commit( buffer );
-      }
+      ++buffer.nRows;
+      return true;
    }
    
    
    // ==========================================================================
    // Accessor methods
    // ==========================================================================
-   const ColumnDefList& DataMgmt::GetColumnDefinitions(const QString& sFlightName) const
+   ColumnDefList DataMgmt::GetColumnDefinitions(const QString& sFlightName) const
    {
-      static Data::ColumnDefList NullColumnDef;
-
-      FlightColumnMap::const_iterator i = m_columns.find(sFlightName);
-
-      if( i == m_columns.constEnd() )
-      {
-         return NullColumnDef;
-      }
+      m_mutex.lock();
+      ColumnDefList defList = m_columns.value( sFlightName );
+      m_mutex.unlock();
 
-      return i.value();
+      return defList;
    }
    
    bool DataMgmt::GetLoadedFlights(QStringList& flights) const
@@ -305,110 +747,302 @@ namespace Data
       const QStringList& attributes,
       Data::Buffer& data)
    {
-      int nAttr = attributes.size();
+      return CachedAttributes( sFlight, attributes, false, 0, 0, 1, false, data );
+   }
 
-      // Initialize the statistics data to calculate normalization and 
-      // construct the query to retrieve data.
-      QString sQuery = "SELECT Time_Hours,";
-      Data::Metadata meta;
-      meta._max = INT_MIN;
-      meta._min = INT_MAX;
-      meta._sum = 0;
-      meta._count = 0;
+   bool DataMgmt::GetDataAttributes(
+      const QString& sFlight,
+      const QStringList& attributes,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      Data::Buffer& data,
+      int nStride )
+   {
+      return CachedAttributes( sFlight, attributes, true, uBegin, uEnd, qMax(nStride, 1), false, data );
+   }
 
-      for( int i = 0; i < nAttr; ++i )
+   bool DataMgmt::GetNormalizedAttributes(
+      const QString& sFlight,
+      const QStringList& attributes,
+      Data::Buffer& data )
+   {
+      return CachedAttributes( sFlight, attributes, false, 0, 0, 1, true, data );
+   }
+
+   ResultCache::Statistics DataMgmt::GetResultCacheStatistics() const
+   {
+      return m_results.GetStatistics();
+   }
+
+   void DataMgmt::SetResultCacheCapacity( qint64 llMaxBytes )
+   {
+      m_results.SetMaxBytes( llMaxBytes );
+   }
+
+   void DataMgmt::SetPyramids( bool bPyramids )
+   {
+      m_mutex.lock();
+      m_bPyramids = bPyramids;
+      if( !m_bPyramids )
+      {
+         m_pyramids.clear();
+      }
+      m_mutex.unlock();
+   }
+
+   bool DataMgmt::CachedAttributes(
+      const QString& sFlight,
+      const QStringList& attributes,
+      bool bWindow,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      int nStride,
+      bool bNormalized,
+      Data::Buffer& data )
+   {
+      // The generation is taken under the same lock that reloading a flight
+      // invalidates it under, so a result read while the flight changes is
+      // never kept.
+      m_mutex.lock();
+      bool bLoaded = m_loadedFlights.contains( sFlight );
+      int nGeneration = m_results.Generation( sFlight );
+      m_mutex.unlock();
+
+      QString sKey = ResultCache::Key( attributes, bWindow, uBegin, uEnd, nStride, bNormalized );
+      Data::Buffer result;
+      if( !bLoaded || !m_results.Find(sFlight, sKey, result) )
       {
-         data._metadata.push_back(meta);
+         if( !QueryAttributes(sFlight, attributes, bWindow, uBegin, uEnd, nStride, result) )
+         {
+            return false;
+         }
 
-         sQuery += attributes.at(i);
-         sQuery += ",";
+         if( bNormalized )
+         {
+            Data::Normalizer normalizer;
+            normalizer.Process( result );
+         }
+
+         if( bLoaded )
+         {
+            m_results.Insert( sFlight, nGeneration, sKey, result );
+         }
       }
-      // Replace the last comma separator to close out the SQL query.  The 
-      // string logic above just blindly places a comma after every value.
-      sQuery.replace(sQuery.length()-1, 1, ' ');
-      // Add the from portion to select from the correct table.
-      sQuery +=  " FROM " + sFlight;
 
-      QSqlDatabase db = QSqlDatabase::database( m_sConnectionName );
-      QSqlQuery q(db);
-      if( !q.exec(sQuery) )
+      // Most callers start with an empty buffer, which then shares the 
+      // result rather than copying it.
+      if( data.RowCount() == 0 && data.AttributeCount() == 0 && data._metadata.empty() )
+      {
+         data = result;
+      }
+      else
+      {
+         data.Append( result );
+         data._metadata += result._metadata;
+      }
+      return true;
+   }
+
+   bool DataMgmt::QueryAttributes(
+      const QString& sFlight,
+      const QStringList& attributes,
+      bool bWindow,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      int nStride,
+      Data::Buffer& data )
+   {
+      AttributeCursor cursor;
+      if( !PrepareCursor(sFlight, attributes, bWindow, uBegin, uEnd, nStride, 
+                         AttributeCursor::nDefaultBlockRows, cursor) )
       {
-         QSqlError err = q.lastError();
-         std::cerr << "Error querying table " << qPrintable(sFlight) << std::endl;
-         std::cerr << "   Error message: " << qPrintable( err.text() ) << std::endl;
          return false;
       }
 
-      // Extract the data from the database.
-      bool bSuccess = false;
-      while( q.next() )
+      Data::Buffer block;
+      while( cursor.Next(block) )
+      {
+         data.Append( block );
+      }
+      data._metadata += cursor.GetMetadata();
+
+      // Number of statistics calculated must match the number of attributes.
+      //Q_ASSERT( data._metadata.size() == data.AttributeCount() );
+
+      return true;
+   }
+
+   bool DataMgmt::OpenCursor(
+      const QString& sFlight,
+      const QStringList& attributes,
+      AttributeCursor& cursor,
+      int nBlockRows )
+   {
+      return PrepareCursor( sFlight, attributes, false, 0, 0, 1, nBlockRows, cursor );
+   }
+
+   bool DataMgmt::OpenCursor(
+      const QString& sFlight,
+      const QStringList& attributes,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      AttributeCursor& cursor,
+      int nStride,
+      int nBlockRows )
+   {
+      return PrepareCursor( sFlight, attributes, true, uBegin, uEnd, qMax(nStride, 1), nBlockRows, cursor );
+   }
+
+   bool DataMgmt::PrepareCursor(
+      const QString& sFlight,
+      const QStringList& attributes,
+      bool bWindow,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      int nStride,
+      int nBlockRows,
+      AttributeCursor& cursor )
+   {
+      cursor.Close();
+      cursor.m_nBlockRows = qMax( nBlockRows, 1 );
+      cursor.m_nRead      = 0;
+      cursor.m_nStride    = nStride;
+      cursor.m_stored.clear();
+      cursor.m_running    = QVector<RunningStatistics>( attributes.size() );
+
+      // The statistics of a whole flight were gathered as it loaded so they
+      // aren't gathered again from the rows.
+      if( !bWindow && nStride == 1 )
       {
-         Data::Point point;
-         QSqlRecord rec = q.record();
+         GetStoredStatistics( sFlight, attributes, cursor.m_stored );
+      }
 
-         // The first record should always be time.
-         QSqlField field = rec.field(0);
-         double time = field.value().toDouble(&bSuccess);
-         if( bSuccess )
+      // Flights held in columns are read from memory rather than the database.
+      m_mutex.lock();
+      FlightColumnStore::const_iterator s = m_store.constFind( sFlight );
+      if( s != m_store.constEnd() )
+      {
+         DataBuffer store = s.value();
+         bool bSorted = m_times.value( sFlight ).bSorted;
+         m_mutex.unlock();
+
+         // Look up the columns up front, failing the same as the query would
+         // if an attribute doesn't exist.
+         QVector<int> columns;
+         for( int i = 0; i < attributes.size(); ++i )
          {
-            //! @todo Time conversion might be better as a process into
-            //!       database vs. coming out but at least it's all
-            //!       abstracted behind this class.
-            // Convert hours to the 100 microsecond increments.
-            point._time = time * HoursTo100MicroSeconds;
+            int nColumn = FindColumn( store.columns, attributes.at(i) );
+            if( nColumn < 0 )
+            {
+               std::cerr << "Error querying table " << qPrintable(store.sFlightName) << std::endl;
+               std::cerr << "   Error message: no such column: " << qPrintable(attributes.at(i)) << std::endl;
+               return false;
+            }
+            columns.push_back( nColumn );
          }
-         else
+
+         int nTime = FindColumn( store.columns, TimeColumn );
+         if( nTime >= 0 && store.columns.at(nTime).eParamType != ParamType_Numeric )
          {
-            point._time = 0;
+            nTime = -1;
          }
 
-         int m = 0;
-         for( int i = 1; i < rec.count(); ++i )
+         // Every nStride-th row from m_nNext to m_nEnd is read unless the 
+         // rows are listed.
+         int nFirst = 0;
+         int nLast  = 0;
+         QVector<int> rows;
+         if( !bWindow )
          {
-            m = i-1;
-            field = rec.field(i);
-
-            // Extract the data value.
-            double value = field.value().toDouble(&bSuccess);
-            if( bSuccess )
+            nLast = store.nRows;
+         }
+         else if( nTime >= 0 )
+         {
+            const NumericColumn& times = store.numeric.at(nTime);
+            if( bSorted )
             {
-               // Add the value to the data buffer.
-               point._dataVector.push_back(field.value());
-
-               // Update the running statistics.
-               data._metadata[m]._sum += value;
-               ++data._metadata[m]._count;
-               if( value < data._metadata[m]._min )
+               // The window is found with a binary search on the times.
+               nFirst = LowerBoundTime( times, uBegin );
+               nLast  = LowerBoundTime( times, uEnd );
+            }
+            else
+            {
+               // A flight still loading out of order is searched row by 
+               // row and the rows in the window are put in time order.
+               QVector<int> window;
+               for( int r = 0; r < times.size(); ++r )
                {
-                  data._metadata[m]._min = value;
+                  double fTime = times.at(r) * HoursTo100MicroSeconds;
+                  if( !qIsNaN(fTime) && fTime >= uBegin && fTime < uEnd )
+                  {
+                     window.push_back( r );
+                  }
                }
-               if( value > data._metadata[m]._max )
+               qStableSort( window.begin(), window.end(), TimeOrder(times) );
+               for( int n = 0; n < window.size(); n += nStride )
                {
-                  data._metadata[m]._max = value;
+                  rows.push_back( window.at(n) );
                }
-            }
-            else
-            {
-               std::cerr << "Error getting data for chart. idx=" << i << std::endl;
+               nLast = rows.size();
             }
          }
-         // Add the value to the data buffer.
-         data._params.push_back(point);
+
+         cursor.m_bColumns = true;
+         cursor.m_store    = store;
+         cursor.m_columns  = columns;
+         cursor.m_nTime    = nTime;
+         cursor.m_rows     = rows;
+         cursor.m_nNext    = nFirst;
+         cursor.m_nEnd     = nLast;
+         cursor.m_bOpen    = true;
+         return true;
       }
+      m_mutex.unlock();
+
+      int nAttr = attributes.size();
 
-      for( int m = 0; m < data._metadata.size(); ++m )
+      // Construct the query to retrieve data.
+      QString sQuery = "SELECT Time_Hours,";
+      for( int i = 0; i < nAttr; ++i )
       {
-         // First, calculate the range from the min and max.
-         data._metadata[m]._range = 
-            data._metadata[m]._max - data._metadata[m]._min;
+         sQuery += attributes.at(i);
+         sQuery += ",";
+      }
+      // Replace the last comma separator to close out the SQL query.  The 
+      // string logic above just blindly places a comma after every value.
+      sQuery.replace(sQuery.length()-1, 1, ' ');
+      // Add the from portion to select from the correct table.
+      sQuery +=  " FROM " + sFlight;
 
-         data._metadata[m]._avg = data._metadata[m]._sum	/ data._metadata[m]._count;
+      // The index on the time column finds the window without reading the
+      // rest of the table.
+      if( bWindow )
+      {
+         sQuery += QString(" WHERE %1 >= ? AND %1 < ? ORDER BY %1").arg(TimeColumn);
       }
 
-      // Number of statistics calculated must match the number of attributes.
-      //Q_ASSERT( (data._params.empty() && attributes.empty()) ||
-      //           data._metadata.size() == data._params[0]._dataVector.size() );
+      QSqlDatabase db = QSqlDatabase::database( m_sConnectionName );
+      QSqlQuery q(db);
+      q.setForwardOnly( true );
+      q.prepare( sQuery );
+      if( bWindow )
+      {
+         q.addBindValue( double(uBegin) / HoursTo100MicroSeconds );
+         q.addBindValue( double(uEnd) / HoursTo100MicroSeconds );
+      }
+      if( !q.exec() )
+      {
+         QSqlError err = q.lastError();
+         std::cerr << "Error querying table " << qPrintable(sFlight) << std::endl;
+         std::cerr << "   Error message: " << qPrintable( err.text() ) << std::endl;
+         return false;
+      }
 
+      // The rows are read from the statement as the cursor advances.
+      cursor.m_bColumns  = false;
+      cursor.m_query     = q;
+      cursor.m_nQueryRow = 0;
+      cursor.m_bOpen     = true;
       return true;
    }
 
@@ -421,9 +1055,18 @@ namespace Data
    {
       //! @todo EventData should really be combined with an ability to replace
       //!       based on the event definition.  For now, it's a replace.
+      m_mutex.lock();
       m_evtDb._events[sFlightName] = evtData;
 
-      return true;
+      // A flight waiting to be cataloged gets its events along with it.
+      bool bSuccess = true;
+      if( !m_sources.contains(sFlightName) && m_catalog.Contains(sFlightName) )
+      {
+         bSuccess = m_catalog.RecordEvents( sFlightName, evtData );
+      }
+      m_mutex.unlock();
+
+      return bSuccess;
    }
 
    const EventDatabase& DataMgmt::GetEventData( ) const
@@ -435,118 +1078,1131 @@ namespace Data
    {
       return m_flightMeta;
    }
-   
-   // ==========================================================================
-   // Threading methods
-   // ==========================================================================
-   void DataMgmt::Commit(DataBuffer& buffer)
+
+   bool DataMgmt::GetColumnStatistics( const QString& sFlightName, QList<Metadata>& stats ) const
    {
-      // This is the producer portion of the threading.  This method is called
-      // by another thread, which places the data into the queue.
-      if( !buffer.data.empty() )
+      m_mutex.lock();
+      FlightStatistics::const_iterator f = m_stats.constFind( sFlightName );
+      if( f != m_stats.constEnd() )
       {
-         m_queue.Enqueue(buffer);
-         buffer.data.clear();
+         stats = f.value();
+         m_mutex.unlock();
+         return true;
       }
-   }
-  
-   void DataMgmt::run()
-   {
-      // This is the consumer of the threaded data read.  It pulls items off 
-      // the queue and performs the call to the database.
-      DataBuffer buffer;
-      while( !m_bStop )
+
+      // Flights that are still loading or being followed aren't kept up to
+      // date so compute them from the columns.
+      FlightColumnStore::const_iterator s = m_store.constFind( sFlightName );
+      if( s == m_store.constEnd() )
       {
-         if( m_queue.Dequeue(buffer) )
-         {
-            m_mutex.lock();
-            m_db.transaction();
+         m_mutex.unlock();
+         return false;
+      }
+      DataBuffer store = s.value();
+      m_mutex.unlock();
 
-            QSqlQuery q(m_db);
-            for( int i = 0; i < buffer.data.size(); ++i )
-            {
-               // Execute the query and check for any error messages.
-               if( !q.exec(buffer.data.at(i)) )
-               {
-                  cerr << "------------------------------------------" << endl;
-                  cerr << "Query failed for database " << qPrintable(m_sConnectionName) << endl;
-                  cerr << "   Flight       : " << qPrintable(buffer.sFlightName) << endl;
-                  cerr << "   Query        : " << qPrintable(buffer.data.at(i));
-                  cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
-                  cerr << "------------------------------------------" << endl;
-               }
-            }
+      stats = ComputeStatistics( store );
+      return true;
+   }
 
-            // Track progress.
-            ++m_nProcessed;
-            emit( setProgressRange(0, m_nProcessed+m_queue.Size()) );
-            emit( setCurrentProgress(m_nProcessed) );
+   bool DataMgmt::GetEnvelope(
+      const QString& sFlightName,
+      const QStringList& attributes,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      int nSpans,
+      Envelope& envelope )
+   {
+      envelope.Reset( uBegin, uEnd, nSpans, attributes.size() );
+      if( envelope.SpanCount() == 0 || uEnd <= uBegin )
+      {
+         return true;
+      }
 
-            
-            if( buffer.bLastBuffer )
+      // The pyramid of the time column comes first, followed by those of the
+      // attributes.  They're shared rather than copied so they're read 
+      // without holding the lock.
+      QVector<ColumnPyramid> pyramids;
+      m_mutex.lock();
+      FlightPyramids::const_iterator p = m_pyramids.constFind( sFlightName );
+      if( p != m_pyramids.constEnd() )
+      {
+         ColumnDefList defList = m_columns.value( sFlightName );
+         int nTime = FindColumn( defList, TimeColumn );
+         if( nTime >= 0 && nTime < p.value().size() )
+         {
+            pyramids.push_back( p.value().at(nTime) );
+         }
+         for( int i = 0; i < attributes.size() && !pyramids.empty(); ++i )
+         {
+            int nColumn = FindColumn( defList, attributes.at(i) );
+            if( nColumn < 0 || nColumn >= p.value().size() ||
+                p.value().at(nColumn).RowCount() != pyramids.at(0).RowCount() )
             {
-               QString sQuery = "SELECT MAX(Time_Hours) FROM " + buffer.sFlightName;
-               if( q.exec(sQuery) )
-               {
-                  if( q.next() )
-                  {
-                     QSqlRecord rec = q.record();
-
-                     // The first record should always be time.
-                     QSqlField field = rec.field(0);
-                     bool bSuccess = false;
-                     double       fTime = field.value().toDouble(&bSuccess);
-                     unsigned int nTime = fTime * HoursTo100MicroSeconds;
-                     if( bSuccess && m_flightMeta._uGlobalMaxTime < nTime )
-                     {
-                        m_flightMeta._uGlobalMaxTime = nTime;
-                     }
-                  }
-               }
-               sQuery = "SELECT MIN(Time_Hours) FROM " + buffer.sFlightName;
-               if( q.exec(sQuery) )
-               {
-                  if( q.next() )
-                  {
-                     QSqlRecord rec = q.record();
-
-                     // The first record should always be time.
-                     QSqlField field = rec.field(0);
-                     bool bSuccess = false;
-                     double       fTime = field.value().toDouble(&bSuccess);
-                     unsigned int nTime = fTime * HoursTo100MicroSeconds;
-                     if( bSuccess && m_flightMeta._uGlobalMinTime > nTime )
-                     {
-                        m_flightMeta._uGlobalMinTime = nTime;
-                     }
-                  }
-               }
+               pyramids.clear();
             }
-
-            m_db.commit();
-            m_mutex.unlock();
-
-            if( buffer.bLastBuffer )
+            else
             {
-               m_loadedFlights.push_back(buffer.sFlightName);
-               emit( FlightComplete(buffer.sFlightName) );
+               pyramids.push_back( p.value().at(nColumn) );
             }
          }
-         else
+      }
+      m_mutex.unlock();
+
+      // The level whose buckets hold at most half the rows of a span is 
+      // used, estimating the rows of a span from the flight's time range.
+      int nLevel = -1;
+      PyramidBucket whole;
+      if( !pyramids.empty() && pyramids.at(0).Tail(pyramids.at(0).LevelCount(), whole) &&
+          whole.uCount > 0 && whole.fMax > whole.fMin )
+      {
+         double fRowsPerSpan = pyramids.at(0).RowCount() * 
+            (double(uEnd - uBegin) / envelope.SpanCount()) /
+            ((whole.fMax - whole.fMin) * HoursTo100MicroSeconds);
+         while( nLevel+1 < pyramids.at(0).LevelCount() && 
+                2 * ColumnPyramid::BucketRows(nLevel+1) <= fRowsPerSpan )
          {
-            // Give some time to allow the queue to populate but don't
-            // hog all the processing time.
-            QThread::msleep(500);
+            ++nLevel;
          }
       }
 
-      m_bStop = false; // In case the thread needs restarted.
-   }
-
-   void DataMgmt::stopProcessing()
+      if( nLevel < 0 )
+      {
+         // Too few rows fall in a span for the pyramids to help, or there
+         // are none, so the rows in the window are read.
+         AttributeCursor cursor;
+         if( !OpenCursor(sFlightName, attributes, uBegin, uEnd, cursor) )
+         {
+            return false;
+         }
+
+         Data::Buffer block;
+         while( cursor.Next(block) )
+         {
+            envelope.Add( block );
+         }
+         return true;
+      }
+
+      // Each bucket of the level, followed by the rows after the last one,
+      // is added to the spans its times overlap.
+      int nBuckets = pyramids.at(0).Level(nLevel).size();
+      for( int b = 0; b <= nBuckets; ++b )
+      {
+         PyramidBucket time;
+         if( b < nBuckets )
+         {
+            time = pyramids.at(0).Level(nLevel).at(b);
+         }
+         else if( !pyramids.at(0).Tail(nLevel, time) )
+         {
+            break;
+         }
+         if( time.uCount == 0 )
+         {
+            continue;
+         }
+
+         unsigned int uFirst = qMax( time.fMin, 0.0 ) * HoursTo100MicroSeconds;
+         unsigned int uLast  = qMax( time.fMax, 0.0 ) * HoursTo100MicroSeconds;
+         if( uLast < uBegin || uFirst >= uEnd )
+         {
+            continue;
+         }
+
+         for( int a = 1; a < pyramids.size(); ++a )
+         {
+            PyramidBucket bucket;
+            if( b < nBuckets )
+            {
+               bucket = pyramids.at(a).Level(nLevel).at(b);
+            }
+            else
+            {
+               pyramids.at(a).Tail( nLevel, bucket );
+            }
+            envelope.Add( a-1, uFirst, uLast, bucket );
+         }
+      }
+
+      return true;
+   }
+
+   bool DataMgmt::GetStoredStatistics( 
+      const QString& sFlightName, 
+      const QStringList& attributes,
+      QList<Metadata>& stats ) const
+   {
+      stats.clear();
+      m_mutex.lock();
+      FlightStatistics::const_iterator f = m_stats.constFind( sFlightName );
+      if( f == m_stats.constEnd() || !m_loadedFlights.contains(sFlightName) )
+      {
+         m_mutex.unlock();
+         return false;
+      }
+
+      // Only numeric columns have statistics of their own.
+      ColumnDefList defList = m_columns.value( sFlightName );
+      for( int i = 0; i < attributes.size(); ++i )
+      {
+         int nColumn = FindColumn( defList, attributes.at(i) );
+         if( nColumn < 0 || nColumn >= f.value().size() ||
+             defList.at(nColumn).eParamType != ParamType_Numeric )
+         {
+            stats.clear();
+            break;
+         }
+         stats.push_back( f.value().at(nColumn) );
+      }
+      m_mutex.unlock();
+
+      return !stats.empty();
+   }
+
+   qint64 DataMgmt::GetRowCount( const QString& sFlightName ) const
+   {
+      m_mutex.lock();
+      FlightColumnStore::const_iterator s = m_store.constFind( sFlightName );
+      if( s != m_store.constEnd() )
+      {
+         qint64 llRows = s.value().nRows;
+         m_mutex.unlock();
+         return llRows;
+      }
+      m_mutex.unlock();
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      if( q.exec("SELECT COUNT(*) FROM " + sFlightName) && q.next() )
+      {
+         return q.value(0).toLongLong();
+      }
+      return 0;
+   }
+
+   // ==========================================================================
+   // Flight cache
+   // ==========================================================================
+   bool DataMgmt::LoadCache( const QString& sCacheFile, const QString& sFlightName )
+   {
+      DataBuffer store;
+      QList<Metadata> stats;
+      EventData events;
+      if( !FlightCache::Read( sCacheFile, store, stats, events ) )
+      {
+         return false;
+      }
+
+      // The flight goes through the queue as a single buffer, the same as a
+      // parsed flight, so it is stored and completes the usual way.
+      DataBuffer buffer;
+      StartFlight( sFlightName, store.columns, buffer );
+      buffer.numeric     = store.numeric;
+      buffer.text        = store.text;
+      buffer.nRows       = store.nRows;
+      buffer.bLastBuffer = true;
+
+      if( stats.size() == store.columns.size() )
+      {
+         m_mutex.lock();
+         m_stats[sFlightName] = stats;
+         m_mutex.unlock();
+      }
+      SetEventData( sFlightName, events );
+      m_mutex.lock();
+      m_restored.insert( sFlightName );
+      m_mutex.unlock();
+
+      m_queue.Enqueue( buffer );
+      return true;
+   }
+
+   bool DataMgmt::SaveCache( const QString& sCacheFile, const QString& sFlightName )
+   {
+      QList<Metadata> stats;
+      m_mutex.lock();
+      FlightColumnStore::const_iterator s = m_store.constFind( sFlightName );
+      if( s == m_store.constEnd() )
+      {
+         m_mutex.unlock();
+         return false;
+      }
+      DataBuffer store  = s.value();
+      EventData  events = m_evtDb._events.value( sFlightName );
+      m_mutex.unlock();
+
+      // The columns are shared with the store rather than copied, so only
+      // the writing is left for the worker.
+      GetColumnStatistics( sFlightName, stats );
+      m_cacheWrites.addFuture( QtConcurrent::run( 
+         this, &DataMgmt::WriteCache, sCacheFile, sFlightName, store, stats, events ) );
+      return true;
+   }
+
+   void DataMgmt::WriteCache( 
+      QString sCacheFile, 
+      QString sFlightName,
+      DataBuffer store,
+      QList<Metadata> stats,
+      EventData events )
+   {
+      bool bSaved = FlightCache::Write( sCacheFile, store, stats, events );
+      emit( CacheSaved(sFlightName, bSaved) );
+   }
+
+   // ==========================================================================
+   // Flight catalog
+   // ==========================================================================
+   bool DataMgmt::OpenCatalog()
+   {
+      return m_catalog.Open( m_sConnectionName );
+   }
+
+   bool DataMgmt::LoadCatalog( const QString& sSourceFile, const QString& sFlightName )
+   {
+      if( !m_catalog.IsOpen() )
+      {
+         return false;
+      }
+
+      // A file whose path or time changed is compared by its contents, so 
+      // its hash is found before the lock is taken.  The catalog shares the
+      // connection of the consumer so it is only used under the lock.
+      QString         sHash = FlightCache::SourceHash( sSourceFile );
+      ColumnDefList   defList;
+      QList<Metadata> stats;
+      EventData       events;
+      m_mutex.lock();
+      if( !m_catalog.Find( sFlightName, sSourceFile, sHash, defList, stats, events ) )
+      {
+         // The table is about to be replaced, so the flight stays out of the
+         // catalog until all of its rows are in again.
+         m_shardOf.remove( sFlightName );
+         m_catalog.Remove( sFlightName );
+         if( m_eIngestMode != IngestMode_Columns )
+         {
+            m_sources[sFlightName] = sSourceFile;
+         }
+         m_mutex.unlock();
+         return false;
+      }
+
+      m_columns[sFlightName] = defList;
+      m_loadedFlights.removeAll( sFlightName );
+      m_store.remove( sFlightName );
+      m_times.remove( sFlightName );
+      m_stats.remove( sFlightName );
+      m_pyramids.remove( sFlightName );
+      if( !stats.empty() )
+      {
+         m_stats[sFlightName] = stats;
+      }
+      m_deferred.removeAll( sFlightName );
+      m_sources.remove( sFlightName );
+      m_shardOf.remove( sFlightName );
+      m_results.Invalidate( sFlightName );
+      m_restored.remove( sFlightName );
+      if( !events.empty() )
+      {
+         m_evtDb._events[sFlightName] = events;
+         m_restored.insert( sFlightName );
+      }
+      m_mutex.unlock();
+
+      // The flight completes once the consumer reaches it, with its time 
+      // range read from its table.
+      DataBuffer buffer;
+      buffer.sFlightName = sFlightName;
+      buffer.columns     = defList;
+      buffer.bLastBuffer = true;
+      m_queue.Enqueue( buffer );
+      return true;
+   }
+
+   QString DataMgmt::CatalogHash( const QString& sFlightName )
+   {
+      m_mutex.lock();
+      QString sSourceFile = m_sources.value( sFlightName );
+      m_mutex.unlock();
+      if( sSourceFile.isEmpty() )
+      {
+         return QString();
+      }
+
+      // The file was usually hashed to find its cache when it was parsed,
+      // in which case only its size and time are checked.
+      return FlightCache::SourceHash( sSourceFile );
+   }
+
+   void DataMgmt::RecordCatalog( const QString& sFlightName, const QString& sHash )
+   {
+      QMap<QString,QString>::iterator s = m_sources.find( sFlightName );
+      if( s == m_sources.end() )
+      {
+         return;
+      }
+      QString sSourceFile = s.value();
+      m_sources.erase( s );
+
+      if( m_catalog.Record( sFlightName, sSourceFile, sHash, 
+                            m_columns.value(sFlightName), m_stats.value(sFlightName) ) &&
+          m_evtDb._events.contains(sFlightName) )
+      {
+         m_catalog.RecordEvents( sFlightName, m_evtDb._events.value(sFlightName) );
+      }
+   }
+   
+   // ==========================================================================
+   // Threading methods
+   // ==========================================================================
+   void DataMgmt::Commit(DataBuffer& buffer)
+   {
+      // This is the producer portion of the threading.  This method is called
+      // by another thread, which places the data into the queue.
+      // The rows are handed to the queue and the caller carries on with an
+      // empty buffer from the pool.
+      if( !buffer.data.empty() || buffer.nRows > 0 )
+      {
+         DataBuffer handoff;
+         m_pool.Acquire( handoff );
+         handoff.Swap( buffer );
+         buffer.sFlightName  = handoff.sFlightName;
+         buffer.bFirstBuffer = handoff.bFirstBuffer;
+         buffer.bLastBuffer  = handoff.bLastBuffer;
+         m_queue.Enqueue( handoff );
+      }
+   }
+
+   void DataMgmt::AbortFlight( const QString& sFlightName )
+   {
+      // The buffer follows the flight's other buffers through the queue so
+      // the flight is only dropped once they're stored.
+      DataBuffer buffer;
+      buffer.sFlightName = sFlightName;
+      buffer.bAborted    = true;
+      m_queue.Enqueue( buffer );
+   }
+
+   void DataMgmt::AcquireBuffer( DataBuffer& buffer )
+   {
+      m_pool.Acquire( buffer );
+   }
+
+   void DataMgmt::ReleaseBuffer( DataBuffer& buffer )
+   {
+      m_pool.Release( buffer );
+   }
+
+   DataBufferPool::Statistics DataMgmt::GetPoolStatistics() const
+   {
+      return m_pool.GetStatistics();
+   }
+  
+   void DataMgmt::run()
+   {
+      // This is the consumer of the threaded data read.  It pulls items off 
+      // the queue and performs the call to the database.
+      DataBuffer buffer;
+      QString    sDeferred;
+      m_bStop = false;
+
+      // The writers stop along with the consumer, see stopProcessing().
+      for( int i = 0; i < m_shards.size(); ++i )
+      {
+         m_shards.at(i)->wait();
+         m_shards.at(i)->start();
+      }
+      m_queue.SetConsumerRunning( true );
+      while( !m_bStop )
+      {
+         if( m_queue.Dequeue(buffer) )
+         {
+            // An abandoned flight never reaches its last buffer, so it stops
+            // holding the bulk load here.
+            if( buffer.bAborted )
+            {
+               m_mutex.lock();
+               m_loading.remove( buffer.sFlightName );
+               m_sources.remove( buffer.sFlightName );
+               m_mutex.unlock();
+
+               EndBulkLoad();
+               m_pool.Release( buffer );
+               continue;
+            }
+
+            // The writer of a sharded flight stores it and completes it.
+            if( StoreInShard(buffer) )
+            {
+               continue;
+            }
+
+            // A completed flight is cataloged with the hash of its source, 
+            // which is found before the lock is taken.
+            QString sHash;
+            if( buffer.bLastBuffer )
+            {
+               sHash = CatalogHash( buffer.sFlightName );
+            }
+
+            m_mutex.lock();
+            if( buffer.bFirstBuffer )
+            {
+               // A flight that is loaded again isn't available until it 
+               // completes again.
+               m_loadedFlights.removeAll( buffer.sFlightName );
+               m_results.Invalidate( buffer.sFlightName );
+               BeginFlight( buffer.sFlightName );
+            }
+            m_db.transaction();
+
+            // Rows for a flight that has already completed are being appended
+            // to it, e.g. from a file that is being followed.
+            bool bAppended = buffer.nRows > 0 && 
+               m_loadedFlights.contains( buffer.sFlightName );
+
+            GatherStatistics( buffer );
+
+            // Statements change the table of the flight so its insert is 
+            // released before they run and prepared again afterward.
+            if( !buffer.data.empty() )
+            {
+               m_inserts.remove( buffer.sFlightName );
+            }
+
+            QSqlQuery q(m_db);
+            for( int i = 0; i < buffer.data.size(); ++i )
+            {
+               // Execute the query and check for any error messages.
+               if( !q.exec(buffer.data.at(i)) )
+               {
+                  cerr << "------------------------------------------" << endl;
+                  cerr << "Query failed for database " << qPrintable(m_sConnectionName) << endl;
+                  cerr << "   Flight       : " << qPrintable(buffer.sFlightName) << endl;
+                  cerr << "   Query        : " << qPrintable(buffer.data.at(i));
+                  cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+                  cerr << "------------------------------------------" << endl;
+               }
+            }
+
+            // During a bulk load the indexes are held back until the rows
+            // are in, otherwise they're created along with the table.
+            if( buffer.bFirstBuffer )
+            {
+               if( m_bBulkLoading )
+               {
+                  m_unindexed[buffer.sFlightName] = buffer.columns;
+               }
+               else
+               {
+                  CreateIndexes( m_db, buffer.sFlightName, buffer.columns );
+               }
+            }
+
+            if( m_eIngestMode == IngestMode_Database )
+            {
+               InsertRows( m_db, m_inserts, buffer );
+            }
+            else
+            {
+               AppendColumns( buffer );
+
+               // A completed flight is put in time order.  Recordings are 
+               // nearly always in order already, so this rarely sorts.
+               if( buffer.bLastBuffer && m_times.contains(buffer.sFlightName) &&
+                   !m_times.value(buffer.sFlightName).bSorted )
+               {
+                  SortByTime( m_store[buffer.sFlightName] );
+                  m_times[buffer.sFlightName].bSorted = true;
+               }
+
+               // Once a deferred flight is in the database its new rows 
+               // must go in as well.
+               if( bAppended && m_eIngestMode == IngestMode_Deferred &&
+                   !m_deferred.contains(buffer.sFlightName) )
+               {
+                  InsertRows( m_db, m_inserts, buffer );
+               }
+            }
+
+            // Track progress.
+            ++m_nProcessed;
+            emit( setProgressRange(0, m_nProcessed+m_queue.Size()) );
+            emit( setCurrentProgress(m_nProcessed) );
+
+            if( bAppended )
+            {
+               UpdateTimeRange( q, buffer, true );
+            }
+            if( buffer.bLastBuffer )
+            {
+               UpdateTimeRange( q, buffer, false );
+               if( m_eIngestMode == IngestMode_Deferred )
+               {
+                  m_deferred.push_back(buffer.sFlightName);
+               }
+               else
+               {
+                  CreateDeferredIndexes( buffer.sFlightName );
+               }
+               if( m_eIngestMode == IngestMode_Database )
+               {
+                  RecordCatalog( buffer.sFlightName, sHash );
+               }
+               m_loading.remove( buffer.sFlightName );
+            }
+
+            m_db.commit();
+
+            // Results kept for a flight no longer hold all of its rows once
+            // rows are appended to it.  Other flights keep theirs.
+            if( bAppended )
+            {
+               m_results.Invalidate( buffer.sFlightName );
+            }
+            m_mutex.unlock();
+
+            EndBulkLoad();
+
+            if( buffer.bLastBuffer )
+            {
+               m_mutex.lock();
+               m_loadedFlights.push_back(buffer.sFlightName);
+               m_mutex.unlock();
+               emit( FlightComplete(buffer.sFlightName) );
+            }
+            else if( bAppended )
+            {
+               emit( RowsAppended(buffer.sFlightName, buffer.nRows) );
+            }
+
+            // The buffer goes back for a parser to fill again.
+            m_pool.Release( buffer );
+         }
+         else if( TakeDeferred(sDeferred) )
+         {
+            // Nothing is waiting to be parsed so catch the database up on
+            // the flights that are already available from their columns.
+            StoreDeferred( sDeferred );
+         }
+         else
+         {
+            // Wait for the queue to populate, waking now and then to check
+            // for a stop.
+            m_queue.WaitForData( nIdleWaitMsec );
+         }
+      }
+
+      // Flights still waiting on the database are inserted before stopping,
+      // otherwise they'd be missing from it and the bulk load never ends.
+      while( TakeDeferred(sDeferred) )
+      {
+         StoreDeferred( sDeferred );
+      }
+
+      // Parsers must not wait on a queue that nothing is draining.  The stop
+      // is only cleared when the thread is restarted so that it reads as 
+      // stopping until the thread has finished, see IsStopping().
+      m_queue.SetConsumerRunning( false );
+   }
+
+   bool DataMgmt::StoreInShard( DataBuffer& buffer )
+   {
+      m_mutex.lock();
+      if( m_shards.isEmpty() || m_eIngestMode != IngestMode_Database )
+      {
+         m_mutex.unlock();
+         return false;
+      }
+
+      QSqlQuery q(m_db);
+      if( buffer.bFirstBuffer )
+      {
+         // A flight is always hashed to the same shard, from one session to
+         // the next.  A table left in the database itself by a load that
+         // wasn't sharded would hide the new one.
+         m_shardOf[buffer.sFlightName] = 
+            qHash( buffer.sFlightName ) % uint( m_shards.size() );
+         m_loadedFlights.removeAll( buffer.sFlightName );
+         m_results.Invalidate( buffer.sFlightName );
+         q.exec( "DROP TABLE IF EXISTS main." + buffer.sFlightName );
+      }
+
+      // Flights that aren't in a shard, e.g. those from the catalog, are 
+      // stored the usual way.
+      QMap<QString,int>::const_iterator s = m_shardOf.constFind( buffer.sFlightName );
+      if( s == m_shardOf.constEnd() )
+      {
+         m_mutex.unlock();
+         return false;
+      }
+      ShardWriter* pShard = m_shards.at( s.value() );
+
+      // The rows aren't readable until the writer commits them, so the time
+      // range is extended from the buffer as it passes.
+      if( buffer.nRows > 0 )
+      {
+         UpdateTimeRange( q, buffer, true );
+      }
+      GatherStatistics( buffer );
+
+      ++m_nProcessed;
+      emit( setProgressRange(0, m_nProcessed+m_queue.Size()) );
+      emit( setCurrentProgress(m_nProcessed) );
+      m_mutex.unlock();
+
+      // The lock isn't held while waiting for room since the writer takes
+      // it once a buffer is stored.
+      if( !pShard->Enqueue(buffer) )
+      {
+         m_pool.Release( buffer );
+      }
+      return true;
+   }
+
+   void DataMgmt::ShardStored( QString sFlightName, int nRows, bool bLastBuffer )
+   {
+      QString sHash;
+      if( bLastBuffer )
+      {
+         sHash = CatalogHash( sFlightName );
+      }
+
+      m_mutex.lock();
+      bool bAppended = !bLastBuffer && nRows > 0 && 
+         m_loadedFlights.contains( sFlightName );
+      if( bLastBuffer )
+      {
+         RecordCatalog( sFlightName, sHash );
+         m_loadedFlights.push_back( sFlightName );
+      }
+      else if( bAppended )
+      {
+         m_results.Invalidate( sFlightName );
+      }
+      m_mutex.unlock();
+
+      if( bLastBuffer )
+      {
+         emit( FlightComplete(sFlightName) );
+      }
+      else if( bAppended )
+      {
+         emit( RowsAppended(sFlightName, nRows) );
+      }
+   }
+
+   QSqlQuery* DataMgmt::GetInsertQuery( 
+      QSqlDatabase& db, 
+      FlightInsertMap& inserts, 
+      const DataBuffer& buffer )
+   {
+      FlightInsertMap::iterator i = inserts.find( buffer.sFlightName );
+      if( i != inserts.end() )
+      {
+         return &i.value();
+      }
+
+      // Build the statement from the column definitions of the flight.  Each
+      // good column takes a parameter in the same order as the ColumnDefList.
+      QString sQueryColumns = "INSERT INTO " + buffer.sFlightName + "(";
+      QString sQueryValues  = " VALUES(";
+      for( int c = 0; c < buffer.columns.size(); ++c )
+      {
+         if( buffer.columns.at(c).bGood )
+         {
+            sQueryColumns.append(buffer.columns.at(c).sParamNameComp);
+            sQueryColumns.append(",");
+            sQueryValues.append("?,");
+         }
+      }
+      sQueryColumns.replace(sQueryColumns.length()-1, 1, ')');
+      sQueryValues.replace (sQueryValues.length()-1, 1, ')');
+
+      QSqlQuery q(db);
+      if( !q.prepare(sQueryColumns + sQueryValues) )
+      {
+         cerr << "Unable to prepare insert for flight " << qPrintable(buffer.sFlightName) << endl;
+         cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+         return 0;
+      }
+
+      i = inserts.insert( buffer.sFlightName, q );
+      return &i.value();
+   }
+
+   void DataMgmt::InsertRows( 
+      QSqlDatabase& db, 
+      FlightInsertMap& inserts, 
+      const DataBuffer& buffer )
+   {
+      if( buffer.nRows == 0 )
+      {
+         return;
+      }
+
+      QSqlQuery* q = GetInsertQuery( db, inserts, buffer );
+      if( !q )
+      {
+         return;
+      }
+
+      // The values are bound a column at a time in batches of rows.  Values
+      // that weren't a number are bound as nulls.
+      const QVariant null(QVariant::Double);
+      QVariantList values;
+      for( int nFirst = 0; nFirst < buffer.nRows; nFirst += nTransactionSwitch )
+      {
+         int nLast = qMin( nFirst+nTransactionSwitch, buffer.nRows );
+         for( int c = 0; c < buffer.columns.size(); ++c )
+         {
+            if( !buffer.columns.at(c).bGood )
+            {
+               continue;
+            }
+
+            values.clear();
+            if( buffer.columns.at(c).eParamType == ParamType_String )
+            {
+               for( int r = nFirst; r < nLast; ++r )
+               {
+                  values.append( buffer.text.at(c).at(r) );
+               }
+            }
+            else
+            {
+               const NumericColumn& numeric = buffer.numeric.at(c);
+               for( int r = nFirst; r < nLast; ++r )
+               {
+                  double value = numeric.at(r);
+                  values.append( qIsNaN(value) ? null : QVariant(value) );
+               }
+            }
+            q->addBindValue( values );
+         }
+
+         if( !q->execBatch() )
+         {
+            cerr << "Insert failed for flight " << qPrintable(buffer.sFlightName) << endl;
+            cerr << "   Error Message: " << qPrintable(q->lastError().text()) << endl;
+         }
+      }
+   }
+
+   void DataMgmt::AppendColumns( const DataBuffer& buffer )
+   {
+      if( buffer.nRows == 0 )
+      {
+         return;
+      }
+
+      // The first buffer of the flight is the sample the type of each 
+      // numeric column is inferred from.  Later rows are validated as they
+      // are appended.  Columns that are already narrowed, e.g. from the 
+      // cache, are shared rather than copied.
+      DataBuffer& store = m_store[buffer.sFlightName];
+      int nFirst = store.nRows;
+      if( nFirst == 0 )
+      {
+         store.sFlightName = buffer.sFlightName;
+         store.columns     = buffer.columns;
+         store.text        = buffer.text;
+         store.nRows       = buffer.nRows;
+         store.numeric.resize( buffer.numeric.size() );
+         for( int i = 0; i < buffer.numeric.size(); ++i )
+         {
+            store.numeric[i] = buffer.numeric.at(i).Narrowed();
+         }
+
+         TimeIndex index;
+         index.bSorted  = true;
+         index.bMissing = false;
+         index.fMin     = qQNaN();
+         index.fMax     = qQNaN();
+         index.fLast    = qQNaN();
+         m_times[buffer.sFlightName] = index;
+      }
+      else
+      {
+         for( int i = 0; i < store.numeric.size(); ++i )
+         {
+            store.numeric[i].append( buffer.numeric.at(i) );
+         }
+         for( int i = 0; i < store.text.size(); ++i )
+         {
+            store.text[i] += buffer.text.at(i);
+         }
+         store.nRows += buffer.nRows;
+      }
+
+      // Only the new rows are checked for their range and order.
+      IndexTimes( store, nFirst, m_times[buffer.sFlightName] );
+   }
+
+   void DataMgmt::ApplyProfile( LoadProfile eProfile )
+   {
+      QStringList pragmas;
+      if( eProfile == LoadProfile_BulkLoad )
+      {
+         // Whatever the connection was set to is put back afterward rather 
+         // than assuming the defaults.
+         SaveSettings();
+
+         // A negative cache size is in KiB, i.e. 256 MiB of pages.
+         pragmas << "PRAGMA journal_mode = OFF"
+                 << "PRAGMA synchronous = OFF"
+                 << "PRAGMA cache_size = -262144"
+                 << "PRAGMA locking_mode = EXCLUSIVE";
+      }
+      else
+      {
+         // The exclusive lock is only released by the next access after the
+         // locking mode returns to normal.
+         pragmas = m_savedSettings;
+         pragmas << "SELECT COUNT(*) FROM sqlite_master";
+         m_savedSettings.clear();
+      }
+
+      QSqlQuery q(m_db);
+      for( int i = 0; i < pragmas.size(); ++i )
+      {
+         if( !q.exec(pragmas.at(i)) )
+         {
+            cerr << "Unable to apply database setting " << qPrintable(pragmas.at(i)) << endl;
+            cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+         }
+      }
+   }
+
+   void DataMgmt::SaveSettings()
+   {
+      static const char* settings[] = 
+      {
+         "journal_mode", "synchronous", "cache_size", "locking_mode"
+      };
+
+      m_savedSettings.clear();
+      QSqlQuery q(m_db);
+      for( size_t i = 0; i < sizeof(settings)/sizeof(settings[0]); ++i )
+      {
+         QString sSetting(settings[i]);
+         if( q.exec("PRAGMA " + sSetting) && q.next() )
+         {
+            m_savedSettings << "PRAGMA " + sSetting + " = " + q.value(0).toString();
+         }
+         else
+         {
+            cerr << "Unable to read database setting " << qPrintable(sSetting) << endl;
+            cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+         }
+      }
+   }
+
+   void DataMgmt::BeginFlight( const QString& sFlightName )
+   {
+      // Only the flights counted here hold the bulk load, e.g. not those 
+      // completing from the catalog or stored in shards.  The settings are
+      // read before the first of them switches to the bulk load.
+      m_loading.insert( sFlightName );
+      if( m_eLoadProfile == LoadProfile_BulkLoad && !m_bBulkLoading )
+      {
+         ApplyProfile( LoadProfile_BulkLoad );
+         m_bBulkLoading = true;
+      }
+   }
+
+   void DataMgmt::EndBulkLoad()
+   {
+      m_mutex.lock();
+      bool bDone = m_bBulkLoading && m_loading.isEmpty() && m_deferred.isEmpty();
+      if( bDone )
+      {
+         ApplyProfile( LoadProfile_Safe );
+         m_bBulkLoading = false;
+      }
+      m_mutex.unlock();
+   }
+
+   void DataMgmt::CreateIndexes( 
+      QSqlDatabase& db, 
+      const QString& sFlightName, 
+      const ColumnDefList& defList )
+   {
+      // Flight data is looked up by time.
+      if( FindColumn( defList, TimeColumn ) < 0 )
+      {
+         return;
+      }
+
+      QSqlQuery q(db);
+      QString sQuery = QString("CREATE INDEX IF NOT EXISTS %1_%2 ON %1(%2)")
+         .arg(sFlightName).arg(TimeColumn);
+      if( !q.exec(sQuery) )
+      {
+         cerr << "Unable to index flight " << qPrintable(sFlightName) << endl;
+         cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+      }
+   }
+
+   void DataMgmt::CreateDeferredIndexes( const QString& sFlightName )
+   {
+      FlightColumnMap::iterator i = m_unindexed.find( sFlightName );
+      if( i != m_unindexed.end() )
+      {
+         CreateIndexes( m_db, sFlightName, i.value() );
+         m_unindexed.erase( i );
+      }
+   }
+
+   bool DataMgmt::TakeDeferred( QString& sFlightName )
+   {
+      m_mutex.lock();
+      bool bDeferred = !m_deferred.isEmpty();
+      if( bDeferred )
+      {
+         sFlightName = m_deferred.takeFirst();
+      }
+      m_mutex.unlock();
+
+      return bDeferred;
+   }
+
+   void DataMgmt::PopulateTable( const QString& sFlightName )
+   {
+      // The columns are shared rather than copied so the lock is only held
+      // long enough to find them.
+      m_mutex.lock();
+      DataBuffer store = m_store.value( sFlightName );
+      m_mutex.unlock();
+
+      m_db.transaction();
+      InsertRows( m_db, m_inserts, store );
+      CreateDeferredIndexes( sFlightName );
+      m_db.commit();
+   }
+
+   void DataMgmt::StoreDeferred( const QString& sFlightName )
+   {
+      PopulateTable( sFlightName );
+      QString sHash = CatalogHash( sFlightName );
+      m_mutex.lock();
+      RecordCatalog( sFlightName, sHash );
+      m_mutex.unlock();
+      EndBulkLoad();
+   }
+
+   void DataMgmt::GatherStatistics( const DataBuffer& buffer )
+   {
+      if( buffer.nRows == 0 )
+      {
+         return;
+      }
+
+      // The pyramids take the rows in the order they arrive.  Rows that are
+      // later put in time order stay in the same buckets, whose times are 
+      // taken from the pyramid of the time column.
+      if( m_bPyramids )
+      {
+         QVector<ColumnPyramid>& pyramids = m_pyramids[buffer.sFlightName];
+         pyramids.resize( buffer.columns.size() );
+         for( int i = 0; i < buffer.columns.size(); ++i )
+         {
+            if( buffer.columns.at(i).bGood && 
+                buffer.columns.at(i).eParamType == ParamType_Numeric &&
+                i < buffer.numeric.size() )
+            {
+               pyramids[i].Append( buffer.numeric.at(i) );
+            }
+         }
+      }
+
+      // A flight from the cache arrives in one buffer along with its 
+      // statistics.
+      if( buffer.bFirstBuffer && buffer.bLastBuffer && m_stats.contains(buffer.sFlightName) )
+      {
+         return;
+      }
+      UpdateStatistics( m_stats[buffer.sFlightName], buffer );
+   }
+
+   void DataMgmt::UpdateTimeRange( QSqlQuery& q, const DataBuffer& buffer, bool bAppended )
+   {
+      double fMin = qQNaN();
+      double fMax = qQNaN();
+      FlightTimeIndex::const_iterator t = m_times.constFind( buffer.sFlightName );
+      if( bAppended )
+      {
+         // Only the new rows can extend the range.
+         GetTimeRange( buffer, fMin, fMax );
+      }
+      else if( t != m_times.constEnd() )
+      {
+         // The flight is held in columns so its range was kept as it loaded.
+         fMin = t.value().fMin;
+         fMax = t.value().fMax;
+      }
+      else
+      {
+         bool bSuccess = false;
+         QString sQuery = QString("SELECT MAX(%1) FROM ").arg(TimeColumn) + buffer.sFlightName;
+         if( q.exec(sQuery) && q.next() )
+         {
+            double fTime = q.record().field(0).value().toDouble(&bSuccess);
+            if( bSuccess )
+            {
+               fMax = fTime;
+            }
+         }
+         sQuery = QString("SELECT MIN(%1) FROM ").arg(TimeColumn) + buffer.sFlightName;
+         if( q.exec(sQuery) && q.next() )
+         {
+            double fTime = q.record().field(0).value().toDouble(&bSuccess);
+            if( bSuccess )
+            {
+               fMin = fTime;
+            }
+         }
+      }
+
+      if( !qIsNaN(fMax) )
+      {
+         unsigned int nTime = fMax * HoursTo100MicroSeconds;
+         if( m_flightMeta._uGlobalMaxTime < nTime )
+         {
+            m_flightMeta._uGlobalMaxTime = nTime;
+         }
+      }
+      if( !qIsNaN(fMin) )
+      {
+         unsigned int nTime = fMin * HoursTo100MicroSeconds;
+         if( m_flightMeta._uGlobalMinTime > nTime )
+         {
+            m_flightMeta._uGlobalMinTime = nTime;
+         }
+      }
+   }
+
+   bool DataMgmt::TakeRestoredEvents( const QString& sFlightName )
+   {
+      m_mutex.lock();
+      bool bRestored = m_restored.remove( sFlightName );
+      m_mutex.unlock();
+      return bRestored;
+   }
+
+   bool DataMgmt::IsStopping() const
+   {
+      return isRunning() && m_bStop;
+   }
+
+   void DataMgmt::stopProcessing()
    {
       m_mutex.lock();
       m_bStop = true;
+      for( int i = 0; i < m_shards.size(); ++i )
+      {
+         m_shards.at(i)->Stop();
+      }
       m_mutex.unlock();
 
       cout << "Overall min time=" << m_flightMeta._uGlobalMinTime << endl;
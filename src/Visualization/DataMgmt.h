@@ -20,19 +20,60 @@
 #include <QThread>
 
 #include <QStringList>
+#include <QVector>
 #include <QMap>
+#include <QSet>
+#include <QFutureSynchronizer>
 
 #include <QSqlDatabase>
+#include <QSqlQuery>
 
 #include "DataTypes.h"
 #include "DataQueue.h"
+#include "DataBufferPool.h"
+#include "FlightCatalog.h"
+#include "ResultCache.h"
+#include "AttributeCursor.h"
+#include "LevelOfDetail.h"
 
 
 namespace Data
 {
+   class ShardWriter;
+
    //! Defines a type to store the column definitions for each flight.
    typedef QMap<QString, Data::ColumnDefList> FlightColumnMap;
 
+   //! Defines a type to store the prepared insert statement of each flight.
+   typedef QMap<QString, QSqlQuery> FlightInsertMap;
+
+   //! Defines a type to store the values of each flight a column at a time.
+   typedef QMap<QString, Data::DataBuffer> FlightColumnStore;
+
+   //! Defines a type to store the statistics of each column of each flight.
+   typedef QMap<QString, QList<Data::Metadata> > FlightStatistics;
+
+   //! Defines a type to store the pyramid of each column of each flight, 
+   //! empty for string columns.
+   typedef QMap<QString, QVector<Data::ColumnPyramid> > FlightPyramids;
+
+   //! Range and order of the times of a flight held in columns.  It is kept
+   //! up to date as rows are appended so the times are never looked up in 
+   //! the database.  The rows are in time order when the times increase 
+   //! and any rows without a time are last, which is when a window of time
+   //! is found with a binary search.
+   struct TimeIndex
+   {
+      bool   bSorted;  //!< Flag indicating the rows are in time order
+      bool   bMissing; //!< Flag indicating a row without a time was appended
+      double fMin;     //!< Earliest time, NaN if there are none
+      double fMax;     //!< Latest time, NaN if there are none
+      double fLast;    //!< Time of the last row that has one, NaN if none do
+   };
+
+   //! Defines a type to store the time index of each flight held in columns.
+   typedef QMap<QString, Data::TimeIndex> FlightTimeIndex;
+
    //! Class to abstract the storage and access of the data from the rest of the 
    //! application.  This allows the application some freedom from the underlying
    //! data storage implementation.
@@ -45,6 +86,31 @@ namespace Data
       //! before a commit is called.
       static const int nTransactionSwitch;
 
+      //! Maximum number of shards, the number of databases SQLite attaches
+      //! to a connection by default.
+      static const int nMaxShards;
+
+      //! Most data rows ProcessHeader() looks at to work out whether each 
+      //! column is numeric or text.
+      static const int nTypeSampleRows;
+
+      //! Enumeration of the ways parsed values are stored.
+      enum IngestMode
+      {
+         IngestMode_Database, //!< Rows are inserted into the database as they arrive
+         IngestMode_Columns,  //!< Values are only kept in memory, a column at a time
+         IngestMode_Deferred  //!< Values are kept in columns and inserted into the
+                              //!< database once nothing else is queued
+      };
+
+      //! Enumeration of the database settings used while flights load.
+      enum LoadProfile
+      {
+         LoadProfile_Safe,    //!< Default settings, journaled and synchronous
+         LoadProfile_BulkLoad //!< No journal or syncs, large cache and exclusive
+                              //!< locking until every loading flight completes
+      };
+
       DataMgmt( );
       ~DataMgmt();
 
@@ -56,6 +122,58 @@ namespace Data
       //! @param sConnectionName Name of the database that this manager will use
       bool Connect( const QString& sConnectionName );
 
+      //! Selects how parsed values are stored.  This should be set before 
+      //! any flights are loaded.  In the column modes the flight's table is
+      //! still created but rows are only inserted in IngestMode_Deferred.
+      //! @param eMode  Ingest mode to use
+      void SetIngestMode( IngestMode eMode );
+
+      //! Returns the ingest mode in use.
+      IngestMode GetIngestMode() const;
+
+      //! Converts the name of an ingest mode, e.g. from the command line.
+      //! @param sMode  One of "database", "columns" or "deferred"
+      //! @param eMode  Ingest mode named
+      //! @retval true  If the name is known
+      //! @retval false Otherwise
+      static bool ParseIngestMode( const QString& sMode, IngestMode& eMode );
+
+      //! Selects the database settings used while flights are loading.  With
+      //! LoadProfile_BulkLoad the flight indexes are created once the rows 
+      //! are in and the earlier settings return when no flights are loading.
+      //! A crash during a bulk load can leave the database unusable.
+      //! @param eProfile  Profile to use for subsequent loads
+      void SetLoadProfile( LoadProfile eProfile );
+
+      //! Returns the load profile in use.
+      LoadProfile GetLoadProfile() const;
+
+      //! Spreads the flights over a number of shards, each a database file
+      //! with a writer thread of its own, so that flights loading at the 
+      //! same time are committed in parallel.  The shard files are attached
+      //! to the database, so flights are read the same as before.  A flight
+      //! always goes to the same shard, so the number of shards should stay
+      //! the same for a database on disk.  Shards are only used in 
+      //! IngestMode_Database.  Call once after Connect() and 
+      //! SetLoadProfile() and before any flights are loaded.
+      //! @param nShards  Number of shards, up to nMaxShards
+      //! @retval true  If every shard was attached
+      //! @retval false Otherwise
+      bool SetShards( int nShards );
+
+      //! Returns the number of shards, 0 if flights are stored in the 
+      //! database itself.
+      int GetShards() const;
+
+      //! Bounds the queue of parsed buffers waiting to be stored.  Parsers
+      //! wait once it is full, see DataQueue.
+      //! @param nMaxBuffers  Maximum number of buffers, 0 for no limit
+      //! @param llMaxBytes   Maximum number of bytes, 0 for no limit
+      void SetQueueCapacity( int nMaxBuffers, qint64 llMaxBytes );
+
+      //! Returns how full the queue of parsed buffers has been.
+      DataQueue::Statistics GetQueueStatistics() const;
+
       //! Initializes the columns that will be available in the data.  The
       //! method takes in a list of header names and a sample datum in order
       //! to figure out their data type.
@@ -73,6 +191,21 @@ namespace Data
          const QStringList& hdr,
          const QStringList& data );
 
+      //! Initializes the columns from a header row and the first rows of 
+      //! data referenced in place, e.g. in a memory mapped file.  A column
+      //! is text if any of the rows has a non-numeric value in it, empty 
+      //! values are not counted either way.  Rows that do not have as many
+      //! fields as the header are not sampled.
+      //! @param sFlightName Unique identifier for the flight
+      //! @param hdr      Column names in the data
+      //! @param samples  Up to nTypeSampleRows rows of data, the first of 
+      //!                 which must match the header
+      //! @see ProcessHeader(const QString&, const QStringList&, const QStringList&)
+      bool ProcessHeader( 
+         const QString& sFlightName,
+         const RowSpans& hdr,
+         const QVector<RowSpans>& samples );
+
       //! Process the provided string list according to the data calculated in
       //! ProcessHeader().
       //! @param sFlightName Unique identifier for the flight
@@ -82,16 +215,57 @@ namespace Data
          const QStringList& data,
          DataBuffer& buffer );
 
+      //! Process a row referenced in place according to the data calculated
+      //! in ProcessHeader().  The row does not need to outlive the call.
+      //! @param sFlightName Unique identifier for the flight
+      //! @param data  Row of data to process and commit to data storage.
+      void ProcessData( 
+         const QString& sFlightName,
+         const RowSpans& data,
+         DataBuffer& buffer );
+
+      //! Converts a row into the buffer the same as ProcessData() but never 
+      //! commits the buffer, leaving that to the caller.  Nothing is shared
+      //! between calls so rows may be converted on several threads as long
+      //! as each has its own buffer.
+      //! @param defList Column definitions from GetColumnDefinitions()
+      //! @param data    Row of data to convert
+      //! @param buffer  Buffer to which the row is added
+      //! @retval true  If the row was added
+      //! @retval false Otherwise
+      static bool AppendData( 
+         const ColumnDefList& defList,
+         const RowSpans& data,
+         DataBuffer& buffer );
+
       //! Indicates that there is no more data to process for the data.  This 
       //! will commit any outstanding transactions to the underlying storage and
-      //! make it available for data processing.
+      //! make it available for data processing.  The contents of the buffer
+      //! are handed over and it is replaced by an empty one from the pool.
       void Commit(DataBuffer& buffer);
 
+      //! Indicates a flight whose header was processed will not get its last
+      //! buffer, e.g. its parse failed or was stopped.  The rows committed 
+      //! so far are kept but the flight never completes.
+      //! @param sFlightName  Unique identifier for the flight
+      void AbortFlight( const QString& sFlightName );
+
+      //! Replaces a buffer with an empty one from the pool, see Commit().
+      void AcquireBuffer( DataBuffer& buffer );
+
+      //! Returns a buffer that won't be committed to the pool.
+      void ReleaseBuffer( DataBuffer& buffer );
+
+      //! Returns how often the pool had a buffer ready.
+      DataBufferPool::Statistics GetPoolStatistics() const;
+
 
       //! Gets the column definitions that are currently available through this
-      //! DataMgmt object.
+      //! DataMgmt object.  A copy is returned since a later load of the 
+      //! flight replaces them.
       //! @param sFlightName  The name of the flight whose columns should be returned.
-      const ColumnDefList& GetColumnDefinitions(const QString& sFlightName) const;
+      //! @return The columns of the flight, empty if it has none
+      ColumnDefList GetColumnDefinitions(const QString& sFlightName) const;
 
       //! Provides a list of the currently loaded flights.
       //! @param flights List that each flight name will be added.
@@ -111,6 +285,83 @@ namespace Data
           const QStringList& attributes,
           Data::Buffer& data );
 
+      //! Retrieves the data of the attributes within a window of time, in 
+      //! time order.  The rows are found through the flight's time index 
+      //! so only the rows in the window are read.  The statistics cover the
+      //! rows returned.
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to add
+      //! @param uBegin      First time of the window, in the units of Buffer::_times
+      //! @param uEnd        Time the window ends before, in the units of Buffer::_times
+      //! @param data        Buffer of data to which the requested parameters are added.
+      //! @param nStride     Only every nStride-th row in the window is added
+      //! @retval true  If the operation succeeds entirely
+      //! @retval false If any portion of the operation fails.
+      bool GetDataAttributes(
+          const QString& sFlight,
+          const QStringList& attributes,
+          unsigned int uBegin,
+          unsigned int uEnd,
+          Data::Buffer& data,
+          int nStride = 1 );
+
+      //! Opens a cursor that reads the attributes of a flight a block of rows
+      //! at a time, rather than all of them at once like GetDataAttributes().
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to read
+      //! @param cursor      Cursor to open, closing what it was reading
+      //! @param nBlockRows  Most rows in a block
+      //! @retval true  If the cursor was opened
+      //! @retval false If the flight or an attribute isn't available
+      bool OpenCursor(
+          const QString& sFlight,
+          const QStringList& attributes,
+          AttributeCursor& cursor,
+          int nBlockRows = AttributeCursor::nDefaultBlockRows );
+
+      //! Opens a cursor on the rows within a window of time, in time order.
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to read
+      //! @param uBegin      First time of the window, in the units of Buffer::_times
+      //! @param uEnd        Time the window ends before, in the units of Buffer::_times
+      //! @param cursor      Cursor to open, closing what it was reading
+      //! @param nStride     Only every nStride-th row in the window is read
+      //! @param nBlockRows  Most rows in a block
+      //! @retval true  If the cursor was opened
+      //! @retval false If the flight or an attribute isn't available
+      bool OpenCursor(
+          const QString& sFlight,
+          const QStringList& attributes,
+          unsigned int uBegin,
+          unsigned int uEnd,
+          AttributeCursor& cursor,
+          int nStride = 1,
+          int nBlockRows = AttributeCursor::nDefaultBlockRows );
+
+      //! Retrieves the data of the attributes with every value normalized to
+      //! the range 0 to 1 using the statistics of the flight's values.
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to add
+      //! @param data        Buffer of data to which the requested parameters are added.
+      //! @retval true  If the operation succeeds entirely
+      //! @retval false If any portion of the operation fails.
+      bool GetNormalizedAttributes(
+          const QString& sFlight,
+          const QStringList& attributes,
+          Data::Buffer& data );
+
+      //! Returns how often attribute queries were answered by the result 
+      //! cache and how much it holds.
+      ResultCache::Statistics GetResultCacheStatistics() const;
+
+      //! Sets the maximum number of bytes held by the result cache, zero to
+      //! not keep query results.
+      void SetResultCacheCapacity( qint64 llMaxBytes );
+
+      //! Sets whether the pyramids of the columns are built as flights load,
+      //! see GetEnvelope().  They're built by default.
+      void SetPyramids( bool bPyramids );
+
       //! Sets event definition
       void SetEventDefinition( const EventDefinition& evtDef );
 
@@ -124,16 +375,129 @@ namespace Data
 
       //! Gets the metadata structure for all loaded flights.
       const LoadedFlightMetaInfo& GetLoadedFlightMetaInfo() const;
+
+      //! Provides the statistics of every column of a flight, gathered as its
+      //! rows were stored or kept with it in the cache or catalog.  The 
+      //! statistics of string columns are left at zero.
+      //! @param sFlightName  Name of the flight
+      //! @param stats        Statistics in the order of the column definitions
+      //! @retval true  If the flight has statistics
+      //! @retval false Otherwise
+      bool GetColumnStatistics( const QString& sFlightName, QList<Metadata>& stats ) const;
+
+      //! Provides the range of the values of attributes over each of a number
+      //! of equal spans of a window of time, e.g. one per pixel of a view.  
+      //! The range is found from the pyramids built as the flight's rows were
+      //! stored, so a long window is summarized without reading its rows.  
+      //! Windows too short for the pyramids, and flights without them, e.g.
+      //! those from the catalog, are summarized from their rows.
+      //! @param sFlightName  Name of the flight
+      //! @param attributes   Numeric attributes of the flight
+      //! @param uBegin       First time of the window, in the units of Buffer::_times
+      //! @param uEnd         Time the window ends before, in the units of Buffer::_times
+      //! @param nSpans       Number of spans the window is divided into
+      //! @param envelope     Receives the range of each attribute in each span
+      //! @retval true  If the operation succeeds
+      //! @retval false If the flight or an attribute isn't available
+      bool GetEnvelope(
+         const QString& sFlightName,
+         const QStringList& attributes,
+         unsigned int uBegin,
+         unsigned int uEnd,
+         int nSpans,
+         Envelope& envelope );
+
+      //! Returns the number of rows stored for a flight, from its columns or
+      //! its table.
+      //! @param sFlightName  Name of the flight
+      qint64 GetRowCount( const QString& sFlightName ) const;
+
+      //! Loads a flight from its cache file rather than parsing it.  The 
+      //! flight completes the same as a parsed one, with its events already
+      //! set from the cache.
+      //! @param sCacheFile   Path of the cache file, see FlightCache::CacheFile()
+      //! @param sFlightName  Unique identifier for the flight
+      //! @retval true  If the flight was read from the cache
+      //! @retval false If there is no valid cache and the flight must be parsed
+      bool LoadCache( const QString& sCacheFile, const QString& sFlightName );
+
+      //! Writes a completed flight and its events to a cache file.  Only 
+      //! flights held in columns can be cached.  The file is written on the
+      //! global thread pool and CacheSaved() is emitted once it's done.
+      //! @param sCacheFile   Path of the cache file, see FlightCache::CacheFile()
+      //! @param sFlightName  Unique identifier for the flight
+      //! @retval true  If the cache is being written
+      //! @retval false If the flight can't be cached
+      bool SaveCache( const QString& sCacheFile, const QString& sFlightName );
+
+      //! Keeps a catalog of the flights in the database so that later 
+      //! sessions use them as they are, see FlightCatalog.  Call after 
+      //! Connect() with a database on disk.  Flights are only recorded in
+      //! the ingest modes that insert their rows.
+      //! @retval true  If the catalog is available
+      //! @retval false Otherwise
+      bool OpenCatalog();
+
+      //! Uses a flight from the catalog rather than loading it.  The flight
+      //! completes the same as a loaded one, with its events set if they 
+      //! were recorded.  Otherwise the flight is removed from the catalog 
+      //! and recorded again once it has been loaded.  A changed file may be
+      //! read in full, so call this from a worker, e.g. the ingest job.
+      //! @param sSourceFile  Path of the CSV file of the flight
+      //! @param sFlightName  Unique identifier for the flight
+      //! @retval true  If the flight is in the database and unchanged
+      //! @retval false If the flight must be loaded
+      bool LoadCatalog( const QString& sSourceFile, const QString& sFlightName );
+
+      //! Indicates the events of a flight were restored from the catalog or
+      //! its cache when it was loaded, so they needn't be detected again.  
+      //! The indication is cleared, it's only given once per load.
+      //! @param sFlightName  Unique identifier for the flight
+      bool TakeRestoredEvents( const QString& sFlightName );
+
+      //! Indicates stopProcessing() was called and the thread has yet to 
+      //! finish.  Wait for it before starting the thread again.
+      bool IsStopping() const;
       
    public slots:
       //! Slot to handle an interrupt signal.  This will stop the data processing.
       void stopProcessing();
 
+   public:
+      //! Inserts the rows held in the value columns of the buffer.
+      //! @param db       Database holding the flight's table
+      //! @param inserts  Prepared insert statements of the flights in db
+      //! @param buffer   Buffer containing the rows
+      static void InsertRows( 
+         QSqlDatabase& db, 
+         FlightInsertMap& inserts, 
+         const DataBuffer& buffer );
+
+      //! Creates the indexes of a flight table.
+      //! @param db           Database holding the flight's table
+      //! @param sFlightName  Name of the flight
+      //! @param defList      Columns of the flight
+      static void CreateIndexes( 
+         QSqlDatabase& db, 
+         const QString& sFlightName, 
+         const ColumnDefList& defList );
+
    signals:
       //! Signal sent when the last queue entry for a flight has been processed.
       //! @param sFileName Provides the file that was parsed.
       void FlightComplete(QString sFileName);
 
+      //! Signal sent when rows are added to a flight that has already 
+      //! completed, e.g. a recording that is being followed.
+      //! @param sFlightName  Name of the flight
+      //! @param nRows        Number of rows that were added
+      void RowsAppended(QString sFlightName, int nRows);
+
+      //! Signal sent when a cache file started by SaveCache() is written.
+      //! @param sFlightName  Name of the flight
+      //! @param bSaved       True if the file was written
+      void CacheSaved(QString sFlightName, bool bSaved);
+
       //! Emits the range of progress increments that will be reported during
       //! parsing of the file by setCurrentProgress() signal.
       //! @param min  First number reported as 0% progress.
@@ -149,15 +513,218 @@ namespace Data
       //! The threaded functionality.
       void run();
 
+      //! Saves the column definitions of a flight and adds the statements 
+      //! creating its table to the first buffer of the flight.
+      //! @param sFlightName  Unique identifier for the flight
+      //! @param defList      Columns of the flight
+      //! @param buffer       First buffer of the flight
+      void StartFlight( 
+         const QString& sFlightName,
+         const ColumnDefList& defList,
+         DataBuffer& buffer );
+
+      //! Returns the insert statement of the buffer's flight, preparing it 
+      //! the first time it is used.
+      //! @param db       Database holding the flight's table
+      //! @param inserts  Prepared insert statements of the flights in db
+      //! @param buffer   Buffer providing the flight and its columns
+      //! @return The prepared statement or null if it cannot be prepared
+      static QSqlQuery* GetInsertQuery( 
+         QSqlDatabase& db, 
+         FlightInsertMap& inserts, 
+         const DataBuffer& buffer );
+
+      //! Hands a buffer to the writer of the flight's shard if flights are
+      //! sharded.  The buffer is left empty when it is handed over.
+      //! @param buffer  Buffer taken from the queue
+      //! @retval true  If the shard's writer stores the buffer
+      //! @retval false If the buffer is stored in the database itself
+      bool StoreInShard( DataBuffer& buffer );
+
+      //! Appends the rows held in the buffer to the flight's columns.
+      //! @param buffer  Buffer containing the rows
+      void AppendColumns( const DataBuffer& buffer );
+
+      //! Applies the database settings of a profile.  This must not be 
+      //! called within a transaction.  Applying LoadProfile_Safe puts back
+      //! the settings saved when the bulk load was applied.
+      //! @param eProfile  Profile to apply
+      void ApplyProfile( LoadProfile eProfile );
+
+      //! Reads the database settings the bulk load changes so that they can
+      //! be restored once it ends.
+      void SaveSettings();
+
+      //! Tracks a flight that started loading, switching to the bulk load 
+      //! settings if they were selected.
+      //! @param sFlightName  Name of the flight
+      void BeginFlight( const QString& sFlightName );
 
+      //! Returns to the settings in place before the bulk load once no 
+      //! flights are loading.
+      void EndBulkLoad();
+
+      //! Writes a cache file on a worker thread, see SaveCache().
+      void WriteCache( 
+         QString sCacheFile, 
+         QString sFlightName,
+         DataBuffer store,
+         QList<Metadata> stats,
+         EventData events );
+
+      //! Creates the indexes that were held back for a flight during a bulk 
+      //! load, if there are any.
+      //! @param sFlightName  Name of the flight
+      void CreateDeferredIndexes( const QString& sFlightName );
+
+      //! Takes the next flight waiting to be inserted into the database.
+      //! @param sFlightName  Name of the flight
+      //! @retval true  If a flight was waiting
+      //! @retval false Otherwise
+      bool TakeDeferred( QString& sFlightName );
+
+      //! Inserts the rows of a flight held in columns into its table.
+      //! @param sFlightName  Name of the flight
+      void PopulateTable( const QString& sFlightName );
+
+      //! Inserts a deferred flight into its table and records it in the 
+      //! catalog, ending the bulk load once nothing else is waiting.
+      //! @param sFlightName  Name of the flight
+      void StoreDeferred( const QString& sFlightName );
+
+      //! Finds the hash of the source file of a flight waiting to be 
+      //! cataloged.  A changed file is read in full, so call this without 
+      //! holding m_mutex.
+      //! @param sFlightName  Name of the flight
+      //! @return Hash of the file, empty if the flight isn't waiting
+      QString CatalogHash( const QString& sFlightName );
+
+      //! Records a flight in the catalog if it was waiting for all of its 
+      //! rows to be in its table.  The caller must hold m_mutex.
+      //! @param sFlightName  Name of the flight
+      //! @param sHash        Hash of the source file, see CatalogHash()
+      void RecordCatalog( const QString& sFlightName, const QString& sHash );
+
+      //! Updates the global time range with the times of a flight.
+      //! @param q          Query on the flight database
+      //! @param buffer     Buffer of the flight that was processed
+      //! @param bAppended  True to only use the rows of the buffer, which are
+      //!                   being appended to a completed flight
+      void UpdateTimeRange( QSqlQuery& q, const DataBuffer& buffer, bool bAppended );
+
+      //! Retrieves the data of the attributes of a flight from the result 
+      //! cache, querying the flight and keeping the result if it isn't held.
+      //! Only results of completed flights are kept.
+      //! @param bNormalized True to normalize the values, see GetNormalizedAttributes()
+      //! @see QueryAttributes()
+      bool CachedAttributes(
+          const QString& sFlight,
+          const QStringList& attributes,
+          bool bWindow,
+          unsigned int uBegin,
+          unsigned int uEnd,
+          int nStride,
+          bool bNormalized,
+          Data::Buffer& data );
+
+      //! Retrieves the data of the attributes of a flight, from its columns
+      //! or its table, see GetDataAttributes().
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to add
+      //! @param bWindow     True to only add the rows within [uBegin, uEnd)
+      //! @param uBegin      First time of the window
+      //! @param uEnd        Time the window ends before
+      //! @param nStride     Only every nStride-th row is added
+      //! @param data        Buffer of data to which the requested parameters are added.
+      //! @retval true  If the operation succeeds entirely
+      //! @retval false If any portion of the operation fails.
+      bool QueryAttributes(
+          const QString& sFlight,
+          const QStringList& attributes,
+          bool bWindow,
+          unsigned int uBegin,
+          unsigned int uEnd,
+          int nStride,
+          Data::Buffer& data );
+
+      //! Opens a cursor on the attributes of a flight, see OpenCursor().
+      //! @param sFlight     The unique identifier for the flight.
+      //! @param attributes  List of attributes to read
+      //! @param bWindow     True to only read the rows within [uBegin, uEnd)
+      //! @param uBegin      First time of the window
+      //! @param uEnd        Time the window ends before
+      //! @param nStride     Only every nStride-th row is read
+      //! @param nBlockRows  Most rows in a block
+      //! @param cursor      Cursor to open
+      //! @retval true  If the cursor was opened
+      //! @retval false Otherwise
+      bool PrepareCursor(
+          const QString& sFlight,
+          const QStringList& attributes,
+          bool bWindow,
+          unsigned int uBegin,
+          unsigned int uEnd,
+          int nStride,
+          int nBlockRows,
+          AttributeCursor& cursor );
+
+      //! Provides the statistics of attributes of a completed flight that 
+      //! were gathered as it loaded.
+      //! @param sFlightName  Name of the flight
+      //! @param attributes   Numeric attributes of the flight
+      //! @param stats        Statistics in the order of the attributes
+      //! @retval true  If every attribute has statistics
+      //! @retval false Otherwise, leaving stats empty
+      bool GetStoredStatistics( 
+         const QString& sFlightName, 
+         const QStringList& attributes,
+         QList<Metadata>& stats ) const;
+
+      //! Adds the rows of a buffer to the statistics and pyramids of its 
+      //! flight.  The caller must hold m_mutex.
+      //! @param buffer  Buffer taken from the queue
+      void GatherStatistics( const DataBuffer& buffer );
+
+   protected slots:
+      //! Completes a flight, or reports its appended rows, once a shard's 
+      //! writer has committed a buffer of it.  This runs on the writer's 
+      //! thread.
+      //! @param sFlightName  Name of the flight
+      //! @param nRows        Number of rows that were added
+      //! @param bLastBuffer  True if the flight is complete
+      void ShardStored(QString sFlightName, int nRows, bool bLastBuffer);
+
+   protected:
       mutable QMutex  m_mutex;           //!< Mutex for thread safety
       FlightColumnMap m_columns;         //!< List of the data management by this object
       QSqlDatabase    m_db;              //!< Database being used by this class (move to pimpl)
       QString         m_sConnectionName; //!< Connection name for referencing the data
       Data::DataQueue m_queue;           //!< Queue containing parsed flight data
+      DataBufferPool  m_pool;            //!< Emptied buffers for the parsers to fill
       bool            m_bStop;           //!< Flag indicating that parsing should stop
       int             m_nProcessed;      //!< Running count of the buffers processed.
       QStringList     m_loadedFlights;   //!< List of flights that have completed loading
+      IngestMode      m_eIngestMode;     //!< How parsed values are stored
+      FlightColumnStore m_store;         //!< Values of each flight held in columns
+      FlightTimeIndex m_times;           //!< Time range and order of each flight in m_store
+      QStringList     m_deferred;        //!< Flights waiting to be inserted into the database
+      FlightInsertMap m_inserts;         //!< Prepared insert statement of each flight
+      LoadProfile     m_eLoadProfile;    //!< Settings selected for loading flights
+      bool            m_bBulkLoading;    //!< Flag indicating the bulk load settings are applied
+      QStringList     m_savedSettings;   //!< Statements restoring the settings from before the bulk load
+      QSet<QString>   m_loading;         //!< Flights that have started but not completed
+      QSet<QString>   m_restored;        //!< Loaded flights whose events were restored
+      FlightColumnMap m_unindexed;       //!< Flights whose indexes wait on the load completing
+      FlightStatistics m_stats;          //!< Statistics of each column of each flight
+      FlightPyramids  m_pyramids;        //!< Pyramid of each column of each flight
+      bool            m_bPyramids;       //!< Flag indicating pyramids are built
+      FlightCatalog   m_catalog;         //!< Flights kept in the database across sessions
+      QMap<QString,QString> m_sources;   //!< Source file of each flight waiting to be cataloged
+      QList<ShardWriter*> m_shards;      //!< Writer of each shard, empty if flights aren't sharded
+      QMap<QString,int> m_shardOf;       //!< Shard holding each flight stored in one
+      bool            m_bTempShards;     //!< Flag indicating the shard files are removed on exit
+      ResultCache     m_results;         //!< Results of attribute queries on completed flights
+      QFutureSynchronizer<void> m_cacheWrites; //!< Cache files being written
 
       EventDatabase   m_evtDb;           //!< Event data mapped to each flight.
 
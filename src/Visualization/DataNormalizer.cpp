@@ -15,8 +15,6 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <iostream>
-
 #include "DataNormalizer.h"
 
 
@@ -45,26 +43,20 @@ namespace Data
 
    bool Normalizer::Process( Data::Buffer& data )
    {
-      bool bSuccess;
-
-      // Normalize the data so that it is in the range 0-1.
-      for( int i = 0; i < data._params.size(); ++i )
+      // Normalize the data so that it is in the range 0-1, one attribute at
+      // a time.  Missing values stay missing.
+      int nRows = data.RowCount();
+      int nAttr = qMin( data.AttributeCount(), data._metadata.size() );
+      for( int j = 0; j < nAttr; ++j )
       {
          // Then, update all the data by compressing it into the range 0-1.
          //! @todo I don't believe this will handle negative values.
-         for( int j = 0; j < data._params[i]._dataVector.size(); ++j )
+         double  fMin    = data._metadata.at(j)._min;
+         double  fRange  = data._metadata.at(j)._range;
+         double* pValues = data.Values(j);
+         for( int i = 0; i < nRows; ++i )
          {
-            double d = data._params[i]._dataVector[j].toDouble(&bSuccess);
-            if( bSuccess )
-            {
-               data._params[i]._dataVector[j] = 
-                  ( d - data._metadata[j]._min) / data._metadata[j]._range;
-            }
-            else
-            {
-               std::cerr << "Error processing data." << std::endl;
-               data._params[i]._dataVector[j] = data._metadata[j]._min;
-            }
+            pValues[i] = (pValues[i] - fMin) / fRange;
          }
       }
 
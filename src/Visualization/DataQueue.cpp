@@ -17,6 +17,8 @@
 
 #include <iostream>
 
+#include <QTime>
+
 #include "DataQueue.h"
 
 using namespace std;
@@ -24,59 +26,354 @@ using namespace std;
 
 namespace Data
 {
+   // Enough buffers to keep the consumer busy while several parsers run.
+   const int DataQueue::nDefaultMaxBuffers = 256;
+   const qint64 DataQueue::llDefaultMaxBytes = 256*1024*1024;
+
+   // Bytes are counted in kilobytes so that the count fits an atomic int.
+   const qint64 llKilobyte = 1024;
+
+   static int ToKilobytes( qint64 llBytes )
+   {
+      return static_cast<int>( (llBytes + llKilobyte - 1) / llKilobyte );
+   }
+
+   // Loads an atomic with acquire ordering.  Qt 4 only offers ordering on 
+   // the read-modify-write operations.
+   static int LoadAcquire( QAtomicInt& nValue )
+   {
+      return nValue.fetchAndAddAcquire( 0 );
+   }
+
+   // Raises a high water mark to a new value if it is higher.
+   static void RaiseHighWater( QAtomicInt& nHighWater, int nValue )
+   {
+      int nCurrent = nHighWater;
+      while( nValue > nCurrent && !nHighWater.testAndSetRelaxed(nCurrent, nValue) )
+      {
+         nCurrent = nHighWater;
+      }
+   }
    
    // ==========================================================================
    // ==========================================================================
    DataQueue::DataQueue( )
+      : m_nMask(0)
+      , m_nEnqueuePos(0)
+      , m_nDequeuePos(0)
+      , m_nSize(0)
+      , m_nKBytes(0)
+      , m_nMaxKBytes(0)
+      , m_nConsumerWaiting(0)
+      , m_nProducersWaiting(0)
+      , m_bClosed(false)
+      , m_bConsumer(false)
+      , m_nOverflow(0)
+      , m_nHighWaterBuffers(0)
+      , m_nHighWaterKBytes(0)
+      , m_nBlocked(0)
+      , m_llBlockedMsec(0)
    {
+      SetCapacity( nDefaultMaxBuffers, llDefaultMaxBytes );
    }
 
    DataQueue::~DataQueue()
    {
 
    }
+
+   void DataQueue::SetCapacity( int nMaxBuffers, qint64 llMaxBytes )
+   {
+      m_mutex.lock();
+      if( m_nSize != 0 )
+      {
+         cerr << "DataQueue: Capacity cannot change while buffers are queued" << endl;
+         m_mutex.unlock();
+         return;
+      }
+
+      // Positions map to slots by masking so the ring is a power of two.
+      int nSlots = 1;
+      while( nSlots < nMaxBuffers )
+      {
+         nSlots *= 2;
+      }
+      m_slots.clear();
+      m_slots.resize( nSlots );
+      for( int i = 0; i < nSlots; ++i )
+      {
+         m_slots[i].nSequence = i;
+         m_slots[i].nKBytes   = 0;
+      }
+      m_nMask       = nSlots - 1;
+      m_nEnqueuePos = 0;
+      m_nDequeuePos = 0;
+      m_nMaxKBytes  = ToKilobytes( llMaxBytes );
+      m_notFull.wakeAll();
+      m_mutex.unlock();
+   }
+
+   void DataQueue::Close()
+   {
+      m_mutex.lock();
+      m_bClosed = true;
+      m_notFull.wakeAll();
+      m_notEmpty.wakeAll();
+      m_mutex.unlock();
+   }
+
+   void DataQueue::SetConsumerRunning( bool bRunning )
+   {
+      m_mutex.lock();
+      m_bConsumer = bRunning;
+      m_notFull.wakeAll();
+      m_mutex.unlock();
+   }
    
    // ==========================================================================
    // ==========================================================================
-   bool DataQueue::Enqueue( const DataBuffer& buffer )
+   bool DataQueue::IsFull( int nKBytes ) const
    {
+      int nSize = m_nSize;
+      if( nSize == 0 )
+      {
+         return false;
+      }
+      return nSize > m_nMask ||
+             (m_nMaxKBytes > 0 && m_nKBytes + nKBytes > m_nMaxKBytes);
+   }
+
+   bool DataQueue::TryEnqueue( DataBuffer& buffer, int nKBytes )
+   {
+      if( m_bClosed || IsFull(nKBytes) )
+      {
+         return false;
+      }
+
+      // Claim the slot at the enqueue position.  A slot whose sequence is
+      // behind the position still holds a buffer, so the ring is full.  One
+      // ahead of it means another producer claimed it first.
+      int   nPos = m_nEnqueuePos;
+      Slot* pSlot;
+      for( ;; )
+      {
+         pSlot = &m_slots[nPos & m_nMask];
+         int nDiff = static_cast<int>( 
+            static_cast<unsigned int>(LoadAcquire(pSlot->nSequence)) - 
+            static_cast<unsigned int>(nPos) );
+         if( nDiff == 0 )
+         {
+            if( m_nEnqueuePos.testAndSetRelaxed(nPos, nPos+1) )
+            {
+               break;
+            }
+         }
+         else if( nDiff < 0 )
+         {
+            return false;
+         }
+         nPos = m_nEnqueuePos;
+      }
+
+      // Count the buffer before the consumer can see it so the counts 
+      // never go negative.
+      int nSize   = m_nSize.fetchAndAddOrdered( 1 ) + 1;
+      int nQueued = m_nKBytes.fetchAndAddOrdered( nKBytes ) + nKBytes;
+      RaiseHighWater( m_nHighWaterBuffers, nSize );
+      RaiseHighWater( m_nHighWaterKBytes, nQueued );
+
+      pSlot->buffer.Swap( buffer );
+      pSlot->nKBytes = nKBytes;
+      pSlot->nSequence.fetchAndStoreRelease( nPos+1 );
+      return true;
+   }
+
+   bool DataQueue::WaitForRoom( DataBuffer& buffer, int nKBytes, bool& bQueued )
+   {
+      QTime timer;
+      timer.start();
+
+      // The consumer only signals when it sees a producer waiting, so the
+      // queue is checked again once the count is raised.
       m_mutex.lock();
-      m_queue.enqueue( buffer );
+      m_nProducersWaiting.fetchAndAddOrdered( 1 );
+      // While the consumer runs, buffers held aside are taken before any 
+      // more are queued, so producers wait for them as well as for room.
+      while( !m_bClosed && m_bConsumer && (m_nOverflow != 0 || IsFull(nKBytes)) )
+      {
+         m_notFull.wait( &m_mutex );
+      }
+      m_nProducersWaiting.fetchAndAddOrdered( -1 );
+      ++m_nBlocked;
+      m_llBlockedMsec += timer.elapsed();
+
+      // Nothing drains the ring while the consumer is stopped, so the buffer
+      // is held aside rather than waiting.  Once any are held aside the rest
+      // follow them so that each producer's buffers stay in order.
+      bQueued = false;
+      if( !m_bClosed && !m_bConsumer && (m_nOverflow != 0 || IsFull(nKBytes)) )
+      {
+         m_overflow.append( Overflow() );
+         m_overflow.last().buffer.Swap( buffer );
+         m_overflow.last().nKBytes = nKBytes;
+         int nSize   = m_nSize.fetchAndAddOrdered( 1 ) + 1;
+         int nQueued = m_nKBytes.fetchAndAddOrdered( nKBytes ) + nKBytes;
+         RaiseHighWater( m_nHighWaterBuffers, nSize );
+         RaiseHighWater( m_nHighWaterKBytes, nQueued );
+         m_nOverflow.fetchAndAddOrdered( 1 );
+         bQueued = true;
+      }
+      bool bOpen = !m_bClosed;
       m_mutex.unlock();
 
+      return bOpen;
+   }
+
+   bool DataQueue::Enqueue( DataBuffer& buffer )
+   {
+      int  nKBytes = ToKilobytes( buffer.Bytes() );
+      bool bQueued = false;
+      while( !bQueued )
+      {
+         if( LoadAcquire(m_nOverflow) == 0 )
+         {
+            bQueued = TryEnqueue( buffer, nKBytes );
+         }
+         if( !bQueued && !WaitForRoom(buffer, nKBytes, bQueued) )
+         {
+            return false;
+         }
+      }
+
+      if( LoadAcquire(m_nConsumerWaiting) )
+      {
+         m_mutex.lock();
+         m_notEmpty.wakeOne();
+         m_mutex.unlock();
+      }
       return true;
    }
 
    bool DataQueue::Dequeue( DataBuffer& buffer )
    {
-      bool bRetVal(false);
+      Slot& slot = m_slots[m_nDequeuePos & m_nMask];
+      int nDiff = static_cast<int>( 
+         static_cast<unsigned int>(LoadAcquire(slot.nSequence)) - 
+         static_cast<unsigned int>(m_nDequeuePos+1) );
+      if( nDiff < 0 )
+      {
+         // Buffers held aside were queued after those in the ring.
+         return LoadAcquire(m_nOverflow) != 0 && DequeueOverflow( buffer );
+      }
+
+      // Hand the slot back to the producers a lap of the ring later.
+      buffer.Swap( slot.buffer );
+      slot.buffer = DataBuffer();
+      int nKBytes = slot.nKBytes;
+      slot.nSequence.fetchAndStoreRelease( m_nDequeuePos + m_nMask + 1 );
+      ++m_nDequeuePos;
 
+      m_nKBytes.fetchAndAddOrdered( -nKBytes );
+      m_nSize.fetchAndAddOrdered( -1 );
+      WakeProducers();
+      return true;
+   }
+
+   bool DataQueue::DequeueOverflow( DataBuffer& buffer )
+   {
       m_mutex.lock();
-      if( !m_queue.empty() )
+      if( m_overflow.isEmpty() )
       {
-         buffer = m_queue.dequeue();
-         bRetVal = true;
+         m_mutex.unlock();
+         return false;
       }
+
+      Overflow& first = m_overflow.first();
+      buffer.Swap( first.buffer );
+      int nKBytes = first.nKBytes;
+      m_overflow.removeFirst();
+
+      m_nKBytes.fetchAndAddOrdered( -nKBytes );
+      m_nSize.fetchAndAddOrdered( -1 );
+      m_nOverflow.fetchAndAddOrdered( -1 );
       m_mutex.unlock();
-      
-      return bRetVal;
+
+      WakeProducers();
+      return true;
+   }
+
+   void DataQueue::WakeProducers()
+   {
+      if( LoadAcquire(m_nProducersWaiting) )
+      {
+         m_mutex.lock();
+         m_notFull.wakeAll();
+         m_mutex.unlock();
+      }
+   }
+
+   bool DataQueue::WaitForData( unsigned long ulMsec )
+   {
+      if( m_nSize != 0 )
+      {
+         return true;
+      }
+
+      // Producers only signal when they see the consumer waiting, so the
+      // queue is checked again once the flag is raised.
+      m_mutex.lock();
+      m_nConsumerWaiting.fetchAndStoreOrdered( 1 );
+      if( m_nSize == 0 && !m_bClosed )
+      {
+         m_notEmpty.wait( &m_mutex, ulMsec );
+      }
+      m_nConsumerWaiting.fetchAndStoreOrdered( 0 );
+      m_mutex.unlock();
+
+      return m_nSize != 0;
    }
    
    int DataQueue::Size( ) const
    {
-      return m_queue.size();
+      return m_nSize;
+   }
+
+   qint64 DataQueue::Bytes( ) const
+   {
+      return m_nKBytes * llKilobyte;
    }
       
    bool DataQueue::PopAll( QList<DataBuffer>& list )
    {
-      m_mutex.lock();
-      while( !m_queue.empty() )
+      DataBuffer buffer;
+      while( Dequeue(buffer) )
       {
-         list.push_back( m_queue.dequeue() );
+         list.push_back( buffer );
       }
-      m_mutex.unlock();
 
       return true;
    }
 
+   DataQueue::Statistics DataQueue::GetStatistics( ) const
+   {
+      Statistics stats;
+      m_mutex.lock();
+      stats.nHighWaterBuffers = m_nHighWaterBuffers;
+      stats.llHighWaterBytes  = m_nHighWaterKBytes * llKilobyte;
+      stats.nBlocked          = m_nBlocked;
+      stats.llBlockedMsec     = m_llBlockedMsec;
+      m_mutex.unlock();
+      return stats;
+   }
+
+   void DataQueue::ResetStatistics( )
+   {
+      m_mutex.lock();
+      m_nHighWaterBuffers = m_nSize;
+      m_nHighWaterKBytes  = m_nKBytes;
+      m_nBlocked          = 0;
+      m_llBlockedMsec     = 0;
+      m_mutex.unlock();
+   }
+
 };
@@ -16,8 +16,10 @@
 #ifndef _DATAQUEUE_H_
 #define _DATAQUEUE_H_
 
+#include <QAtomicInt>
 #include <QMutex>
-#include <QQueue>
+#include <QWaitCondition>
+#include <QVector>
 #include <QList>
 
 #include "DataTypes.h"
@@ -26,30 +28,152 @@
 namespace Data
 {
 
-   //! Defines a thread safe FIFO queue storing data buffers.
+   //! Defines a thread safe FIFO queue storing data buffers, with any number
+   //! of producers and a single consumer.  The buffers are held in a ring of
+   //! slots that producers claim with atomic operations, so neither side 
+   //! takes a lock while there is room and data.  Only a producer finding 
+   //! the queue full or a consumer finding it empty waits, on a condition
+   //! that the other side signals when it sees someone waiting.
+   //!
+   //! The queue is bounded by its number of slots and a number of bytes.  
+   //! The byte bound is checked before a slot is claimed so producers racing
+   //! each other may each go over it by a buffer.  Producers only wait for 
+   //! room while the consumer is running.  Otherwise buffers that don't fit
+   //! are held aside, in order, until the consumer takes them.
    class DataQueue
    {
    public:
+      //! Default maximum number of buffers in the queue.
+      static const int nDefaultMaxBuffers;
+
+      //! Default maximum number of bytes held by the buffers in the queue.
+      static const qint64 llDefaultMaxBytes;
+
+      //! Measurements of how full the queue has been, for sizing it.
+      struct Statistics
+      {
+         int    nHighWaterBuffers; //!< Most buffers queued at once
+         qint64 llHighWaterBytes;  //!< Most bytes queued at once
+         int    nBlocked;          //!< Number of Enqueue() calls that had to wait
+         qint64 llBlockedMsec;     //!< Total time producers spent waiting
+      };
 
       DataQueue();
       ~DataQueue();
       
+      //! Sets the bounds of the queue.  The number of buffers is rounded up
+      //! to a power of two and a number of bytes of zero leaves that bound
+      //! off.  A buffer is always accepted by an empty queue, however large
+      //! it is.  This must only be called while nothing is being queued, 
+      //! e.g. before the consumer starts.
+      //! @param nMaxBuffers  Maximum number of buffers
+      //! @param llMaxBytes   Maximum number of bytes held by the buffers
+      void SetCapacity( int nMaxBuffers, qint64 llMaxBytes );
+
+      //! Closes the queue.  Producers waiting for room and any that try to
+      //! queue a buffer afterward give up.
+      void Close();
+
+      //! Tells the queue whether the consumer is running.  Producers only 
+      //! wait for room while one is, so nothing blocks before the consumer
+      //! starts or after it stops.
+      //! @param bRunning  True while the consumer is running
+      void SetConsumerRunning( bool bRunning );
 
-      //! Pushes a data buffer onto the queue.
-      bool Enqueue( const DataBuffer& buffer );
+      //! Pushes a data buffer onto the queue, waiting while it is full and
+      //! the consumer is running.  The contents are swapped into the queue,
+      //! leaving the buffer empty.
+      //! @retval true  If the buffer was queued
+      //! @retval false If the queue was closed, the buffer is left as is
+      bool Enqueue( DataBuffer& buffer );
 
-      //! Pops the next buffer from the queue.
+      //! Pops the next buffer from the queue by swapping it into the buffer 
+      //! given.  Only the consumer may call this.
       bool Dequeue( DataBuffer& buffer );
 
+      //! Waits until a buffer is queued.  Only the consumer may call this.
+      //! @param ulMsec  Maximum time to wait
+      //! @retval true  If a buffer is waiting
+      //! @retval false If the time expired
+      bool WaitForData( unsigned long ulMsec );
+
       //! Returns the number of items in the queue.
       int Size( ) const;
+
+      //! Returns the number of bytes held by the buffers in the queue.
+      qint64 Bytes( ) const;
       
-      //! Pulls off all buffers from the queue.
+      //! Pulls off all buffers from the queue.  Only the consumer may call 
+      //! this.
       bool PopAll( QList<DataBuffer>& list );
 
+      //! Returns the measurements since the last ResetStatistics().
+      Statistics GetStatistics( ) const;
+
+      //! Restarts the measurements.
+      void ResetStatistics( );
+
    protected:
-      QMutex              m_mutex; //!< Used to create a thread safe queue.
-      QQueue<DataBuffer>  m_queue; //!< The Queue
+      //! Slot of the ring.  The sequence tells whose turn it is: it equals
+      //! the position of the producer that may fill it, or one past that 
+      //! position once the buffer is ready for the consumer.
+      struct Slot
+      {
+         QAtomicInt nSequence; //!< Turn of the slot
+         DataBuffer buffer;    //!< Buffer held by the slot
+         int        nKBytes;   //!< Kilobytes held by the buffer
+      };
+
+      //! Buffer held aside while the ring has no room and nothing drains it.
+      struct Overflow
+      {
+         DataBuffer buffer;    //!< Buffer held aside
+         int        nKBytes;   //!< Kilobytes held by the buffer
+      };
+
+      //! Queues a buffer if there is room without waiting.
+      bool TryEnqueue( DataBuffer& buffer, int nKBytes );
+
+      //! Waits for room for a buffer while the consumer is running, and for
+      //! the consumer to take any buffers held aside.  When it isn't running
+      //! and there's no room, or buffers are already held aside, the buffer 
+      //! is held aside after them instead.
+      //! @param buffer   Buffer to queue
+      //! @param nKBytes  Kilobytes held by the buffer
+      //! @param bQueued  Set when the buffer was held aside
+      //! @retval true  If the buffer was held aside or there may be room
+      //! @retval false If the queue was closed
+      bool WaitForRoom( DataBuffer& buffer, int nKBytes, bool& bQueued );
+
+      //! Takes the oldest buffer held aside.  Only the consumer may call this.
+      bool DequeueOverflow( DataBuffer& buffer );
+
+      //! Wakes any producers waiting for room.
+      void WakeProducers();
+
+      //! Indicates the queue has no room for a buffer.
+      bool IsFull( int nKBytes ) const;
+
+      mutable QMutex      m_mutex;            //!< Guards the waits and the blocked measurements
+      QWaitCondition      m_notEmpty;         //!< Signaled when a buffer is queued
+      QWaitCondition      m_notFull;          //!< Signaled when room is made in the queue
+      QVector<Slot>       m_slots;            //!< Ring of slots
+      int                 m_nMask;            //!< Number of slots less one
+      QAtomicInt          m_nEnqueuePos;      //!< Position of the next slot to claim
+      int                 m_nDequeuePos;      //!< Position of the next slot to take, consumer only
+      QAtomicInt          m_nSize;            //!< Number of slots claimed and not yet taken
+      QAtomicInt          m_nKBytes;          //!< Kilobytes held by the claimed slots
+      int                 m_nMaxKBytes;       //!< Maximum number of kilobytes, 0 if unbounded
+      QAtomicInt          m_nConsumerWaiting; //!< Flag indicating the consumer waits for data
+      QAtomicInt          m_nProducersWaiting;//!< Number of producers waiting for room
+      bool                m_bClosed;          //!< Flag indicating the queue was closed
+      bool                m_bConsumer;        //!< Flag indicating the consumer is running
+      QList<Overflow>     m_overflow;         //!< Buffers held aside, oldest first
+      QAtomicInt          m_nOverflow;        //!< Number of buffers held aside
+      QAtomicInt          m_nHighWaterBuffers;//!< Most buffers queued at once
+      QAtomicInt          m_nHighWaterKBytes; //!< Most kilobytes queued at once
+      int                 m_nBlocked;         //!< Number of Enqueue() calls that waited
+      qint64              m_llBlockedMsec;    //!< Total time producers spent waiting
    };
 };
 
@@ -70,7 +70,7 @@ namespace Data
       return m_selections;
    }
 
-   bool DataSelections::GetDataAttributes(Data::FlightDatabase& data) const
+   bool DataSelections::GetDataAttributes(Data::FlightDatabase& data, bool bNormalized) const
    {
       if( !m_dataMgmt )
       {
@@ -95,16 +95,29 @@ namespace Data
             while( fIdx.hasNext() )
             {
                QString flight = fIdx.next();
-               retVal &= m_dataMgmt->GetDataAttributes(flight, i.value(), data[flight]);
+               retVal &= GetFlightAttributes(flight, i.value(), bNormalized, data[flight]);
             }
          }
          else
          {
-            retVal &= m_dataMgmt->GetDataAttributes(i.key(), i.value(), data[i.key()]);
+            retVal &= GetFlightAttributes(i.key(), i.value(), bNormalized, data[i.key()]);
          }
       }
 
       return retVal;
    }
 
+   bool DataSelections::GetFlightAttributes(
+      const QString& sFlightName, 
+      const QStringList& attributes, 
+      bool bNormalized, 
+      Data::Buffer& data) const
+   {
+      if( bNormalized )
+      {
+         return m_dataMgmt->GetNormalizedAttributes(sFlightName, attributes, data);
+      }
+      return m_dataMgmt->GetDataAttributes(sFlightName, attributes, data);
+   }
+
 };
@@ -62,10 +62,18 @@ namespace Data
       const Selections& GetSelectedAttributes();
 
 	  //! Populates the provided data buffer with the selected attributes.
-	  //! @param data Data buffer to be populated.
-	  bool GetDataAttributes(Data::FlightDatabase& data) const;
+	  //! @param data         Data buffer to be populated.
+	  //! @param bNormalized  True to normalize the values to the range 0 to 1
+	  bool GetDataAttributes(Data::FlightDatabase& data, bool bNormalized = false) const;
 
    protected:
+      //! Adds the attributes of a single flight to its data buffer.
+      bool GetFlightAttributes(
+         const QString& sFlightName, 
+         const QStringList& attributes, 
+         bool bNormalized, 
+         Data::Buffer& data) const;
+
       DataMgmt*   m_dataMgmt;    //!< Object used to access data.
       Selections  m_selections;  //!< List of selected parameters.
    };
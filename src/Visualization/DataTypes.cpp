@@ -16,6 +16,12 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <climits>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <qnumeric.h>
+#include <QtAlgorithms>
 
 #include "DataTypes.h"
 
@@ -33,11 +39,710 @@ namespace Data
    }
 
 
+   // ==========================================================================
+   // ==========================================================================
+   RunningStatistics::RunningStatistics()
+      : m_uCount(0)
+      , m_uNulls(0)
+      , m_fMin(0)
+      , m_fMax(0)
+      , m_fSum(0)
+      , m_fMean(0)
+      , m_fM2(0)
+   {
+   }
+
+   RunningStatistics::RunningStatistics( const Metadata& meta )
+      : m_uCount(meta._count)
+      , m_uNulls(meta._nulls)
+      , m_fMin(meta._min)
+      , m_fMax(meta._max)
+      , m_fSum(meta._sum)
+      , m_fMean(meta._avg)
+      , m_fM2(meta._count > 1 ? meta._var * (meta._count-1) : 0)
+   {
+   }
+
+   void RunningStatistics::Add( double value )
+   {
+      if( qIsNaN(value) )
+      {
+         ++m_uNulls;
+         return;
+      }
+      if( m_uCount == 0 || value < m_fMin )
+      {
+         m_fMin = value;
+      }
+      if( m_uCount == 0 || value > m_fMax )
+      {
+         m_fMax = value;
+      }
+      ++m_uCount;
+      m_fSum += value;
+
+      double fDelta = value - m_fMean;
+      m_fMean += fDelta / m_uCount;
+      m_fM2   += fDelta * (value - m_fMean);
+   }
+
+   Metadata RunningStatistics::ToMetadata() const
+   {
+      Metadata meta;
+      meta._min        = m_fMin;
+      meta._max        = m_fMax;
+      meta._sum        = m_fSum;
+      meta._avg        = m_fMean;
+      meta._var        = m_uCount > 1 ? m_fM2 / (m_uCount-1) : 0;
+      meta._dev        = sqrt( meta._var );
+      meta._range      = m_fMax - m_fMin;
+      meta._count      = m_uCount;
+      meta._nulls      = m_uNulls;
+      meta._definition = 0;
+      return meta;
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   RowSpans::RowSpans()
+      : pBase(0)
+   {
+   }
+
+   int RowSpans::size() const
+   {
+      return fields.size();
+   }
+
+   const char* RowSpans::Data( int i ) const
+   {
+      return pBase + fields.at(i).nOffset;
+   }
+
+   int RowSpans::Length( int i ) const
+   {
+      return fields.at(i).nLength;
+   }
+
+   QString RowSpans::ToString( int i ) const
+   {
+      const FieldSpan& span = fields.at(i);
+      const char* pData = pBase + span.nOffset;
+      if( !span.bQuoted )
+      {
+         return QString::fromLocal8Bit( pData, span.nLength );
+      }
+
+      // Quotes toggle the quoted state and are never part of the value.  
+      // Leading whitespace is trimmed the same as an unquoted field.
+      QByteArray value;
+      value.reserve( span.nLength );
+      for( int c = 0; c < span.nLength; ++c )
+      {
+         if( pData[c] != '\"' && (!value.isEmpty() || pData[c] != ' ') )
+         {
+            value.append( pData[c] );
+         }
+      }
+      return QString::fromLocal8Bit( value.constData(), value.size() );
+   }
+
+   QStringList RowSpans::ToStringList() const
+   {
+      QStringList list;
+      for( int i = 0; i < fields.size(); ++i )
+      {
+         list.append( ToString(i) );
+      }
+      return list;
+   }
+
+   void RowSpans::FromStringList( 
+      const QStringList& list, 
+      QByteArray& storage, 
+      RowSpans& row )
+   {
+      // Spans are offsets so the storage can be built before the base 
+      // pointer is known.
+      FieldSpan span;
+      span.bQuoted = false;
+      storage.clear();
+      row.fields.clear();
+      for( int i = 0; i < list.size(); ++i )
+      {
+         QByteArray field = list.at(i).toLocal8Bit();
+         span.nOffset = storage.size();
+         span.nLength = field.size();
+         storage.append( field );
+         row.fields.append( span );
+      }
+      row.pBase = storage.constData();
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   const int NumericColumn::nMaxEnumValues = 255;
+
+   // Codes of a missing value in the byte and integer representations.
+   const quint8 nMissingCode  = 0xFF;
+   const qint32 nMissingInt32 = INT_MIN;
+
+   NumericColumn::NumericColumn( StorageType eType )
+      : m_eType(eType)
+      , m_bNarrowed(eType != StorageType_Float64)
+   {
+   }
+
+   StorageType NumericColumn::Type() const
+   {
+      return m_eType;
+   }
+
+   bool NumericColumn::IsNarrowed() const
+   {
+      return m_bNarrowed;
+   }
+
+   int NumericColumn::size() const
+   {
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+      case StorageType_Enum:
+         return m_u8.size();
+      case StorageType_Int32:
+         return m_i32.size();
+      case StorageType_Float32:
+         return m_f32.size();
+      default:
+         return m_f64.size();
+      }
+   }
+
+   double NumericColumn::at( int i ) const
+   {
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+         return m_u8.at(i) == nMissingCode ? qQNaN() : m_u8.at(i);
+      case StorageType_Enum:
+         return m_u8.at(i) == nMissingCode ? qQNaN() : m_dictionary.at(m_u8.at(i));
+      case StorageType_Int32:
+         return m_i32.at(i) == nMissingInt32 ? qQNaN() : m_i32.at(i);
+      case StorageType_Float32:
+         return m_f32.at(i);
+      default:
+         return m_f64.at(i);
+      }
+   }
+
+   void NumericColumn::append( double value )
+   {
+      // Columns being parsed take any value.
+      if( m_eType == StorageType_Float64 )
+      {
+         m_f64.append( value );
+      }
+      else if( m_eType == StorageType_Enum && !qIsNaN(value) )
+      {
+         if( !StoreCode(value) )
+         {
+            Widen( value );
+         }
+      }
+      else if( Fits(m_eType, value) )
+      {
+         Store( value );
+      }
+      else
+      {
+         Widen( value );
+      }
+   }
+
+   void NumericColumn::append( const NumericColumn& other )
+   {
+      if( m_eType == StorageType_Float64 && other.m_eType == StorageType_Float64 )
+      {
+         m_f64 += other.m_f64;
+         return;
+      }
+
+      int nValues = other.size();
+      for( int i = 0; i < nValues; ++i )
+      {
+         append( other.at(i) );
+      }
+   }
+
+   // Removes the values of a vector without releasing its memory.
+   template< class T >
+   static void ClearValues( QVector<T>& values )
+   {
+      if( !values.isEmpty() )
+      {
+         values.erase( values.begin(), values.end() );
+      }
+   }
+
+   void NumericColumn::clear()
+   {
+      ClearValues( m_f64 );
+      ClearValues( m_f32 );
+      ClearValues( m_i32 );
+      ClearValues( m_u8 );
+      m_dictionary.clear();
+      m_sorted.clear();
+      m_codes.clear();
+   }
+
+   void NumericColumn::reserve( int nValues )
+   {
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+      case StorageType_Enum:
+         m_u8.reserve( nValues );
+         break;
+      case StorageType_Int32:
+         m_i32.reserve( nValues );
+         break;
+      case StorageType_Float32:
+         m_f32.reserve( nValues );
+         break;
+      default:
+         m_f64.reserve( nValues );
+      }
+   }
+
+   NumericColumn NumericColumn::Narrowed() const
+   {
+      if( m_bNarrowed )
+      {
+         return *this;
+      }
+
+      // Starting from the narrowest representation, the leading values 
+      // settle the type and the rest only widen it when they must.
+      NumericColumn narrow( StorageType_Bool );
+      int nValues = size();
+      for( int i = 0; i < nValues; ++i )
+      {
+         narrow.append( at(i) );
+      }
+      narrow.m_bNarrowed = true;
+      return narrow;
+   }
+
+   int NumericColumn::ElementSize() const
+   {
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+      case StorageType_Enum:
+         return sizeof(quint8);
+      case StorageType_Int32:
+         return sizeof(qint32);
+      case StorageType_Float32:
+         return sizeof(float);
+      default:
+         return sizeof(double);
+      }
+   }
+
+   qint64 NumericColumn::Bytes() const
+   {
+      return static_cast<qint64>(size()) * ElementSize() + 
+         m_dictionary.size() * (2*sizeof(double) + sizeof(quint8));
+   }
+
+   const char* NumericColumn::RawData() const
+   {
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+      case StorageType_Enum:
+         return reinterpret_cast<const char*>( m_u8.constData() );
+      case StorageType_Int32:
+         return reinterpret_cast<const char*>( m_i32.constData() );
+      case StorageType_Float32:
+         return reinterpret_cast<const char*>( m_f32.constData() );
+      default:
+         return reinterpret_cast<const char*>( m_f64.constData() );
+      }
+   }
+
+   const QVector<double>& NumericColumn::Dictionary() const
+   {
+      return m_dictionary;
+   }
+
+   bool NumericColumn::FromRaw( 
+      StorageType eType, 
+      const char* pData, 
+      int nValues,
+      const QVector<double>& dictionary,
+      NumericColumn& column )
+   {
+      // Every byte code has to be 0 or 1 for a bool, or index the dictionary
+      // for an enum, unless it's missing.  Anything else would be read as a 
+      // value that was never stored, or past the end of the dictionary.
+      if( eType == StorageType_Bool || eType == StorageType_Enum )
+      {
+         if( eType == StorageType_Enum && dictionary.size() > nMaxEnumValues )
+         {
+            return false;
+         }
+         int nCodes = eType == StorageType_Bool ? 2 : dictionary.size();
+         const quint8* pCodes = reinterpret_cast<const quint8*>( pData );
+         for( int i = 0; i < nValues; ++i )
+         {
+            if( pCodes[i] != nMissingCode && pCodes[i] >= nCodes )
+            {
+               return false;
+            }
+         }
+      }
+
+      NumericColumn raw( eType );
+      raw.m_bNarrowed  = true;
+      raw.m_dictionary = dictionary;
+      raw.IndexDictionary();
+
+      void* pValues;
+      switch( eType )
+      {
+      case StorageType_Bool:
+      case StorageType_Enum:
+         raw.m_u8.resize( nValues );
+         pValues = raw.m_u8.data();
+         break;
+      case StorageType_Int32:
+         raw.m_i32.resize( nValues );
+         pValues = raw.m_i32.data();
+         break;
+      case StorageType_Float32:
+         raw.m_f32.resize( nValues );
+         pValues = raw.m_f32.data();
+         break;
+      default:
+         raw.m_f64.resize( nValues );
+         pValues = raw.m_f64.data();
+      }
+      memcpy( pValues, pData, nValues*raw.ElementSize() );
+      column = raw;
+      return true;
+   }
+
+   bool NumericColumn::Fits( StorageType eType, double value ) const
+   {
+      // Every representation has a code for a missing value.
+      if( qIsNaN(value) )
+      {
+         return true;
+      }
+
+      switch( eType )
+      {
+      case StorageType_Bool:
+         return value == 0 || value == 1;
+      case StorageType_Enum:
+         return m_eType != StorageType_Enum || 
+            m_dictionary.size() < nMaxEnumValues || FindCode(value) >= 0;
+      case StorageType_Int32:
+         return value > INT_MIN && value <= INT_MAX && value == floor(value);
+      case StorageType_Float32:
+         return qIsInf(value) || 
+            (fabs(value) <= FLT_MAX && static_cast<float>(value) == value);
+      default:
+         return true;
+      }
+   }
+
+   void NumericColumn::Store( double value )
+   {
+      bool bMissing = qIsNaN(value);
+      switch( m_eType )
+      {
+      case StorageType_Bool:
+         m_u8.append( bMissing ? nMissingCode : static_cast<quint8>(value) );
+         break;
+      case StorageType_Enum:
+         if( bMissing )
+         {
+            m_u8.append( nMissingCode );
+         }
+         else
+         {
+            StoreCode( value );
+         }
+         break;
+      case StorageType_Int32:
+         m_i32.append( bMissing ? nMissingInt32 : static_cast<qint32>(value) );
+         break;
+      case StorageType_Float32:
+         m_f32.append( static_cast<float>(value) );
+         break;
+      default:
+         m_f64.append( value );
+      }
+   }
+
+   bool NumericColumn::StoreCode( double value )
+   {
+      // The dictionary is searched in sorted order so the codes of the 
+      // common values are found without scanning every entry.
+      const double* pBegin = m_sorted.constBegin();
+      const double* pFound = qLowerBound( pBegin, m_sorted.constEnd(), value );
+      int nIndex = pFound - pBegin;
+      if( pFound != m_sorted.constEnd() && *pFound == value )
+      {
+         m_u8.append( m_codes.at(nIndex) );
+         return true;
+      }
+
+      if( m_dictionary.size() >= nMaxEnumValues )
+      {
+         return false;
+      }
+
+      quint8 uCode = static_cast<quint8>( m_dictionary.size() );
+      m_dictionary.append( value );
+      m_sorted.insert( nIndex, value );
+      m_codes.insert( nIndex, uCode );
+      m_u8.append( uCode );
+      return true;
+   }
+
+   int NumericColumn::FindCode( double value ) const
+   {
+      const double* pFound = 
+         qLowerBound( m_sorted.constBegin(), m_sorted.constEnd(), value );
+      if( pFound == m_sorted.constEnd() || *pFound != value )
+      {
+         return -1;
+      }
+      return m_codes.at( pFound - m_sorted.constBegin() );
+   }
+
+   void NumericColumn::IndexDictionary()
+   {
+      m_sorted.clear();
+      m_codes.clear();
+      for( int i = 0; i < m_dictionary.size(); ++i )
+      {
+         double value = m_dictionary.at(i);
+         int nIndex = qLowerBound( m_sorted.constBegin(), m_sorted.constEnd(), value ) - 
+            m_sorted.constBegin();
+         m_sorted.insert( nIndex, value );
+         m_codes.insert( nIndex, static_cast<quint8>(i) );
+      }
+   }
+
+   void NumericColumn::Widen( double value )
+   {
+      // Widening is rare, at most once per representation, so the values 
+      // are simply checked and converted again.
+      int nValues = size();
+      StorageType eType = m_eType;
+      bool bFits = false;
+      while( !bFits && eType != StorageType_Float64 )
+      {
+         eType = static_cast<StorageType>(eType+1);
+         bFits = Fits( eType, value );
+         for( int i = 0; bFits && i < nValues; ++i )
+         {
+            bFits = Fits( eType, at(i) );
+         }
+      }
+
+      NumericColumn wide( eType );
+      wide.m_bNarrowed = m_bNarrowed;
+      for( int i = 0; i < nValues; ++i )
+      {
+         wide.Store( at(i) );
+      }
+      wide.Store( value );
+      *this = wide;
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   int Buffer::RowCount() const
+   {
+      return _times.size();
+   }
+
+   int Buffer::AttributeCount() const
+   {
+      return _values.size();
+   }
+
+   void Buffer::SetAttributeCount( int nAttributes )
+   {
+      int nOld = _values.size();
+      _values.resize( nAttributes );
+      for( int a = nOld; a < nAttributes; ++a )
+      {
+         _values[a].fill( qQNaN(), _times.size() );
+      }
+   }
+
+   void Buffer::Reserve( int nRows )
+   {
+      _times.reserve( nRows );
+      for( int a = 0; a < _values.size(); ++a )
+      {
+         _values[a].reserve( nRows );
+      }
+   }
+
+   void Buffer::Clear()
+   {
+      // Resizing keeps the memory reserved for the columns.
+      _times.resize( 0 );
+      for( int a = 0; a < _values.size(); ++a )
+      {
+         _values[a].resize( 0 );
+      }
+   }
+
+   int Buffer::AppendRow( unsigned int uTime )
+   {
+      _times.push_back( uTime );
+      for( int a = 0; a < _values.size(); ++a )
+      {
+         _values[a].push_back( qQNaN() );
+      }
+      return _times.size()-1;
+   }
+
+   void Buffer::Append( const Buffer& other )
+   {
+      if( other._values.size() > _values.size() )
+      {
+         SetAttributeCount( other._values.size() );
+      }
+
+      int nRows = _times.size();
+      int nOther = other._times.size();
+      _times += other._times;
+      for( int a = 0; a < _values.size(); ++a )
+      {
+         if( a < other._values.size() )
+         {
+            _values[a] += other._values.at(a);
+         }
+         else
+         {
+            _values[a].insert( nRows, nOther, qQNaN() );
+         }
+      }
+   }
+
+   unsigned int Buffer::Time( int nRow ) const
+   {
+      return _times.at(nRow);
+   }
+
+   double Buffer::Value( int nRow, int nAttribute ) const
+   {
+      return _values.at(nAttribute).at(nRow);
+   }
+
+   void Buffer::SetValue( int nRow, int nAttribute, double value )
+   {
+      _values[nAttribute][nRow] = value;
+   }
+
+   const unsigned int* Buffer::Times() const
+   {
+      return _times.constData();
+   }
+
+   const double* Buffer::Values( int nAttribute ) const
+   {
+      return _values.at(nAttribute).constData();
+   }
+
+   double* Buffer::Values( int nAttribute )
+   {
+      return _values[nAttribute].data();
+   }
+
+   qint64 Buffer::Bytes() const
+   {
+      qint64 llBytes = sizeof(Buffer);
+      llBytes += _times.capacity() * sizeof(unsigned int);
+      for( int a = 0; a < _values.size(); ++a )
+      {
+         llBytes += sizeof(QVector<double>) + _values.at(a).capacity() * sizeof(double);
+      }
+      llBytes += _metadata.size() * (sizeof(Metadata) + sizeof(void*));
+      return llBytes;
+   }
+
+
    // ==========================================================================
    // ==========================================================================
    DataBuffer::DataBuffer()
-      : bLastBuffer(false)
+      : nRows(0)
+      , bFirstBuffer(false)
+      , bLastBuffer(false)
+      , bAborted(false)
+   {
+   }
+
+   void DataBuffer::Clear()
+   {
+      data.clear();
+      for( int i = 0; i < numeric.size(); ++i )
+      {
+         numeric[i].clear();
+      }
+      for( int i = 0; i < text.size(); ++i )
+      {
+         text[i].clear();
+      }
+      nRows = 0;
+   }
+
+   void DataBuffer::Swap( DataBuffer& other )
+   {
+      qSwap( data, other.data );
+      qSwap( columns, other.columns );
+      qSwap( numeric, other.numeric );
+      qSwap( text, other.text );
+      qSwap( nRows, other.nRows );
+      qSwap( sFlightName, other.sFlightName );
+      qSwap( bFirstBuffer, other.bFirstBuffer );
+      qSwap( bLastBuffer, other.bLastBuffer );
+      qSwap( bAborted, other.bAborted );
+   }
+
+   qint64 DataBuffer::Bytes() const
    {
+      qint64 llBytes = 0;
+      for( int i = 0; i < data.size(); ++i )
+      {
+         llBytes += data.at(i).size() * sizeof(QChar);
+      }
+      for( int i = 0; i < numeric.size(); ++i )
+      {
+         llBytes += numeric.at(i).Bytes();
+      }
+      for( int i = 0; i < text.size(); ++i )
+      {
+         const QStringList& values = text.at(i);
+         for( int r = 0; r < values.size(); ++r )
+         {
+            llBytes += sizeof(QString) + values.at(r).size() * sizeof(QChar);
+         }
+      }
+      return llBytes;
    }
 
   
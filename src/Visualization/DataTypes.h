@@ -21,6 +21,8 @@
 
 #include <QString>
 #include <QVariant>
+#include <QVector>
+#include <QByteArray>
 #include <QStringList>
 
 namespace Data
@@ -54,48 +56,316 @@ namespace Data
    typedef QList<ColumnDef> ColumnDefList;
 
 
-   //! Represents an n-dimensional point parametric with time.
-   struct Point
+   //! References a single field of a row without copying it.  The offset is
+   //! relative to the start of the row the span belongs to.
+   struct FieldSpan
    {
-      QList<QVariant>  _dataVector; //!< Represents all parameters.
-      unsigned int     _time;       //!< 100 microsecond increments (.1 millisecond)
+      int  nOffset;  //!< Offset of the first byte of the field within the row
+      int  nLength;  //!< Number of bytes in the field
+      bool bQuoted;  //!< Field contains quote characters that must be removed
    };
 
+   //! Type definition for the fields of a single row.
+   typedef QVector<FieldSpan> FieldSpanList;
 
-   //! Represents metadata associated with a Point.
+
+   //! Represents a row of fields as spans into a block of memory owned by 
+   //! someone else, e.g. a memory mapped file.  The row is only valid as long
+   //! as that memory is.
+   class RowSpans
+   {
+   public:
+      RowSpans();
+
+      //! Number of fields in the row.
+      int size() const;
+
+      //! Pointer to the first byte of field i.
+      const char* Data( int i ) const;
+
+      //! Number of bytes in field i.
+      int Length( int i ) const;
+
+      //! Creates a string from field i.  This allocates and should be 
+      //! reserved for non-numeric data.
+      QString ToString( int i ) const;
+
+      //! Creates a string list from all of the fields.
+      QStringList ToStringList() const;
+
+      //! Builds spans referencing a list of strings.
+      //! @param list     Strings to reference
+      //! @param storage  Storage for the encoded strings, must outlive row
+      //! @param row      Spans referencing storage
+      static void FromStringList( 
+         const QStringList& list, 
+         QByteArray& storage, 
+         RowSpans& row );
+
+      const char*   pBase;  //!< Start of the row in memory
+      FieldSpanList fields; //!< Fields of the row relative to pBase
+   };
+
+
+   // Conversion from hours to 100 microsecond increments.
+   // 60 minutes per hour, 60 seconds per minute, 
+   // 1,000 milliseconds per second,
+   // 10 100 microsecond increments per millisecond
+   const unsigned int HoursTo100MicroSeconds = 60*60*1000*10;
+
+   //! Represents metadata associated with an attribute of a Buffer.
    struct Metadata
    {
       double       _min;    //!< Statistical min
       double       _max;    //!< Statistical max
       double       _sum;    //!< Sum of the parameter
       double       _avg;    //!< Statistical average
-      //double       _var;    //!< Statistical variance
-      //double       _dev;    //!< Statistical standard deviation
+      double       _var;    //!< Statistical variance
+      double       _dev;    //!< Statistical standard deviation
       double       _range;  //!< Range between min and max
-      unsigned int _count;  //!< Statistical standard deviation
+      unsigned int _count;  //!< Number of values
+      unsigned int _nulls;  //!< Number of missing values
 
       ColumnDef*  _definition;  //!< Definition for the attribute
    };
 
 
-   // Combination of Points over time with their associated metadata.
-   struct Buffer
+   //! Gathers the statistics of a column in a single pass over its values.
+   //! The mean and variance are updated with Welford's method, which stays
+   //! accurate over long flights where a sum of squares would not.
+   class RunningStatistics
    {
-      QList<Point>    _params;
-      QList<Metadata> _metadata;
+   public:
+      RunningStatistics();
+
+      //! Continues from statistics gathered before, e.g. for rows appended
+      //! to a flight.
+      explicit RunningStatistics( const Metadata& meta );
+
+      //! Adds a value, counting NaN as a missing value.
+      void Add( double value );
+
+      //! Returns the statistics of the values added.  The variance is the 
+      //! sample variance, zero for fewer than two values.
+      Metadata ToMetadata() const;
+
+   private:
+      unsigned int m_uCount; //!< Number of values
+      unsigned int m_uNulls; //!< Number of missing values
+      double       m_fMin;   //!< Smallest value, 0 if there are none
+      double       m_fMax;   //!< Largest value, 0 if there are none
+      double       m_fSum;   //!< Sum of the values
+      double       m_fMean;  //!< Mean of the values
+      double       m_fM2;    //!< Sum of the squared differences from the mean
+   };
+
+
+   //! Values of attributes over time with their associated metadata.  The
+   //! values are held a column per attribute, row r of each column being the
+   //! value at _times[r], so a scan over an attribute reads one contiguous 
+   //! array.  Values() and Times() give the start of a column, RowCount() 
+   //! its length.  A missing value is NaN.
+   class Buffer
+   {
+   public:
+      //! Returns the number of rows.
+      int RowCount() const;
+
+      //! Returns the number of attributes.
+      int AttributeCount() const;
+
+      //! Sets the number of attributes.  Attributes that are added have 
+      //! every value missing.
+      void SetAttributeCount( int nAttributes );
+
+      //! Reserves room in every column for the given number of rows.
+      void Reserve( int nRows );
+
+      //! Removes every row, keeping the attributes.
+      void Clear();
+
+      //! Appends a row with every value missing.
+      //! @param uTime  Time of the row in 100 microsecond increments
+      //! @return Index of the row
+      int AppendRow( unsigned int uTime );
+
+      //! Appends the rows of another buffer.  Attributes only one of the 
+      //! buffers has are missing in the rows of the other.
+      void Append( const Buffer& other );
+
+      //! Returns the time of a row in 100 microsecond increments.
+      unsigned int Time( int nRow ) const;
+
+      //! Returns the value of an attribute in a row.
+      double Value( int nRow, int nAttribute ) const;
+
+      //! Sets the value of an attribute in a row.
+      void SetValue( int nRow, int nAttribute, double value );
+
+      //! Returns the time of every row, RowCount() of them.
+      const unsigned int* Times() const;
+
+      //! Returns the values of an attribute, RowCount() of them.
+      const double* Values( int nAttribute ) const;
+      double* Values( int nAttribute );
+
+      //! Approximate number of bytes held by the rows and metadata.
+      qint64 Bytes() const;
+
+      QVector<unsigned int>     _times;    //!< 100 microsecond increments (.1 millisecond)
+      QVector< QVector<double> > _values;  //!< Values of each attribute
+      QList<Metadata>           _metadata; //!< Statistics of each attribute
    };
 
    //! Type definition representing a database
    typedef QMap<QString, Buffer> FlightDatabase;
 
+   //! Enumeration of the representations of a numeric column, from the 
+   //! narrowest to the widest.
+   enum StorageType
+   {
+      StorageType_Bool,    //!< Only 0 and 1, a byte per value
+      StorageType_Enum,    //!< Few distinct values, a byte per value indexing them
+      StorageType_Int32,   //!< Whole numbers that fit in 32 bits
+      StorageType_Float32, //!< Values a float holds exactly
+      StorageType_Float64  //!< Any value
+   };
+
+   //! Column of numbers, NaN where a value is missing, held in one of the
+   //! StorageType representations.  New columns are StorageType_Float64 so
+   //! values are appended without any checks while parsing.  Narrowed()
+   //! picks the narrowest representation that holds every value exactly, 
+   //! e.g. for flags like the gear that only hold 0, 0.5 and 1.  Values 
+   //! appended to a narrowed column are validated and widen the column 
+   //! when they don't fit.
+   class NumericColumn
+   {
+   public:
+      //! Maximum number of distinct values in a StorageType_Enum column.
+      static const int nMaxEnumValues;
+
+      NumericColumn( StorageType eType = StorageType_Float64 );
+
+      //! Returns the representation of the values.
+      StorageType Type() const;
+
+      //! Indicates the column has been narrowed, see Narrowed().
+      bool IsNarrowed() const;
+
+      //! Number of values in the column.
+      int size() const;
+
+      //! Returns value i, NaN if it is missing.
+      double at( int i ) const;
+
+      //! Appends a value, widening a narrowed column if the value doesn't fit.
+      void append( double value );
+
+      //! Appends every value of another column.
+      void append( const NumericColumn& other );
+
+      //! Removes all of the values, keeping the capacity.
+      void clear();
+
+      //! Makes room for a number of values so appending doesn't allocate.
+      void reserve( int nValues );
+
+      //! Returns a copy in the narrowest representation that holds every 
+      //! value.  The representation is inferred from the leading values and
+      //! each later value is validated against it, widening as needed.  A 
+      //! column that is already narrowed is returned as is.
+      NumericColumn Narrowed() const;
+
+      //! Number of bytes in each stored value.
+      int ElementSize() const;
+
+      //! Approximate number of bytes held by the column.
+      qint64 Bytes() const;
+
+      //! Returns the stored values, size()*ElementSize() bytes.
+      const char* RawData() const;
+
+      //! Returns the values indexed by a StorageType_Enum column.
+      const QVector<double>& Dictionary() const;
+
+      //! Creates a narrowed column from stored values, e.g. from a file.  
+      //! The codes of a StorageType_Bool or StorageType_Enum column are
+      //! checked since the values may not have been stored by this class.
+      //! @param eType       Representation of the values
+      //! @param pData       Stored values, nValues*ElementSize() bytes
+      //! @param nValues     Number of values
+      //! @param dictionary  Values indexed by a StorageType_Enum column
+      //! @param column      Column created from the values
+      //! @retval true  If every value is valid for the representation
+      //! @retval false Otherwise, leaving column unchanged
+      static bool FromRaw( 
+         StorageType eType, 
+         const char* pData, 
+         int nValues,
+         const QVector<double>& dictionary,
+         NumericColumn& column );
+
+   private:
+      //! Checks whether a value can be held in a representation.  For the
+      //! current representation of an enum the dictionary must have room.
+      bool Fits( StorageType eType, double value ) const;
+
+      //! Appends a value known to fit the current representation.
+      void Store( double value );
+
+      //! Appends the code of a value to an enum column, adding the value to
+      //! the dictionary when there is room.  The value is looked up once.
+      //! @return False if the value isn't in a full dictionary
+      bool StoreCode( double value );
+
+      //! Returns the code of a value in the dictionary, -1 if it isn't there.
+      int FindCode( double value ) const;
+
+      //! Rebuilds the sorted index of the dictionary.
+      void IndexDictionary();
+
+      //! Converts to the narrowest wider representation holding every value
+      //! along with the new one, which is appended.
+      void Widen( double value );
+
+      StorageType     m_eType;      //!< Representation of the values
+      bool            m_bNarrowed;  //!< Flag indicating values are validated as appended
+      QVector<double> m_f64;        //!< Values of a StorageType_Float64 column
+      QVector<float>  m_f32;        //!< Values of a StorageType_Float32 column
+      QVector<qint32> m_i32;        //!< Values of a StorageType_Int32 column
+      QVector<quint8> m_u8;         //!< Values of a bool or codes of an enum column
+      QVector<double> m_dictionary; //!< Values indexed by the codes of an enum column
+      QVector<double> m_sorted;     //!< Dictionary values in ascending order for searching
+      QVector<quint8> m_codes;      //!< Codes of the values in m_sorted
+   };
+
+   //! Block of parsed data waiting to be stored.  The statements in data are
+   //! executed first, followed by the rows held in the value columns.  Values
+   //! are kept in their binary form so they are only converted from text once.
    class DataBuffer
    {
    public:
       DataBuffer();
 
-      QStringList data;
-      QString     sFlightName;
-      bool        bLastBuffer;
+      //! Removes all statements and rows from the buffer.
+      void Clear();
+
+      //! Approximate number of bytes held by the statements and rows.
+      qint64 Bytes() const;
+
+      //! Exchanges the contents with another buffer.  This is how buffers
+      //! are handed from one owner to the next without copying.
+      void Swap( DataBuffer& other );
+
+      QStringList                data;        //!< Statements, e.g. to create the table
+      ColumnDefList              columns;     //!< Definitions of the value columns
+      QVector< NumericColumn >   numeric;     //!< Numeric values per column, NaN if missing
+      QVector< QStringList >     text;        //!< String values per column
+      int                        nRows;       //!< Number of rows in the value columns
+      QString                    sFlightName; //!< Flight the data belongs to
+      bool                       bFirstBuffer;//!< First buffer of the flight, creating its table
+      bool                       bLastBuffer; //!< Last buffer of the flight
+      bool                       bAborted;    //!< Flight was abandoned and has no last buffer
    };
 
    
@@ -70,7 +70,7 @@ void DockWidgetAttributes::PopulateTree(const QString& sFlightName, Data::DataMg
    }
 
    QTreeWidgetItem* item;
-   const Data::ColumnDefList& columns = dataMgmt->GetColumnDefinitions(sFlightName);
+   Data::ColumnDefList columns = dataMgmt->GetColumnDefinitions(sFlightName);
    for( int i = 0; i < columns.size(); ++i )
    {
       const Data::ColumnDef& col = columns.at(i);
@@ -17,7 +17,6 @@
 
 #include <iostream>
 
-#include "DataSelections.h"
 #include "DataNormalizer.h"
 
 #include "EventDetector.h"
@@ -102,16 +101,17 @@ namespace Event
       Data::DataMgmt* dataMgmt, 
       Data::EventData& evtData )
    {
-      Data::DataSelections dataSel;
-      dataSel.SetDataMgmt(dataMgmt);
-      dataSel.SetSelection( sFlightName, "Vel_Indicated_kts");
-      dataSel.SetSelection( sFlightName, "Altitude_FtAgl");
-      dataSel.SetSelection( sFlightName, "Flaps_Handle");
-      dataSel.SetSelection( sFlightName, "RunwayThreshold");
-      dataSel.SetSelection( sFlightName, "Gear");
+      QStringList attributes;
+      attributes << "Vel_Indicated_kts";
+      attributes << "Altitude_FtAgl";
+      attributes << "Flaps_Handle";
+      attributes << "RunwayThreshold";
+      attributes << "Gear";
 
-      Data::FlightDatabase data;
-      dataSel.GetDataAttributes(data);
+      // The rows are read a block at a time so that a long flight is never
+      // held in memory all at once.
+      Data::AttributeCursor cursor;
+      dataMgmt->OpenCursor( sFlightName, attributes, cursor );
 
       Data::EventValue evt;
       
@@ -162,90 +162,96 @@ namespace Event
       }
       
       QMap<int, int> eventTimes;
-      Data::FlightDatabase::iterator i = data.begin();
-      for( ; i != data.end(); ++i )
+      Data::Buffer block;
+      while( cursor.Next(block) )
       {
-         for( int j = 0; j < i.value()._params.size(); ++j )
+         // Each attribute is scanned straight from its column.
+         const unsigned int* pTime     = block.Times();
+         const double*       pIAS      = block.Values(IASIdx);
+         const double*       pAltAgl   = block.Values(AltAglIdx);
+         const double*       pFlapHdl  = block.Values(FlapHdlIdx);
+         const double*       pOnRunway = block.Values(OnRunwayIdx);
+         const double*       pGear     = block.Values(GearIdx);
+         for( int j = 0; j < block.RowCount(); ++j )
          {
-            const Data::Point& p = i.value()._params.at(j);
          
-            if( !evtData[nVFe40]._bFound && p._dataVector.at(FlapHdlIdx).toDouble() > 0.5 )
+            if( !evtData[nVFe40]._bFound && pFlapHdl[j] > 0.5 )
             {
                evtData[nVFe40]._bFound      = true;
-               evtData[nVFe40]._time        = p._time;
-               evtData[nVFe40]._value       = p._dataVector.at(IASIdx).toDouble();
+               evtData[nVFe40]._time        = pTime[j];
+               evtData[nVFe40]._value       = pIAS[j];
                evtData[nVFe40]._valueNormal = Normalizer::Normalize
-                  ( p._dataVector.at(IASIdx).toDouble()
-                  , nMinVFe40 //i.value()._metadata.at(IASIdx)._min
-                  , nMaxVFe40 //i.value()._metadata.at(IASIdx)._max 
+                  ( pIAS[j]
+                  , nMinVFe40 //block._metadata.at(IASIdx)._min
+                  , nMaxVFe40 //block._metadata.at(IASIdx)._max 
                   );
                
-               eventTimes[0] = p._time;
+               eventTimes[0] = pTime[j];
             }
             
-            if( !evtData[nVLg]._bFound && p._dataVector.at(GearIdx).toDouble() > 0.5 )
+            if( !evtData[nVLg]._bFound && pGear[j] > 0.5 )
             {
                evtData[nVLg]._bFound      = true;
-               evtData[nVLg]._time        = p._time;
-               evtData[nVLg]._value       = p._dataVector.at(IASIdx).toDouble();
+               evtData[nVLg]._time        = pTime[j];
+               evtData[nVLg]._value       = pIAS[j];
                evtData[nVLg]._valueNormal = Normalizer::Normalize
-                  ( p._dataVector.at(IASIdx).toDouble()
-                  , nMinVLg //i.value()._metadata.at(IASIdx)._min
-                  , nMaxVLg //i.value()._metadata.at(IASIdx)._max
+                  ( pIAS[j]
+                  , nMinVLg //block._metadata.at(IASIdx)._min
+                  , nMaxVLg //block._metadata.at(IASIdx)._max
                   );
                
-               eventTimes[1] = p._time;
+               eventTimes[1] = pTime[j];
             }
             
-            if( !evtData[nVFe100]._bFound && p._dataVector.at(FlapHdlIdx).toDouble() == 1 )
+            if( !evtData[nVFe100]._bFound && pFlapHdl[j] == 1 )
             {
                evtData[nVFe100]._bFound      = true;
-               evtData[nVFe100]._time        = p._time;
-               evtData[nVFe100]._value       = p._dataVector.at(IASIdx).toDouble();
+               evtData[nVFe100]._time        = pTime[j];
+               evtData[nVFe100]._value       = pIAS[j];
                evtData[nVFe100]._valueNormal = Normalizer::Normalize
-                  ( p._dataVector.at(IASIdx).toDouble()
-                  , nMinVFe100 //i.value()._metadata.at(IASIdx)._min
-                  , nMaxVFe100 //i.value()._metadata.at(IASIdx)._max
+                  ( pIAS[j]
+                  , nMinVFe100 //block._metadata.at(IASIdx)._min
+                  , nMaxVFe100 //block._metadata.at(IASIdx)._max
                   );
                
-               eventTimes[2] = p._time;
+               eventTimes[2] = pTime[j];
             }
             
-            if( !evtData[nVThrshld]._bFound && p._dataVector.at(OnRunwayIdx).toDouble() > 0.5 )
+            if( !evtData[nVThrshld]._bFound && pOnRunway[j] > 0.5 )
             {
                evtData[nVThrshld]._bFound      = true;
-               evtData[nVThrshld]._time        = p._time;
-               evtData[nVThrshld]._value       = p._dataVector.at(IASIdx).toDouble();
+               evtData[nVThrshld]._time        = pTime[j];
+               evtData[nVThrshld]._value       = pIAS[j];
                evtData[nVThrshld]._valueNormal = Normalizer::Normalize
-                  ( p._dataVector.at(IASIdx).toDouble()
-                  , nMinVThrshld //i.value()._metadata.at(IASIdx)._min
-                  , nMaxVThrshld //i.value()._metadata.at(IASIdx)._max
+                  ( pIAS[j]
+                  , nMinVThrshld //block._metadata.at(IASIdx)._min
+                  , nMaxVThrshld //block._metadata.at(IASIdx)._max
                   );
                
                evtData[nAltThrshld]._bFound      = true;
-               evtData[nAltThrshld]._time        = p._time+1; //!@todo Remove the plus 1
-               evtData[nAltThrshld]._value       = p._dataVector.at(AltAglIdx).toDouble();
+               evtData[nAltThrshld]._time        = pTime[j]+1; //!@todo Remove the plus 1
+               evtData[nAltThrshld]._value       = pAltAgl[j];
                evtData[nAltThrshld]._valueNormal = Normalizer::Normalize
-                  ( p._dataVector.at(AltAglIdx).toDouble()
-                  , nMinAltThrshld //i.value()._metadata.at(AltAglIdx)._min
-                  , nMaxAltThrshld //i.value()._metadata.at(AltAglIdx)._max
+                  ( pAltAgl[j]
+                  , nMinAltThrshld //block._metadata.at(AltAglIdx)._min
+                  , nMaxAltThrshld //block._metadata.at(AltAglIdx)._max
                   );
                
-               eventTimes[3] = p._time;
+               eventTimes[3] = pTime[j];
             }
             
-            if( !evtData[nVTouchdown]._bFound && p._dataVector.at(AltAglIdx).toDouble() < 1.0 )
+            if( !evtData[nVTouchdown]._bFound && pAltAgl[j] < 1.0 )
             {
                if( !bPotentialLanding )
                {
                   // This is the beginning of a potential landing event.  
                   // Capture the time to see if the condition hold long 
                   // enough to count as the event.
-                  nLandingTime = p._time;
-                  fLandingIAS  = p._dataVector.at(IASIdx).toDouble();
+                  nLandingTime = pTime[j];
+                  fLandingIAS  = pIAS[j];
                   bPotentialLanding = true;
                }
-               else if( static_cast<unsigned int>(nLandingTime+150000) > p._time )
+               else if( static_cast<unsigned int>(nLandingTime+150000) > pTime[j] )
                {
                   // Landing condition must hold for 15 seconds to be true.
                   evtData[nVTouchdown]._bFound      = true;
@@ -253,8 +259,8 @@ namespace Event
                   evtData[nVTouchdown]._value       = fLandingIAS;
                   evtData[nVTouchdown]._valueNormal = Normalizer::Normalize
                      ( fLandingIAS
-                     , nMinVTouchdown //i.value()._metadata.at(IASIdx)._min
-                     , nMaxVTouchdown //i.value()._metadata.at(IASIdx)._max
+                     , nMinVTouchdown //block._metadata.at(IASIdx)._min
+                     , nMaxVTouchdown //block._metadata.at(IASIdx)._max
                      );
                
                   eventTimes[4] = nLandingTime;
@@ -0,0 +1,462 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMap>
+#include <QMutex>
+#include <QSysInfo>
+
+#include "FlightCache.h"
+
+using namespace std;
+
+
+namespace Data
+{
+   // Identifies a flight cache file, "FLTC".
+   const quint32 nMagic = 0x464C5443;
+
+   const quint32 FlightCache::nVersion = 3;
+
+   // Format of the QDataStream portion of the file.
+   const int nStreamVersion = QDataStream::Qt_4_6;
+
+   // Alignment of the numeric columns within the file.
+   const qint64 llAlignment = sizeof(double);
+
+   // Size of the blocks read while hashing a source file.
+   const qint64 llHashBlockSize = 1024*1024;
+
+   // Directory holding the cache files.
+   static QString s_sDirectory = QDir(QDir::tempPath()).filePath("FlightCache");
+
+   // Identifies the index of the source files, "FLTI".
+   const quint32 nIndexMagic = 0x464C5449;
+
+   // File in the cache directory recording the hash of each source file
+   // with its size and time, so an unchanged file isn't read to find its
+   // cache file.
+   static const char* const sIndexFile = "sources.index";
+
+   // Size, time and hash of a source file when it was last hashed.
+   struct SourceEntry
+   {
+      qint64  llSize;
+      qint64  llModified;
+      QString sHash;
+   };
+
+   // Index of the source files by absolute path, read from the directory
+   // it was loaded from.  Parsers look up their files concurrently.
+   static QMutex                    s_indexMutex;
+   static QMap<QString,SourceEntry> s_index;
+   static QString                   s_sIndexDirectory;
+
+   // Reads the index of the current directory, if it isn't already loaded.
+   // The index mutex must be held.
+   static void ReadIndex()
+   {
+      if( s_sIndexDirectory == s_sDirectory )
+      {
+         return;
+      }
+      s_sIndexDirectory = s_sDirectory;
+      s_index.clear();
+
+      QFile file( QDir(s_sDirectory).filePath(sIndexFile) );
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         return;
+      }
+      QDataStream stream( &file );
+      stream.setVersion( nStreamVersion );
+      quint32 nFileMagic = 0;
+      qint32  nEntries   = 0;
+      stream >> nFileMagic >> nEntries;
+      if( nFileMagic != nIndexMagic )
+      {
+         return;
+      }
+      for( int i = 0; i < nEntries && stream.status() == QDataStream::Ok; ++i )
+      {
+         QString     sPath;
+         SourceEntry entry;
+         stream >> sPath >> entry.llSize >> entry.llModified >> entry.sHash;
+         if( stream.status() == QDataStream::Ok )
+         {
+            s_index[sPath] = entry;
+         }
+      }
+   }
+
+   // Writes the index to the current directory.  The index mutex must be 
+   // held.
+   static void WriteIndex()
+   {
+      QDir().mkpath( s_sDirectory );
+      QFile file( QDir(s_sDirectory).filePath(sIndexFile) );
+      if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+      {
+         return;
+      }
+      QDataStream stream( &file );
+      stream.setVersion( nStreamVersion );
+      stream << nIndexMagic << static_cast<qint32>(s_index.size());
+      QMap<QString,SourceEntry>::const_iterator e = s_index.constBegin();
+      for( ; e != s_index.constEnd(); ++e )
+      {
+         stream << e.key() << e.value().llSize << e.value().llModified << e.value().sHash;
+      }
+   }
+
+
+   // Rounds an offset up to the alignment of the numeric columns.
+   static qint64 Align( qint64 llOffset )
+   {
+      return (llOffset + llAlignment - 1) / llAlignment * llAlignment;
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   void FlightCache::SetDirectory( const QString& sDirectory )
+   {
+      s_sDirectory = sDirectory;
+   }
+
+   QString FlightCache::GetDirectory()
+   {
+      return s_sDirectory;
+   }
+
+   QString FlightCache::Hash( const QString& sSourceFile )
+   {
+      QFile file( sSourceFile );
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         return QString();
+      }
+
+      QCryptographicHash hash( QCryptographicHash::Sha1 );
+      while( !file.atEnd() )
+      {
+         QByteArray block = file.read( llHashBlockSize );
+         if( block.isEmpty() )
+         {
+            return QString();
+         }
+         hash.addData( block );
+      }
+      return QString::fromLatin1( hash.result().toHex() );
+   }
+
+   QString FlightCache::SourceHash( const QString& sSourceFile )
+   {
+      QFileInfo info( sSourceFile );
+      if( !info.exists() )
+      {
+         return QString();
+      }
+      QString sPath      = info.absoluteFilePath();
+      qint64  llSize     = info.size();
+      qint64  llModified = info.lastModified().toTime_t();
+
+      // The size and time of the file are enough to tell it's unchanged, 
+      // the same as for the flight catalog.  Otherwise it is read again.
+      QString sHash;
+      s_indexMutex.lock();
+      ReadIndex();
+      QMap<QString,SourceEntry>::const_iterator e = s_index.constFind( sPath );
+      if( e != s_index.constEnd() && 
+          e.value().llSize == llSize && e.value().llModified == llModified )
+      {
+         sHash = e.value().sHash;
+      }
+      s_indexMutex.unlock();
+
+      if( sHash.isEmpty() )
+      {
+         sHash = Hash( sSourceFile );
+         if( sHash.isEmpty() )
+         {
+            return QString();
+         }
+
+         SourceEntry entry;
+         entry.llSize     = llSize;
+         entry.llModified = llModified;
+         entry.sHash      = sHash;
+         s_indexMutex.lock();
+         ReadIndex();
+         s_index[sPath] = entry;
+         WriteIndex();
+         s_indexMutex.unlock();
+      }
+      return sHash;
+   }
+
+   QString FlightCache::CacheFile( const QString& sSourceFile )
+   {
+      QString sHash = SourceHash( sSourceFile );
+      if( sHash.isEmpty() )
+      {
+         return QString();
+      }
+      return QDir(s_sDirectory).filePath( sHash + ".flight" );
+   }
+
+   bool FlightCache::Write( 
+      const QString& sCacheFile,
+      const DataBuffer& store,
+      const QList<Metadata>& stats,
+      const EventData& events )
+   {
+      QDir().mkpath( QFileInfo(sCacheFile).absolutePath() );
+
+      // Write to a temporary file first so that a cache file is never seen
+      // partially written.
+      QString sTempFile = sCacheFile + ".tmp";
+      QFile file( sTempFile );
+      if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+      {
+         cerr << "Unable to write flight cache " << qPrintable(sTempFile) << endl;
+         return false;
+      }
+
+      QDataStream stream( &file );
+      stream.setVersion( nStreamVersion );
+      stream << nMagic << nVersion << static_cast<qint32>(QSysInfo::ByteOrder);
+
+      stream << static_cast<qint32>(store.nRows) << static_cast<qint32>(store.columns.size());
+      for( int i = 0; i < store.columns.size(); ++i )
+      {
+         const ColumnDef& def = store.columns.at(i);
+         stream << def.sParamName << def.sParamNameComp 
+            << static_cast<qint32>(def.eParamType) << def.bGood;
+      }
+
+      stream << static_cast<qint32>(stats.size());
+      for( int i = 0; i < stats.size(); ++i )
+      {
+         const Metadata& meta = stats.at(i);
+         stream << meta._min << meta._max << meta._sum << meta._avg 
+            << meta._var << meta._dev << meta._range 
+            << static_cast<quint32>(meta._count) << static_cast<quint32>(meta._nulls);
+      }
+
+      stream << static_cast<qint32>(events.size());
+      for( int i = 0; i < events.size(); ++i )
+      {
+         const EventValue& evt = events.at(i);
+         stream << evt._eventName << evt._eventDesc 
+            << static_cast<qint32>(evt._time) << static_cast<qint32>(evt._sequence)
+            << evt._value << evt._valueNormal << evt._bFound;
+      }
+
+      // Strings are kept in the stream, only numbers are stored raw.
+      for( int i = 0; i < store.columns.size(); ++i )
+      {
+         if( store.columns.at(i).bGood && store.columns.at(i).eParamType == ParamType_String )
+         {
+            stream << store.text.at(i);
+         }
+      }
+
+      // The representation of each numeric column is kept so the values
+      // are read back as they were stored.
+      for( int i = 0; i < store.columns.size(); ++i )
+      {
+         if( store.columns.at(i).bGood && store.columns.at(i).eParamType == ParamType_Numeric )
+         {
+            const NumericColumn& column = store.numeric.at(i);
+            stream << static_cast<qint32>(column.Type()) << column.Dictionary();
+         }
+      }
+
+      // The numeric columns follow, each aligned.
+      for( int i = 0; i < store.columns.size(); ++i )
+      {
+         if( store.columns.at(i).bGood && store.columns.at(i).eParamType == ParamType_Numeric )
+         {
+            const NumericColumn& column = store.numeric.at(i);
+            qint64 llPad = Align(file.pos()) - file.pos();
+            file.write( QByteArray(llPad, '\0') );
+            file.write( column.RawData(), 
+               static_cast<qint64>(column.size()) * column.ElementSize() );
+         }
+      }
+
+      bool bSuccess = stream.status() == QDataStream::Ok && file.error() == QFile::NoError;
+      file.close();
+      if( !bSuccess )
+      {
+         cerr << "Unable to write flight cache " << qPrintable(sTempFile) << endl;
+         QFile::remove( sTempFile );
+         return false;
+      }
+
+      QFile::remove( sCacheFile );
+      return QFile::rename( sTempFile, sCacheFile );
+   }
+
+   bool FlightCache::Read( 
+      const QString& sCacheFile,
+      DataBuffer& store,
+      QList<Metadata>& stats,
+      EventData& events )
+   {
+      QFile file( sCacheFile );
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         return false;
+      }
+      qint64 llFileSize = file.size();
+      const char* pMap = reinterpret_cast<const char*>( file.map(0, llFileSize) );
+      if( !pMap )
+      {
+         return false;
+      }
+
+      // The stream reads the header in place from the mapped file.
+      QByteArray contents = QByteArray::fromRawData( pMap, static_cast<int>(llFileSize) );
+      QDataStream stream( contents );
+      stream.setVersion( nStreamVersion );
+
+      quint32 nFileMagic, nFileVersion;
+      qint32  nByteOrder;
+      stream >> nFileMagic >> nFileVersion >> nByteOrder;
+      if( stream.status() != QDataStream::Ok || nFileMagic != nMagic || 
+          nFileVersion != nVersion || nByteOrder != QSysInfo::ByteOrder )
+      {
+         return false;
+      }
+
+      qint32 nRows, nColumns;
+      stream >> nRows >> nColumns;
+      if( nRows < 0 || nColumns < 0 )
+      {
+         return false;
+      }
+      ColumnDefList columns;
+      for( int i = 0; i < nColumns && stream.status() == QDataStream::Ok; ++i )
+      {
+         ColumnDef def;
+         qint32 nType;
+         stream >> def.sParamName >> def.sParamNameComp >> nType >> def.bGood;
+         if( nType != ParamType_String && nType != ParamType_Numeric )
+         {
+            return false;
+         }
+         def.eParamType = static_cast<ParamType>(nType);
+         columns.push_back( def );
+      }
+
+      qint32 nStats;
+      stream >> nStats;
+      stats.clear();
+      for( int i = 0; i < nStats && stream.status() == QDataStream::Ok; ++i )
+      {
+         Metadata meta;
+         quint32 nCount, nNulls;
+         stream >> meta._min >> meta._max >> meta._sum >> meta._avg 
+            >> meta._var >> meta._dev >> meta._range >> nCount >> nNulls;
+         meta._count      = nCount;
+         meta._nulls      = nNulls;
+         meta._definition = 0;
+         stats.push_back( meta );
+      }
+
+      qint32 nEvents;
+      stream >> nEvents;
+      events.clear();
+      for( int i = 0; i < nEvents && stream.status() == QDataStream::Ok; ++i )
+      {
+         EventValue evt;
+         qint32 nTime, nSequence;
+         stream >> evt._eventName >> evt._eventDesc >> nTime >> nSequence
+            >> evt._value >> evt._valueNormal >> evt._bFound;
+         evt._time     = nTime;
+         evt._sequence = nSequence;
+         events.push_back( evt );
+      }
+
+      store.Clear();
+      store.columns = columns;
+      store.numeric.resize( nColumns );
+      store.text.resize( nColumns );
+      store.nRows = nRows;
+      for( int i = 0; i < nColumns; ++i )
+      {
+         if( columns.at(i).bGood && columns.at(i).eParamType == ParamType_String )
+         {
+            stream >> store.text[i];
+            if( store.text.at(i).size() != nRows )
+            {
+               return false;
+            }
+         }
+      }
+      QVector<qint32>           types( nColumns );
+      QVector< QVector<double> > dictionaries( nColumns );
+      for( int i = 0; i < nColumns; ++i )
+      {
+         if( columns.at(i).bGood && columns.at(i).eParamType == ParamType_Numeric )
+         {
+            stream >> types[i] >> dictionaries[i];
+            if( types.at(i) < StorageType_Bool || types.at(i) > StorageType_Float64 )
+            {
+               return false;
+            }
+         }
+      }
+      if( stream.status() != QDataStream::Ok )
+      {
+         return false;
+      }
+
+      // Copy the numeric columns out of the mapped file.
+      qint64 llOffset = stream.device()->pos();
+      for( int i = 0; i < nColumns; ++i )
+      {
+         if( columns.at(i).bGood && columns.at(i).eParamType == ParamType_Numeric )
+         {
+            StorageType eType = static_cast<StorageType>(types.at(i));
+            qint64 llBytes = static_cast<qint64>(nRows) * NumericColumn(eType).ElementSize();
+            llOffset = Align(llOffset);
+            if( llOffset + llBytes > llFileSize )
+            {
+               return false;
+            }
+            if( !NumericColumn::FromRaw( eType, pMap + llOffset, nRows, 
+                                         dictionaries.at(i), store.numeric[i] ) ||
+                store.numeric.at(i).size() != nRows )
+            {
+               return false;
+            }
+            llOffset += llBytes;
+         }
+      }
+
+      return true;
+   }
+};
@@ -0,0 +1,105 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLIGHTCACHE_H
+#define FLIGHTCACHE_H
+
+#include <QString>
+#include <QList>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   //! Reads and writes the binary cache of a parsed flight so that a file 
+   //! that was opened before doesn't have to be parsed again.  The cache 
+   //! holds the column definitions, the value of every column, statistics
+   //! of each column and the detected events.  Cache files are named by a
+   //! hash of the source file's contents so an edited file is parsed again.
+   //!
+   //! The file starts with a header written through QDataStream holding 
+   //! everything but the numeric columns.  The numeric columns follow as 
+   //! arrays in their narrowed representation and the byte order of the 
+   //! writer, each aligned to 8 bytes, so they can be copied straight out
+   //! of the mapped file.
+   class FlightCache
+   {
+   public:
+      //! Version of the format.  Files of any other version are ignored.
+      static const quint32 nVersion;
+
+      //! Sets the directory holding the cache files.  It is created when the
+      //! first cache file is written.
+      static void SetDirectory( const QString& sDirectory );
+
+      //! Returns the directory holding the cache files.
+      static QString GetDirectory();
+
+      //! Computes a hash of the contents of a file.
+      //! @param sSourceFile  Path of the file
+      //! @return SHA-1 of the contents in hex, or an empty string if the 
+      //!         file cannot be read
+      static QString Hash( const QString& sSourceFile );
+
+      //! Returns the hash of a source file, see Hash().  The hash of each 
+      //! file is kept with its size and time so an unchanged file isn't read
+      //! again.  A changed one is, so call this from a worker thread, e.g.
+      //! the ingest job of the file.
+      //! @param sSourceFile  Path of the CSV file
+      //! @return SHA-1 of the contents in hex, or an empty string if the 
+      //!         file cannot be read
+      static QString SourceHash( const QString& sSourceFile );
+
+      //! Computes the cache file of a source file from its contents, see 
+      //! SourceHash().
+      //! @param sSourceFile  Path of the CSV file
+      //! @return Path of the cache file, which may not exist, or an empty
+      //!         string if the source cannot be read
+      static QString CacheFile( const QString& sSourceFile );
+
+      //! Writes a flight to a cache file.  The file is replaced only once it
+      //! is completely written.
+      //! @param sCacheFile  Path of the cache file
+      //! @param store       Columns of the flight
+      //! @param stats       Statistics of each column of the flight
+      //! @param events      Events detected in the flight
+      //! @retval true  If the cache was written
+      //! @retval false Otherwise
+      static bool Write( 
+         const QString& sCacheFile,
+         const DataBuffer& store,
+         const QList<Metadata>& stats,
+         const EventData& events );
+
+      //! Reads a flight from a cache file.  A file whose columns don't all
+      //! hold a value for each row, or whose codes don't match their 
+      //! dictionaries, isn't valid.
+      //! @param sCacheFile  Path of the cache file
+      //! @param store       Columns of the flight
+      //! @param stats       Statistics of each column of the flight
+      //! @param events      Events detected in the flight
+      //! @retval true  If the cache was read
+      //! @retval false If it doesn't exist or isn't a valid cache file
+      static bool Read( 
+         const QString& sCacheFile,
+         DataBuffer& store,
+         QList<Metadata>& stats,
+         EventData& events );
+   };
+};
+#endif // FLIGHTCACHE_H
@@ -0,0 +1,362 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "FlightCatalog.h"
+
+using namespace std;
+
+
+namespace Data
+{
+   // Format of the serialized column definitions.
+   const int nColumnStreamVersion = QDataStream::Qt_4_6;
+
+   // Serializes column definitions for the catalog.
+   static QByteArray WriteColumns( const ColumnDefList& defList )
+   {
+      QByteArray bytes;
+      QDataStream stream( &bytes, QIODevice::WriteOnly );
+      stream.setVersion( nColumnStreamVersion );
+      stream << static_cast<qint32>(defList.size());
+      for( int i = 0; i < defList.size(); ++i )
+      {
+         const ColumnDef& def = defList.at(i);
+         stream << def.sParamName << def.sParamNameComp 
+            << static_cast<qint32>(def.eParamType) << def.bGood;
+      }
+      return bytes;
+   }
+
+   // Reads column definitions written by WriteColumns().
+   static bool ReadColumns( const QByteArray& bytes, ColumnDefList& defList )
+   {
+      QDataStream stream( bytes );
+      stream.setVersion( nColumnStreamVersion );
+      qint32 nColumns = 0;
+      stream >> nColumns;
+      for( int i = 0; i < nColumns && stream.status() == QDataStream::Ok; ++i )
+      {
+         ColumnDef def;
+         qint32 nType = 0;
+         stream >> def.sParamName >> def.sParamNameComp >> nType >> def.bGood;
+         def.eParamType = static_cast<ParamType>(nType);
+         defList.push_back( def );
+      }
+      return stream.status() == QDataStream::Ok && !defList.empty();
+   }
+
+   // Serializes the statistics of the columns for the catalog.
+   static QByteArray WriteStatistics( const QList<Metadata>& stats )
+   {
+      QByteArray bytes;
+      QDataStream stream( &bytes, QIODevice::WriteOnly );
+      stream.setVersion( nColumnStreamVersion );
+      stream << static_cast<qint32>(stats.size());
+      for( int i = 0; i < stats.size(); ++i )
+      {
+         const Metadata& meta = stats.at(i);
+         stream << meta._min << meta._max << meta._sum << meta._avg 
+            << meta._var << meta._dev << meta._range 
+            << static_cast<quint32>(meta._count) << static_cast<quint32>(meta._nulls);
+      }
+      return bytes;
+   }
+
+   // Reads statistics written by WriteStatistics().  Catalogs from before
+   // the statistics were kept have none.
+   static bool ReadStatistics( const QByteArray& bytes, QList<Metadata>& stats )
+   {
+      QDataStream stream( bytes );
+      stream.setVersion( nColumnStreamVersion );
+      qint32 nStats = 0;
+      stream >> nStats;
+      for( int i = 0; i < nStats && stream.status() == QDataStream::Ok; ++i )
+      {
+         Metadata meta;
+         quint32 nCount = 0, nNulls = 0;
+         stream >> meta._min >> meta._max >> meta._sum >> meta._avg 
+            >> meta._var >> meta._dev >> meta._range >> nCount >> nNulls;
+         meta._count      = nCount;
+         meta._nulls      = nNulls;
+         meta._definition = 0;
+         stats.push_back( meta );
+      }
+      return stream.status() == QDataStream::Ok;
+   }
+
+   // Reports a failed catalog query.
+   static void ReportError( const QSqlQuery& q )
+   {
+      cerr << "Flight catalog query failed: " << qPrintable(q.lastQuery()) << endl;
+      cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   FlightCatalog::FlightCatalog()
+   {
+   }
+
+   bool FlightCatalog::Open( const QString& sConnectionName )
+   {
+      QSqlQuery q( QSqlDatabase::database(sConnectionName) );
+      if( !q.exec("CREATE TABLE IF NOT EXISTS FlightCatalog("
+                  "Flight VARCHAR(255) PRIMARY KEY, Path TEXT, Size INTEGER, "
+                  "Modified INTEGER, Hash VARCHAR(40), Columns BLOB, Statistics BLOB)") ||
+          !q.exec("CREATE TABLE IF NOT EXISTS FlightCatalogEvents("
+                  "Flight VARCHAR(255), Name TEXT, Description TEXT, Time INTEGER, "
+                  "Sequence INTEGER, Value, NormalValue, Found INTEGER)") ||
+          !q.exec("CREATE INDEX IF NOT EXISTS FlightCatalogEvents_Flight "
+                  "ON FlightCatalogEvents(Flight)") )
+      {
+         ReportError( q );
+         return false;
+      }
+
+      // Catalogs from before the statistics were kept gain their column.
+      if( !q.exec("SELECT Statistics FROM FlightCatalog LIMIT 0") &&
+          !q.exec("ALTER TABLE FlightCatalog ADD COLUMN Statistics BLOB") )
+      {
+         ReportError( q );
+         return false;
+      }
+
+      m_sConnectionName = sConnectionName;
+      return true;
+   }
+
+   bool FlightCatalog::IsOpen() const
+   {
+      return !m_sConnectionName.isEmpty();
+   }
+
+   bool FlightCatalog::Find( 
+      const QString& sFlightName, 
+      const QString& sSourceFile,
+      const QString& sHash,
+      ColumnDefList& defList,
+      QList<Metadata>& stats,
+      EventData& events )
+   {
+      if( !IsOpen() )
+      {
+         return false;
+      }
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      q.prepare( "SELECT Path, Size, Modified, Hash, Columns, Statistics "
+                 "FROM FlightCatalog WHERE Flight = ?" );
+      q.addBindValue( sFlightName );
+      if( !q.exec() || !q.next() )
+      {
+         return false;
+      }
+      QString    sPath      = q.value(0).toString();
+      qint64     llSize     = q.value(1).toLongLong();
+      qint64     llModified = q.value(2).toLongLong();
+      QString    sRecorded  = q.value(3).toString();
+      QByteArray columns    = q.value(4).toByteArray();
+      QByteArray statistics = q.value(5).toByteArray();
+
+      // The size and time of the file are enough to tell it's unchanged.  A
+      // file that was copied or touched is compared by its contents.
+      QFileInfo info( sSourceFile );
+      if( !info.exists() || info.size() != llSize )
+      {
+         return false;
+      }
+      qint64 llFileModified = info.lastModified().toTime_t();
+      QString sFilePath = info.absoluteFilePath();
+      if( sFilePath != sPath || llFileModified != llModified )
+      {
+         if( sHash.isEmpty() || sHash != sRecorded )
+         {
+            return false;
+         }
+
+         q.prepare( "UPDATE FlightCatalog SET Path = ?, Modified = ? WHERE Flight = ?" );
+         q.addBindValue( sFilePath );
+         q.addBindValue( llFileModified );
+         q.addBindValue( sFlightName );
+         if( !q.exec() )
+         {
+            ReportError( q );
+         }
+      }
+
+      // The table must still be there, e.g. it wasn't dropped by hand.  It
+      // may be in a shard attached to the database, see DataMgmt::SetShards().
+      QString sTable = "\"" + QString(sFlightName).replace("\"", "\"\"") + "\"";
+      if( !q.exec( "SELECT * FROM " + sTable + " LIMIT 0" ) )
+      {
+         return false;
+      }
+
+      ColumnDefList found;
+      if( !ReadColumns( columns, found ) )
+      {
+         return false;
+      }
+      QList<Metadata> foundStats;
+      if( !ReadStatistics( statistics, foundStats ) || foundStats.size() != found.size() )
+      {
+         foundStats.clear();
+      }
+
+      q.prepare( "SELECT Name, Description, Time, Sequence, Value, NormalValue, Found "
+                 "FROM FlightCatalogEvents WHERE Flight = ? ORDER BY rowid" );
+      q.addBindValue( sFlightName );
+      if( !q.exec() )
+      {
+         ReportError( q );
+         return false;
+      }
+      EventData recorded;
+      while( q.next() )
+      {
+         EventValue evt;
+         evt._eventName   = q.value(0).toString();
+         evt._eventDesc   = q.value(1).toString();
+         evt._time        = q.value(2).toInt();
+         evt._sequence    = q.value(3).toInt();
+         evt._value       = q.value(4);
+         evt._valueNormal = q.value(5);
+         evt._bFound      = q.value(6).toBool();
+         recorded.push_back( evt );
+      }
+
+      defList = found;
+      stats   = foundStats;
+      events  = recorded;
+      return true;
+   }
+
+   bool FlightCatalog::Record( 
+      const QString& sFlightName, 
+      const QString& sSourceFile,
+      const QString& sHash,
+      const ColumnDefList& defList,
+      const QList<Metadata>& stats )
+   {
+      if( !IsOpen() || sHash.isEmpty() )
+      {
+         return false;
+      }
+
+      QFileInfo info( sSourceFile );
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      q.prepare( "INSERT OR REPLACE INTO FlightCatalog "
+                 "(Flight, Path, Size, Modified, Hash, Columns, Statistics) "
+                 "VALUES (?, ?, ?, ?, ?, ?, ?)" );
+      q.addBindValue( sFlightName );
+      q.addBindValue( info.absoluteFilePath() );
+      q.addBindValue( info.size() );
+      q.addBindValue( static_cast<qint64>(info.lastModified().toTime_t()) );
+      q.addBindValue( sHash );
+      q.addBindValue( WriteColumns(defList) );
+      q.addBindValue( WriteStatistics(stats) );
+      if( !q.exec() )
+      {
+         ReportError( q );
+         return false;
+      }
+      return true;
+   }
+
+   bool FlightCatalog::Contains( const QString& sFlightName ) const
+   {
+      if( !IsOpen() )
+      {
+         return false;
+      }
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      q.prepare( "SELECT COUNT(*) FROM FlightCatalog WHERE Flight = ?" );
+      q.addBindValue( sFlightName );
+      return q.exec() && q.next() && q.value(0).toInt() > 0;
+   }
+
+   bool FlightCatalog::RecordEvents( const QString& sFlightName, const EventData& events )
+   {
+      if( !IsOpen() )
+      {
+         return false;
+      }
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      q.prepare( "DELETE FROM FlightCatalogEvents WHERE Flight = ?" );
+      q.addBindValue( sFlightName );
+      if( !q.exec() )
+      {
+         ReportError( q );
+         return false;
+      }
+
+      q.prepare( "INSERT INTO FlightCatalogEvents "
+                 "(Flight, Name, Description, Time, Sequence, Value, NormalValue, Found) "
+                 "VALUES (?, ?, ?, ?, ?, ?, ?, ?)" );
+      for( int e = 0; e < events.size(); ++e )
+      {
+         const EventValue& evt = events.at(e);
+         q.addBindValue( sFlightName );
+         q.addBindValue( evt._eventName );
+         q.addBindValue( evt._eventDesc );
+         q.addBindValue( evt._time );
+         q.addBindValue( evt._sequence );
+         q.addBindValue( evt._value );
+         q.addBindValue( evt._valueNormal );
+         q.addBindValue( evt._bFound ? 1 : 0 );
+         if( !q.exec() )
+         {
+            ReportError( q );
+            return false;
+         }
+      }
+      return true;
+   }
+
+   bool FlightCatalog::Remove( const QString& sFlightName )
+   {
+      if( !IsOpen() )
+      {
+         return false;
+      }
+
+      QSqlQuery q( QSqlDatabase::database(m_sConnectionName) );
+      q.prepare( "DELETE FROM FlightCatalog WHERE Flight = ?" );
+      q.addBindValue( sFlightName );
+      bool bSuccess = q.exec();
+      q.prepare( "DELETE FROM FlightCatalogEvents WHERE Flight = ?" );
+      q.addBindValue( sFlightName );
+      bSuccess = q.exec() && bSuccess;
+      if( !bSuccess )
+      {
+         ReportError( q );
+      }
+      return bSuccess;
+   }
+};
@@ -0,0 +1,100 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLIGHTCATALOG_H
+#define FLIGHTCATALOG_H
+
+#include <QString>
+#include <QList>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   //! Catalog of the flights held in a database on disk so that a flight 
+   //! stored by an earlier session is used again rather than parsed.  Each
+   //! flight records the path, size, modification time and a hash of the
+   //! contents of its source file along with its column definitions, the
+   //! statistics of its columns and its events.  A flight is unchanged if the size and modification time 
+   //! match, or failing that, if the hash matches.
+   //!
+   //! A flight is only recorded once all of its rows are in its table and 
+   //! is removed before its table is replaced.
+   class FlightCatalog
+   {
+   public:
+      FlightCatalog();
+
+      //! Creates the catalog tables in a database if they don't exist.
+      //! @param sConnectionName  Connection of the database
+      //! @retval true  If the catalog is available
+      //! @retval false Otherwise
+      bool Open( const QString& sConnectionName );
+
+      //! Indicates the catalog has been opened.
+      bool IsOpen() const;
+
+      //! Looks for an unchanged flight whose table holds all of its rows.
+      //! @param sFlightName  Name of the flight's table
+      //! @param sSourceFile  Path of the file the flight would be parsed from
+      //! @param sHash        Hash of the file's contents, see 
+      //!                     FlightCache::SourceHash(), compared when its
+      //!                     path or time changed
+      //! @param defList      Column definitions of the flight
+      //! @param stats        Statistics of each column, empty if none were recorded
+      //! @param events       Events of the flight, empty if none were recorded
+      //! @retval true  If the flight can be used as is
+      //! @retval false If it must be loaded again
+      bool Find( 
+         const QString& sFlightName, 
+         const QString& sSourceFile,
+         const QString& sHash,
+         ColumnDefList& defList,
+         QList<Metadata>& stats,
+         EventData& events );
+
+      //! Records a flight once all of its rows are in its table.
+      //! @param sFlightName  Name of the flight's table
+      //! @param sSourceFile  Path of the file the flight was parsed from
+      //! @param sHash        Hash of the file's contents, see 
+      //!                     FlightCache::SourceHash()
+      //! @param defList      Column definitions of the flight
+      //! @param stats        Statistics of each column of the flight
+      //! @retval true  If the flight was recorded
+      //! @retval false Otherwise
+      bool Record( 
+         const QString& sFlightName, 
+         const QString& sSourceFile,
+         const QString& sHash,
+         const ColumnDefList& defList,
+         const QList<Metadata>& stats );
+
+      //! Indicates a flight is recorded.
+      bool Contains( const QString& sFlightName ) const;
+
+      //! Replaces the events recorded for a flight.
+      bool RecordEvents( const QString& sFlightName, const EventData& events );
+
+      //! Removes a flight and its events from the catalog.
+      bool Remove( const QString& sFlightName );
+
+   private:
+      QString m_sConnectionName; //!< Connection of the database, empty until opened
+   };
+};
+#endif // FLIGHTCATALOG_H
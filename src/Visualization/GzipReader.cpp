@@ -0,0 +1,224 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "GzipReader.h"
+
+using namespace std;
+
+
+namespace Parser
+{
+   const int GzipReader::nBlockSize = 1024*1024;
+   const int GzipReader::nMaxBlocks = 4;
+
+   // Number of compressed bytes read from the file at a time.
+   const int nInputSize = 256*1024;
+
+   // Adding 32 to the window bits has zlib detect the gzip header.
+   const int nWindowBits = 15 + 32;
+
+
+   // ==========================================================================
+   // ==========================================================================
+   GzipReader::GzipReader()
+      : m_bDone(false)
+      , m_bStop(false)
+      , m_bError(false)
+   {
+   }
+
+   GzipReader::~GzipReader()
+   {
+      Stop();
+
+      wait();
+   }
+
+   bool GzipReader::IsCompressed( const QString& sFilename )
+   {
+      QFile file( sFilename );
+      if( !file.open( QIODevice::ReadOnly ) )
+      {
+         return false;
+      }
+
+      QByteArray magic = file.read( 2 );
+      return magic.size() == 2 && 
+         static_cast<unsigned char>(magic.at(0)) == 0x1f &&
+         static_cast<unsigned char>(magic.at(1)) == 0x8b;
+   }
+
+   bool GzipReader::Open( const QString& sFilename )
+   {
+      m_file.setFileName( sFilename );
+      return m_file.open( QIODevice::ReadOnly );
+   }
+
+   qint64 GzipReader::CompressedSize() const
+   {
+      return m_file.size();
+   }
+
+   bool GzipReader::NextBlock( QByteArray& block, qint64& llCompressed )
+   {
+      m_mutex.lock();
+      while( m_blocks.isEmpty() && !m_bDone && !m_bStop )
+      {
+         m_notEmpty.wait( &m_mutex );
+      }
+
+      bool bTaken = !m_blocks.isEmpty() && !m_bStop;
+      if( bTaken )
+      {
+         Block next = m_blocks.dequeue();
+         block        = next.data;
+         llCompressed = next.llCompressed;
+         m_notFull.wakeOne();
+      }
+      m_mutex.unlock();
+
+      return bTaken;
+   }
+
+   bool GzipReader::HasError() const
+   {
+      m_mutex.lock();
+      bool bError = m_bError;
+      m_mutex.unlock();
+      return bError;
+   }
+
+   void GzipReader::Stop()
+   {
+      m_mutex.lock();
+      m_bStop = true;
+      m_notEmpty.wakeAll();
+      m_notFull.wakeAll();
+      m_mutex.unlock();
+   }
+
+   bool GzipReader::PushBlock( const QByteArray& block, qint64 llCompressed )
+   {
+      m_mutex.lock();
+      while( m_blocks.size() >= nMaxBlocks && !m_bStop )
+      {
+         m_notFull.wait( &m_mutex );
+      }
+
+      bool bQueued = !m_bStop;
+      if( bQueued )
+      {
+         Block next;
+         next.data         = block;
+         next.llCompressed = llCompressed;
+         m_blocks.enqueue( next );
+         m_notEmpty.wakeOne();
+      }
+      m_mutex.unlock();
+
+      return bQueued;
+   }
+
+   void GzipReader::run()
+   {
+      z_stream strm;
+      memset( &strm, 0, sizeof(strm) );
+      bool bError = (inflateInit2( &strm, nWindowBits ) != Z_OK);
+
+      // Each block is decompressed directly into the array that is queued.
+      QByteArray input( nInputSize, '\0' );
+      QByteArray block;
+      block.resize( nBlockSize );
+      strm.next_out  = reinterpret_cast<Bytef*>( block.data() );
+      strm.avail_out = nBlockSize;
+
+      qint64 llConsumed = 0;
+      bool   bInMember  = false;
+      bool   bRunning   = !bError;
+      while( bRunning )
+      {
+         if( strm.avail_in == 0 )
+         {
+            qint64 llRead = m_file.read( input.data(), input.size() );
+            if( llRead <= 0 )
+            {
+               bError = (llRead < 0);
+               break;
+            }
+            strm.next_in  = reinterpret_cast<Bytef*>( input.data() );
+            strm.avail_in = static_cast<uInt>(llRead);
+         }
+
+         uInt nAvailable = strm.avail_in;
+         int  ret = inflate( &strm, Z_NO_FLUSH );
+         llConsumed += nAvailable - strm.avail_in;
+         if( ret == Z_STREAM_END )
+         {
+            // Another member may follow, e.g. files that were concatenated.
+            bInMember = false;
+            inflateReset( &strm );
+         }
+         else if( ret == Z_OK || ret == Z_BUF_ERROR )
+         {
+            bInMember = true;
+         }
+         else
+         {
+            cerr << "GzipReader: " << (strm.msg ? strm.msg : "inflate failed") 
+               << " in " << qPrintable(m_file.fileName()) << endl;
+            bError = true;
+            break;
+         }
+
+         if( strm.avail_out == 0 )
+         {
+            bRunning = PushBlock( block, llConsumed );
+            block = QByteArray();
+            block.resize( nBlockSize );
+            strm.next_out  = reinterpret_cast<Bytef*>( block.data() );
+            strm.avail_out = nBlockSize;
+         }
+      }
+
+      // A member that never reached its end means the file was truncated.
+      if( bInMember && bRunning && !bError )
+      {
+         cerr << "GzipReader: Unexpected end of " << qPrintable(m_file.fileName()) << endl;
+         bError = true;
+      }
+
+      // Hand over whatever was decompressed before the end.
+      int nRemaining = nBlockSize - static_cast<int>(strm.avail_out);
+      if( bRunning && nRemaining > 0 )
+      {
+         block.resize( nRemaining );
+         PushBlock( block, llConsumed );
+      }
+      inflateEnd( &strm );
+
+      m_mutex.lock();
+      m_bDone  = true;
+      m_bError = bError;
+      m_notEmpty.wakeAll();
+      m_mutex.unlock();
+   }
+};
@@ -0,0 +1,100 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GZIPREADER_H
+#define GZIPREADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include <QByteArray>
+
+
+namespace Parser
+{
+   //! Decompresses a gzip file on its own thread into fixed size blocks of
+   //! text.  Decompressed blocks wait in a bounded queue so decompression 
+   //! overlaps with parsing but never runs more than a few blocks ahead.
+   //! Files made of several concatenated gzip members are read as one.
+   class GzipReader : public QThread
+   {
+   public:
+      //! Number of decompressed bytes in each block, except the last.
+      static const int nBlockSize;
+
+      //! Number of decompressed blocks that may wait for the consumer.
+      static const int nMaxBlocks;
+
+      GzipReader();
+      ~GzipReader();
+
+      //! Checks whether a file starts with the gzip magic number.
+      //! @param sFilename  Path of the file
+      static bool IsCompressed( const QString& sFilename );
+
+      //! Opens the compressed file.  Call start() to begin decompressing.
+      //! @param sFilename  Path of the file
+      //! @retval true  If the file was opened
+      //! @retval false Otherwise
+      bool Open( const QString& sFilename );
+
+      //! Returns the size of the compressed file.
+      qint64 CompressedSize() const;
+
+      //! Takes the next decompressed block, waiting for it if necessary.
+      //! @param block         Decompressed bytes
+      //! @param llCompressed  Compressed bytes consumed through the block
+      //! @retval true  If a block was taken
+      //! @retval false At the end of the file, on an error or once stopped
+      bool NextBlock( QByteArray& block, qint64& llCompressed );
+
+      //! Indicates the file could not be completely decompressed.
+      bool HasError() const;
+
+      //! Stops decompressing and wakes both threads.
+      void Stop();
+
+   protected:
+      //! The threaded functionality.
+      void run();
+
+      //! Queues a block, waiting while the queue is full.
+      //! @retval true  If the block was queued
+      //! @retval false If decompression was stopped
+      bool PushBlock( const QByteArray& block, qint64 llCompressed );
+
+   private:
+      //! Decompressed block waiting for the consumer.
+      struct Block
+      {
+         QByteArray data;         //!< Decompressed bytes
+         qint64     llCompressed; //!< Compressed bytes consumed through the block
+      };
+
+      mutable QMutex m_mutex;    //!< Mutex for thread safety
+      QWaitCondition m_notEmpty; //!< Signaled when a block is queued or decompression ends
+      QWaitCondition m_notFull;  //!< Signaled when a block is taken or decompression stops
+      QQueue<Block>  m_blocks;   //!< Blocks waiting for the consumer
+      QFile          m_file;     //!< Compressed file
+      bool           m_bDone;    //!< Flag indicating no more blocks will be queued
+      bool           m_bStop;    //!< Flag indicating decompression should stop
+      bool           m_bError;   //!< Flag indicating the file is corrupt or truncated
+   };
+};
+#endif // GZIPREADER_H
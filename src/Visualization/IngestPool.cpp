@@ -0,0 +1,246 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QRunnable>
+
+#include "CsvParser.h"
+#include "IngestPool.h"
+
+
+namespace Parser
+{
+   // ==========================================================================
+   // Parses the file of a single job on a worker of the pool.
+   class IngestJob : public QRunnable
+   {
+   public:
+      IngestJob( IngestPool* pPool, CsvParser* pParser, int nJob )
+         : m_pPool(pPool)
+         , m_pParser(pParser)
+         , m_nJob(nJob)
+      {
+      }
+
+      void run()
+      {
+         bool bCommitted = false;
+         if( m_pPool->StartJob( m_nJob ) )
+         {
+            m_pParser->Parse();
+            bCommitted = m_pParser->FlightCommitted();
+         }
+
+         // The parser is cleaned up on the thread the pool belongs to.
+         QMetaObject::invokeMethod( m_pPool, "JobDone", Qt::QueuedConnection, 
+            Q_ARG(int, m_nJob), Q_ARG(bool, bCommitted) );
+      }
+
+   private:
+      IngestPool* m_pPool;
+      CsvParser*  m_pParser;
+      int         m_nJob;
+   };
+
+
+   // ==========================================================================
+   IngestPool::IngestPool(QObject* parent)
+      : QObject(parent)
+      , m_nNextJob(0)
+      , m_nMaxThreads(1)
+      , m_nLongRunning(0)
+   {
+      // One thread is left for the user interface and the data management.
+      SetMaxThreads( QThread::idealThreadCount()-1 );
+   }
+
+   IngestPool::~IngestPool()
+   {
+      CancelAll();
+      m_threads.waitForDone();
+
+      // The queued JobDone() calls are never delivered.
+      QMapIterator<int,Job> it( m_jobs );
+      while( it.hasNext() )
+      {
+         delete it.next().value().pParser;
+      }
+   }
+
+   void IngestPool::SetMaxThreads( int nThreads )
+   {
+      m_mutex.lock();
+      m_nMaxThreads = qMax( nThreads, 1 );
+      m_threads.setMaxThreadCount( m_nMaxThreads + m_nLongRunning );
+      m_mutex.unlock();
+   }
+
+   int IngestPool::Submit( CsvParser* pParser, Priority ePriority, bool bLongRunning )
+   {
+      m_mutex.lock();
+      int nJob = m_nNextJob++;
+      Job& job = m_jobs[nJob];
+      job.pParser      = pParser;
+      job.sFlightName  = pParser->GetFlightName();
+      job.bRunning     = false;
+      job.bCancelled   = false;
+      job.bSuccess     = false;
+      job.bLongRunning = bLongRunning;
+      job.nMin         = 0;
+      job.nMax         = 100;
+      if( bLongRunning )
+      {
+         ++m_nLongRunning;
+         m_threads.setMaxThreadCount( m_nMaxThreads + m_nLongRunning );
+      }
+      m_mutex.unlock();
+
+      connect
+         ( pParser, SIGNAL(setProgressRange(int,int))
+         , this,    SLOT(ParserRange(int,int)) );
+      connect
+         ( pParser, SIGNAL(setCurrentProgress(int))
+         , this,    SLOT(ParserProgress(int)) );
+      connect
+         ( pParser, SIGNAL(fileDoneStatus(bool,QString))
+         , this,    SLOT(ParserDone(bool,QString)) );
+
+      m_threads.start( new IngestJob(this, pParser, nJob), ePriority );
+      return nJob;
+   }
+
+   bool IngestPool::Cancel( int nJob )
+   {
+      m_mutex.lock();
+      bool bActive = m_jobs.contains( nJob );
+      if( bActive )
+      {
+         Job& job = m_jobs[nJob];
+         job.bCancelled = true;
+         if( job.bRunning )
+         {
+            job.pParser->stopParse();
+         }
+      }
+      m_mutex.unlock();
+      return bActive;
+   }
+
+   void IngestPool::CancelAll()
+   {
+      m_mutex.lock();
+      QList<int> jobs = m_jobs.keys();
+      m_mutex.unlock();
+
+      for( int i = 0; i < jobs.size(); ++i )
+      {
+         Cancel( jobs.at(i) );
+      }
+   }
+
+   int IngestPool::ActiveJobs() const
+   {
+      m_mutex.lock();
+      int nJobs = m_jobs.size();
+      m_mutex.unlock();
+      return nJobs;
+   }
+
+   void IngestPool::WaitForDone()
+   {
+      m_threads.waitForDone();
+   }
+
+   bool IngestPool::StartJob( int nJob )
+   {
+      m_mutex.lock();
+      Job& job = m_jobs[nJob];
+      bool bStart = !job.bCancelled;
+      job.bRunning = bStart;
+      m_mutex.unlock();
+      return bStart;
+   }
+
+   int IngestPool::SenderJob() const
+   {
+      QObject* pSender = sender();
+      int nJob = -1;
+      m_mutex.lock();
+      QMapIterator<int,Job> it( m_jobs );
+      while( nJob == -1 && it.hasNext() )
+      {
+         it.next();
+         if( it.value().pParser == pSender )
+         {
+            nJob = it.key();
+         }
+      }
+      m_mutex.unlock();
+      return nJob;
+   }
+
+   void IngestPool::ParserRange(int min, int max)
+   {
+      int nJob = SenderJob();
+      if( nJob != -1 )
+      {
+         m_mutex.lock();
+         m_jobs[nJob].nMin = min;
+         m_jobs[nJob].nMax = max;
+         m_mutex.unlock();
+      }
+   }
+
+   void IngestPool::ParserProgress(int value)
+   {
+      int nJob = SenderJob();
+      if( nJob != -1 )
+      {
+         m_mutex.lock();
+         const Job& job = m_jobs[nJob];
+         int nRange = qMax( job.nMax - job.nMin, 1 );
+         int nPercent = ((value - job.nMin) * 100) / nRange;
+         m_mutex.unlock();
+         emit( jobProgress(nJob, nPercent) );
+      }
+   }
+
+   void IngestPool::ParserDone(bool bSuccess, QString /*sFileName*/)
+   {
+      int nJob = SenderJob();
+      if( nJob != -1 )
+      {
+         m_mutex.lock();
+         m_jobs[nJob].bSuccess = bSuccess;
+         m_mutex.unlock();
+      }
+   }
+
+   void IngestPool::JobDone(int nJob, bool bCommitted)
+   {
+      m_mutex.lock();
+      Job job = m_jobs.take( nJob );
+      if( job.bLongRunning )
+      {
+         --m_nLongRunning;
+         m_threads.setMaxThreadCount( m_nMaxThreads + m_nLongRunning );
+      }
+      m_mutex.unlock();
+
+      emit( jobFinished(nJob, job.sFlightName, job.bSuccess, bCommitted) );
+      job.pParser->deleteLater();
+   }
+};
@@ -0,0 +1,145 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef INGESTPOOL_H
+#define INGESTPOOL_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMap>
+#include <QString>
+
+
+namespace Parser
+{
+   class CsvParser;
+
+   //! Reusable pool of threads that parse files.  Each file is submitted as
+   //! a job with a priority, higher priorities starting first.  A job may be
+   //! cancelled while it waits or while it runs.  The pool has its own 
+   //! threads since a parser splits large files into chunks on the global 
+   //! thread pool and waits on them.
+   class IngestPool : public QObject
+   {
+      Q_OBJECT
+
+   public:
+      //! Order in which waiting jobs are started.
+      enum Priority
+      {
+         Priority_Low    = 0, //!< Started after every other job
+         Priority_Normal = 1, //!< Files opened by the user
+         Priority_High   = 2  //!< Started ahead of every other job
+      };
+
+      IngestPool(QObject* parent = 0);
+
+      //! Cancels every job and waits for the running ones to stop.
+      ~IngestPool();
+
+      //! Sets the number of jobs parsed at the same time, not counting jobs
+      //! that run until cancelled, e.g. followed recordings.
+      void SetMaxThreads( int nThreads );
+
+      //! Queues a file to be parsed.  The pool takes ownership of the 
+      //! parser, which is deleted after jobFinished() is emitted.
+      //! @param pParser       Parser setup with SetParseInformation()
+      //! @param ePriority     Order in which the job is started
+      //! @param bLongRunning  True if the job runs until cancelled.  It gets
+      //!                      a thread of its own so other jobs still run.
+      //! @return  Identifier of the job
+      int Submit( CsvParser* pParser, Priority ePriority = Priority_Normal, bool bLongRunning = false );
+
+      //! Cancels a job.  A waiting job is never parsed and a running job 
+      //! stops at its next row.
+      //! @retval true  If the job was waiting or running
+      //! @retval false Otherwise
+      bool Cancel( int nJob );
+
+      //! Cancels every job.
+      void CancelAll();
+
+      //! Number of jobs waiting or running.
+      int ActiveJobs() const;
+
+      //! Waits for every job to finish.  The jobFinished() signals are only
+      //! delivered once control returns to the event loop.
+      void WaitForDone();
+
+   signals:
+      //! Reports the progress of a running job.
+      //! @param nJob      Identifier from Submit()
+      //! @param nPercent  Percent of the file parsed
+      void jobProgress(int nJob, int nPercent);
+
+      //! Signal indicating that a job is done, parsed or cancelled.
+      //! @param nJob         Identifier from Submit()
+      //! @param sFlightName  Flight of the job
+      //! @param bSuccess     Indicates the whole file was parsed
+      //! @param bCommitted   Indicates the flight was committed, so DataMgmt 
+      //!                     will report it complete.  Truncated files may
+      //!                     still be committed.
+      void jobFinished(int nJob, QString sFlightName, bool bSuccess, bool bCommitted);
+
+   private slots:
+      //! Records the progress range of a parser.
+      void ParserRange(int min, int max);
+
+      //! Converts the progress of a parser to a percentage.
+      void ParserProgress(int value);
+
+      //! Records the result of a parser.
+      void ParserDone(bool bSuccess, QString sFileName);
+
+      //! Cleans up a job once its worker is done with it.
+      void JobDone(int nJob, bool bCommitted);
+
+   private:
+      friend class IngestJob;
+
+      //! Book keeping for a single job.
+      struct Job
+      {
+         CsvParser* pParser;      //!< Parser of the file
+         QString    sFlightName;  //!< Flight being parsed
+         bool       bRunning;     //!< Flag indicating a worker is parsing the file
+         bool       bCancelled;   //!< Flag indicating the job was cancelled
+         bool       bSuccess;     //!< Result reported by the parser
+         bool       bLongRunning; //!< Flag indicating the job has its own thread
+         int        nMin;         //!< First progress value of the parser
+         int        nMax;         //!< Last progress value of the parser
+      };
+
+      //! Called by the worker before parsing.
+      //! @retval true  If the job should be parsed
+      //! @retval false If it was cancelled while waiting
+      bool StartJob( int nJob );
+
+      //! Finds the job of the parser that sent a signal.
+      //! @return  Identifier of the job, -1 if there isn't one
+      int SenderJob() const;
+
+      mutable QMutex   m_mutex;        //!< Mutex for thread safety
+      QThreadPool      m_threads;      //!< Threads running the jobs
+      QMap<int,Job>    m_jobs;         //!< Jobs waiting or running by identifier
+      int              m_nNextJob;     //!< Identifier of the next job submitted
+      int              m_nMaxThreads;  //!< Threads for jobs that aren't long running
+      int              m_nLongRunning; //!< Number of long running jobs
+   };
+};
+#endif // INGESTPOOL_H
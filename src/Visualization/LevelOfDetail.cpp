@@ -0,0 +1,299 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <qnumeric.h>
+
+#include "LevelOfDetail.h"
+
+
+namespace Data
+{
+   // Runs of 16 rows, about a second of a flight recorded at 16 Hz.
+   const int ColumnPyramid::nFirstLevel = 4;
+
+   // ==========================================================================
+   // ==========================================================================
+   ColumnPyramid::ColumnPyramid()
+      : m_pending(Empty())
+      , m_nPending(0)
+      , m_nRows(0)
+   {
+   }
+
+   void ColumnPyramid::Append( double value )
+   {
+      if( !qIsNaN(value) )
+      {
+         if( m_pending.uCount == 0 || value < m_pending.fMin )
+         {
+            m_pending.fMin = value;
+         }
+         if( m_pending.uCount == 0 || value > m_pending.fMax )
+         {
+            m_pending.fMax = value;
+         }
+         ++m_pending.uCount;
+         m_pending.fMean += (value - m_pending.fMean) / m_pending.uCount;
+      }
+      ++m_nRows;
+
+      if( ++m_nPending == BucketRows(0) )
+      {
+         Push( 0, m_pending );
+         m_pending  = Empty();
+         m_nPending = 0;
+      }
+   }
+
+   void ColumnPyramid::Append( const NumericColumn& values )
+   {
+      int nValues = values.size();
+      for( int r = 0; r < nValues; ++r )
+      {
+         Append( values.at(r) );
+      }
+   }
+
+   int ColumnPyramid::RowCount() const
+   {
+      return m_nRows;
+   }
+
+   int ColumnPyramid::LevelCount() const
+   {
+      return m_levels.size();
+   }
+
+   int ColumnPyramid::BucketRows( int nLevel )
+   {
+      return 1 << (nFirstLevel + nLevel);
+   }
+
+   const QVector<PyramidBucket>& ColumnPyramid::Level( int nLevel ) const
+   {
+      static const QVector<PyramidBucket> NoBuckets;
+      if( nLevel < 0 || nLevel >= m_levels.size() )
+      {
+         return NoBuckets;
+      }
+      return m_levels.at(nLevel);
+   }
+
+   bool ColumnPyramid::Tail( int nLevel, PyramidBucket& bucket ) const
+   {
+      int nCovered = Level(nLevel).size() * BucketRows(nLevel);
+      bucket = Empty();
+
+      // Each lower level summarizes the rows its next level doesn't yet.
+      for( int j = qMin(nLevel, m_levels.size()) - 1; j >= 0; --j )
+      {
+         const QVector<PyramidBucket>& level = m_levels.at(j);
+         for( int i = nCovered / BucketRows(j); i < level.size(); ++i )
+         {
+            bucket = Combine( bucket, level.at(i) );
+         }
+         nCovered = qMax( nCovered, level.size() * BucketRows(j) );
+      }
+      if( m_nPending > 0 )
+      {
+         bucket = Combine( bucket, m_pending );
+      }
+
+      return m_nRows > Level(nLevel).size() * BucketRows(nLevel);
+   }
+
+   qint64 ColumnPyramid::Bytes() const
+   {
+      qint64 llBytes = sizeof(ColumnPyramid);
+      for( int j = 0; j < m_levels.size(); ++j )
+      {
+         llBytes += m_levels.at(j).capacity() * sizeof(PyramidBucket);
+      }
+      return llBytes;
+   }
+
+   PyramidBucket ColumnPyramid::Empty()
+   {
+      PyramidBucket bucket;
+      bucket.fMin   = qQNaN();
+      bucket.fMax   = qQNaN();
+      bucket.fMean  = 0;
+      bucket.uCount = 0;
+      return bucket;
+   }
+
+   PyramidBucket ColumnPyramid::Combine( const PyramidBucket& a, const PyramidBucket& b )
+   {
+      if( a.uCount == 0 )
+      {
+         return b;
+      }
+      if( b.uCount == 0 )
+      {
+         return a;
+      }
+
+      PyramidBucket bucket;
+      bucket.fMin   = qMin( a.fMin, b.fMin );
+      bucket.fMax   = qMax( a.fMax, b.fMax );
+      bucket.uCount = a.uCount + b.uCount;
+      bucket.fMean  = (double(a.fMean)*a.uCount + double(b.fMean)*b.uCount) / bucket.uCount;
+      return bucket;
+   }
+
+   void ColumnPyramid::Push( int nLevel, const PyramidBucket& bucket )
+   {
+      if( m_levels.size() <= nLevel )
+      {
+         m_levels.resize( nLevel+1 );
+      }
+
+      QVector<PyramidBucket>& level = m_levels[nLevel];
+      level.push_back( bucket );
+      if( level.size() % 2 == 0 )
+      {
+         Push( nLevel+1, Combine(level.at(level.size()-2), level.at(level.size()-1)) );
+      }
+   }
+
+
+   // ==========================================================================
+   // ==========================================================================
+   Envelope::Envelope()
+      : m_uBegin(0)
+      , m_uEnd(0)
+      , m_nSpans(0)
+   {
+   }
+
+   void Envelope::Reset( unsigned int uBegin, unsigned int uEnd, int nSpans, int nAttributes )
+   {
+      m_uBegin = uBegin;
+      m_uEnd   = qMax( uEnd, uBegin );
+      m_nSpans = qMax( nSpans, 0 );
+      m_min.fill( QVector<double>(m_nSpans, qQNaN()), nAttributes );
+      m_max.fill( QVector<double>(m_nSpans, qQNaN()), nAttributes );
+      m_sum.fill( QVector<double>(m_nSpans, 0), nAttributes );
+      m_count.fill( QVector<int>(m_nSpans, 0), nAttributes );
+   }
+
+   int Envelope::SpanCount() const
+   {
+      return m_nSpans;
+   }
+
+   int Envelope::AttributeCount() const
+   {
+      return m_min.size();
+   }
+
+   unsigned int Envelope::SpanTime( int nSpan ) const
+   {
+      return m_uBegin + qint64(m_uEnd - m_uBegin) * nSpan / qMax(m_nSpans, 1);
+   }
+
+   int Envelope::Span( unsigned int uTime ) const
+   {
+      if( m_nSpans == 0 || uTime < m_uBegin || uTime >= m_uEnd )
+      {
+         return -1;
+      }
+      return qint64(uTime - m_uBegin) * m_nSpans / (m_uEnd - m_uBegin);
+   }
+
+   void Envelope::Add( int nAttribute, unsigned int uFirst, unsigned int uLast, const PyramidBucket& bucket )
+   {
+      if( m_nSpans == 0 || bucket.uCount == 0 || 
+          uLast < m_uBegin || uFirst >= m_uEnd || uLast < uFirst )
+      {
+         return;
+      }
+
+      // The range of the rows widens every span they overlap.
+      int nFirst = Span( qMax(uFirst, m_uBegin) );
+      int nLast  = Span( qMin(uLast, m_uEnd-1) );
+      QVector<double>& min = m_min[nAttribute];
+      QVector<double>& max = m_max[nAttribute];
+      for( int s = nFirst; s <= nLast; ++s )
+      {
+         if( qIsNaN(min.at(s)) || bucket.fMin < min.at(s) )
+         {
+            min[s] = bucket.fMin;
+         }
+         if( qIsNaN(max.at(s)) || bucket.fMax > max.at(s) )
+         {
+            max[s] = bucket.fMax;
+         }
+      }
+
+      // The mean is taken over whole runs, each counted where it's centered.
+      unsigned int uMiddle = uFirst + (uLast - uFirst) / 2;
+      int nMiddle = Span( qBound(m_uBegin, uMiddle, m_uEnd-1) );
+      m_sum[nAttribute][nMiddle]   += double(bucket.fMean) * bucket.uCount;
+      m_count[nAttribute][nMiddle] += bucket.uCount;
+   }
+
+   void Envelope::Add( const Buffer& rows )
+   {
+      int nAttr = qMin( rows.AttributeCount(), m_min.size() );
+      for( int a = 0; a < nAttr; ++a )
+      {
+         const unsigned int* pTime   = rows.Times();
+         const double*       pValues = rows.Values(a);
+         for( int r = 0; r < rows.RowCount(); ++r )
+         {
+            int s = Span( pTime[r] );
+            if( s < 0 || qIsNaN(pValues[r]) )
+            {
+               continue;
+            }
+
+            if( qIsNaN(m_min.at(a).at(s)) || pValues[r] < m_min.at(a).at(s) )
+            {
+               m_min[a][s] = pValues[r];
+            }
+            if( qIsNaN(m_max.at(a).at(s)) || pValues[r] > m_max.at(a).at(s) )
+            {
+               m_max[a][s] = pValues[r];
+            }
+            m_sum[a][s]   += pValues[r];
+            m_count[a][s] += 1;
+         }
+      }
+   }
+
+   int Envelope::Count( int nSpan, int nAttribute ) const
+   {
+      return m_count.at(nAttribute).at(nSpan);
+   }
+
+   double Envelope::Min( int nSpan, int nAttribute ) const
+   {
+      return m_min.at(nAttribute).at(nSpan);
+   }
+
+   double Envelope::Max( int nSpan, int nAttribute ) const
+   {
+      return m_max.at(nAttribute).at(nSpan);
+   }
+
+   double Envelope::Mean( int nSpan, int nAttribute ) const
+   {
+      int nCount = m_count.at(nAttribute).at(nSpan);
+      return nCount > 0 ? m_sum.at(nAttribute).at(nSpan) / nCount : qQNaN();
+   }
+};
@@ -0,0 +1,162 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _LEVELOFDETAIL_H_
+#define _LEVELOFDETAIL_H_
+
+#include <QVector>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   //! Summary of a run of consecutive rows of a column.
+   struct PyramidBucket
+   {
+      double  fMin;    //!< Smallest value, NaN if every value is missing
+      double  fMax;    //!< Largest value, NaN if every value is missing
+      float   fMean;   //!< Mean of the values that aren't missing
+      quint32 uCount;  //!< Number of values that aren't missing
+   };
+
+
+   //! Multi-resolution summary of a numeric column, built as its rows are
+   //! appended.  Level k holds a bucket for each run of BucketRows(k) rows,
+   //! 2^(nFirstLevel+k) of them, so a view can summarize any number of rows 
+   //! from a few buckets.  Unlike picking every n-th row, the smallest and
+   //! largest values of a bucket are kept, so a short spike always shows.
+   //! The buckets take less than half the memory of the column held as
+   //! doubles.
+   class ColumnPyramid
+   {
+   public:
+      //! The buckets of the first level summarize 2^nFirstLevel rows.  Fewer
+      //! rows are read from the flight itself.
+      static const int nFirstLevel;
+
+      ColumnPyramid();
+
+      //! Adds a value to the end of the column, NaN if it is missing.
+      void Append( double value );
+
+      //! Adds the values of a column to the end of the column.
+      void Append( const NumericColumn& values );
+
+      //! Returns the number of rows summarized.
+      int RowCount() const;
+
+      //! Returns the number of levels that have at least one bucket.
+      int LevelCount() const;
+
+      //! Returns the number of rows summarized by a bucket of a level.
+      static int BucketRows( int nLevel );
+
+      //! Returns the complete buckets of a level, in row order.
+      const QVector<PyramidBucket>& Level( int nLevel ) const;
+
+      //! Summarizes the rows after the last complete bucket of a level.
+      //! @param nLevel  Level whose buckets the rows follow
+      //! @param bucket  Receives the summary
+      //! @retval true  If there are rows after the last bucket
+      //! @retval false Otherwise
+      bool Tail( int nLevel, PyramidBucket& bucket ) const;
+
+      //! Approximate number of bytes held by the buckets.
+      qint64 Bytes() const;
+
+   private:
+      //! Returns a bucket holding no values.
+      static PyramidBucket Empty();
+
+      //! Combines the summaries of two runs of rows.
+      static PyramidBucket Combine( const PyramidBucket& a, const PyramidBucket& b );
+
+      //! Adds a complete bucket to a level, combining it with the bucket 
+      //! before it into the next level when the two make a pair.
+      void Push( int nLevel, const PyramidBucket& bucket );
+
+      QVector< QVector<PyramidBucket> > m_levels; //!< Complete buckets of each level
+      PyramidBucket m_pending;   //!< Rows that don't yet fill a bucket of the first level
+      int           m_nPending;  //!< Number of rows in m_pending
+      int           m_nRows;     //!< Number of rows summarized
+   };
+
+
+   //! Smallest, largest and mean values of attributes over each of a number
+   //! of equal spans of time, e.g. one per pixel of a view.  A run of rows 
+   //! that straddles spans widens the range of each of them, so no value 
+   //! is ever left out of the envelope.
+   class Envelope
+   {
+   public:
+      Envelope();
+
+      //! Empties the envelope and divides a window of time into spans.
+      //! @param uBegin       First time of the window, in the units of Buffer::_times
+      //! @param uEnd         Time the window ends before
+      //! @param nSpans       Number of spans
+      //! @param nAttributes  Number of attributes
+      void Reset( unsigned int uBegin, unsigned int uEnd, int nSpans, int nAttributes );
+
+      //! Returns the number of spans.
+      int SpanCount() const;
+
+      //! Returns the number of attributes.
+      int AttributeCount() const;
+
+      //! Returns the first time of a span.
+      unsigned int SpanTime( int nSpan ) const;
+
+      //! Returns the span holding a time, -1 if it is outside of the window.
+      int Span( unsigned int uTime ) const;
+
+      //! Adds the summary of a run of rows of an attribute.
+      //! @param nAttribute  Attribute the rows are of
+      //! @param uFirst      Earliest time of the rows
+      //! @param uLast       Latest time of the rows
+      //! @param bucket      Summary of the rows
+      void Add( int nAttribute, unsigned int uFirst, unsigned int uLast, const PyramidBucket& bucket );
+
+      //! Adds rows of the attributes, e.g. read from the flight itself.
+      void Add( const Buffer& rows );
+
+      //! Returns the number of values of an attribute in a span that its mean
+      //! is taken over.  Runs of rows are counted in the span at their middle.
+      int Count( int nSpan, int nAttribute ) const;
+
+      //! Returns the smallest value of an attribute in a span, NaN if none.
+      double Min( int nSpan, int nAttribute ) const;
+
+      //! Returns the largest value of an attribute in a span, NaN if none.
+      double Max( int nSpan, int nAttribute ) const;
+
+      //! Returns the mean value of an attribute in a span, NaN if none.
+      double Mean( int nSpan, int nAttribute ) const;
+
+   private:
+      unsigned int               m_uBegin; //!< First time of the window
+      unsigned int               m_uEnd;   //!< Time the window ends before
+      int                        m_nSpans; //!< Number of spans
+      QVector< QVector<double> > m_min;    //!< Smallest value of each attribute in each span
+      QVector< QVector<double> > m_max;    //!< Largest value of each attribute in each span
+      QVector< QVector<double> > m_sum;    //!< Sum of the values of each attribute in each span
+      QVector< QVector<int> >    m_count;  //!< Number of values of each attribute in each span
+   };
+};
+
+#endif // _LEVELOFDETAIL_H_
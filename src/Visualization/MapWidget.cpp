@@ -1,4 +1,8 @@
 #include "MapWidget.h"
+#include <qnumeric.h>
+
+// Number of dots a flight path is drawn with
+static const int PathSpans = 300;
 
 AircraftOverlay::AircraftOverlay(QGraphicsItem* parent, QGraphicsScene* scene)
     : QGraphicsItem(parent, scene)
@@ -66,10 +70,16 @@ void FlightPath::paint(QPainter *painter,
     pen.setColor(QColor::fromHsv((100 * _flightIndex) % 360,255,230,200));
     painter->setPen(pen);
 
-    for(int i = 0;i < _finalIndex;i += 80) {
-       if( i < _coords->size() ) {
+    if( _path.AttributeCount() < 2 )
+       return;
+
+    // A dot at the mean position over each span of time
+    for(int i = 0;i < _path.SpanCount();i++) {
+       double lat = _path.Mean(i, 0);
+       double lon = _path.Mean(i, 1);
+       if( !qIsNaN(lat) && !qIsNaN(lon) ) {
            // Convert coordinates to pixels and shift them for the drawPixmap operation
-           QPoint point = gpsToPixels(_coords->at(i)._dataVector[0].toDouble(), _coords->at(i)._dataVector[1].toDouble());
+           QPoint point = gpsToPixels(lat, lon);
 
            // Fudging the position a bit here (again)
            point.setX(point.x() - 22);
@@ -85,10 +95,10 @@ void FlightPath::paint(QPainter *painter,
     pen.setColor(QColor::fromHsv(0,255,255));
     painter->setPen(pen);
 
-    QPoint previous = gpsToPixels(_coords->at(0)._dataVector[0].toDouble(), _coords->at(0)._dataVector[1].toDouble());
-    for(int i = 1; i < 300; i++) {
+    QPoint previous = gpsToPixels(_path.Mean(0, 0), _path.Mean(0, 1));
+    for(int i = 1; i < _path.SpanCount(); i++) {
         // Convert coordinates to pixels and shift them for the drawPixmap operation
-        QPoint point = gpsToPixels(_coords->at(i * (_finalIndex/300))._dataVector[0].toDouble(), _coords->at(i * (_finalIndex/300))._dataVector[1].toDouble());
+        QPoint point = gpsToPixels(_path.Mean(i, 0), _path.Mean(i, 1));
 
         // Fudging the position a bit here (again)
         point.setX(point.x() - 22);
@@ -214,9 +224,17 @@ void MapWidget::drawFlightPath(QString flight_id, int index)
     // Create a new FlightPath
     FlightPath* path = new FlightPath();
 
+    // Summarize the path up to the current time over a fixed number of
+    // spans so the dots are spread evenly however long the flight is
+    const Data::Buffer& coords = _loadedFlightsData.at(index);
+    Data::Envelope envelope;
+    if(coords.RowCount() > 0) {
+        int last = qBound(0, _currentIndex, coords.RowCount() - 1);
+        m_dataMgmt->GetEnvelope(flight_id, _attributes, coords.Time(0), coords.Time(last) + 1, PathSpans, envelope);
+    }
+
     // Set its data and index
-    path->setLocationData(&_loadedFlightsData.at(index)._params);
-    path->setFinalIndex(_currentIndex);
+    path->setEnvelope(envelope);
     path->setFlightIndex(index);
 
     // Set its location in the view
@@ -238,11 +256,11 @@ void MapWidget::drawPlane(QString flight_id, int index)
     _plane = new AircraftOverlay();
 
     // Set its coordinates
-    if(_currentIndex >= _loadedFlightsData.at(index)._params.size())
-        _currentIndex = _loadedFlightsData.at(index)._params.size() - 1;
+    if(_currentIndex >= _loadedFlightsData.at(index).RowCount())
+        _currentIndex = _loadedFlightsData.at(index).RowCount() - 1;
 
-     _plane->setLocationData(_loadedFlightsData.at(index)._params.at(_currentIndex)._dataVector.at(0).toDouble(),
-                             _loadedFlightsData.at(index)._params.at(_currentIndex)._dataVector.at(1).toDouble());
+     _plane->setLocationData(_loadedFlightsData.at(index).Value(_currentIndex, 0),
+                             _loadedFlightsData.at(index).Value(_currentIndex, 1));
 
     // Make it draw
     _scene->addItem(_plane);
@@ -55,14 +55,10 @@ class FlightPath : public QGraphicsItem
 public:
     FlightPath(QGraphicsItem *parent = 0);
 
-    void setLocationData(const QList<Data::Point>* coords)
-    { _coords = coords; }
-
-    void setFinalIndex(int idx)
-    {
-        if(idx < _coords->size()) _finalIndex = idx;
-        else _finalIndex = _coords->size() - 1;
-    }
+    // Latitude and longitude are the first two attributes of the envelope,
+    // which covers the flight up to the current time
+    void setEnvelope(const Data::Envelope& path)
+    { _path = path; }
 
     // Flight index is used to randomize colors
     void setFlightIndex(int idx) { _flightIndex = idx; }
@@ -76,8 +72,7 @@ public:
                QWidget *widget);
 
 private:
-    int                           _finalIndex;
-    const QList<Data::Point>*     _coords;
+    Data::Envelope                _path;
     int                           _flightIndex;
 
 };
@@ -0,0 +1,176 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QLocale>
+#include <QString>
+
+#include "NumberParser.h"
+
+
+namespace Parser
+{
+   // Powers of ten that are exactly representable as a double.
+   static const double ExactPowersOfTen[] =
+   {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+      1e22
+   };
+   const int nMaxExactPower = 22;
+
+   // Largest integer below which every integer is exactly a double.
+   const quint64 uMaxExactMantissa = Q_UINT64_C(1) << 53;
+
+   // Digits beyond this can overflow the mantissa accumulator.
+   const int nMaxMantissaDigits = 19;
+
+
+   bool NumberParser::ToDouble( const char* pText, int nLength, double& value )
+   {
+      const char* p    = pText;
+      const char* pEnd = pText + nLength;
+
+      // The tokenizer only trims leading spaces so drop any trailing ones
+      // here, before the digits are checked for leftovers.
+      while( pEnd > p && (pEnd[-1] == ' ' || pEnd[-1] == '\t' || pEnd[-1] == '\r' || pEnd[-1] == '\n') )
+      {
+         --pEnd;
+      }
+      nLength = int(pEnd - pText);
+
+      bool bNegative = false;
+      if( p < pEnd && (*p == '-' || *p == '+') )
+      {
+         bNegative = (*p == '-');
+         ++p;
+      }
+
+      // Accumulate the significant digits into an integer mantissa and 
+      // track where the decimal point falls with a power of ten exponent.
+      quint64 uMantissa  = 0;
+      int     nDigits    = 0;  // Significant digits in the mantissa
+      int     nExponent  = 0;  // Power of ten applied to the mantissa
+      bool    bTruncated = false;
+      bool    bAnyDigits = false;
+
+      for( ; p < pEnd && *p >= '0' && *p <= '9'; ++p )
+      {
+         bAnyDigits = true;
+         if( nDigits < nMaxMantissaDigits )
+         {
+            uMantissa = uMantissa*10 + (*p - '0');
+            if( uMantissa ) ++nDigits;
+         }
+         else
+         {
+            // The digit doesn't fit but still scales the value.
+            ++nExponent;
+            bTruncated |= (*p != '0');
+         }
+      }
+
+      if( p < pEnd && *p == '.' )
+      {
+         for( ++p; p < pEnd && *p >= '0' && *p <= '9'; ++p )
+         {
+            bAnyDigits = true;
+            if( nDigits < nMaxMantissaDigits )
+            {
+               uMantissa = uMantissa*10 + (*p - '0');
+               if( uMantissa ) ++nDigits;
+               --nExponent;
+            }
+            else
+            {
+               bTruncated |= (*p != '0');
+            }
+         }
+      }
+
+      if( !bAnyDigits )
+      {
+         return false;
+      }
+
+      if( p < pEnd && (*p == 'e' || *p == 'E') )
+      {
+         ++p;
+         bool bNegExp = false;
+         if( p < pEnd && (*p == '-' || *p == '+') )
+         {
+            bNegExp = (*p == '-');
+            ++p;
+         }
+         if( p == pEnd || *p < '0' || *p > '9' )
+         {
+            return false;
+         }
+         int nExp = 0;
+         for( ; p < pEnd && *p >= '0' && *p <= '9'; ++p )
+         {
+            // Clamp absurd exponents; the result is zero or infinity anyway.
+            if( nExp < 100000 )
+            {
+               nExp = nExp*10 + (*p - '0');
+            }
+         }
+         nExponent += bNegExp ? -nExp : nExp;
+      }
+
+      // Anything left over means the text isn't a number.
+      if( p != pEnd )
+      {
+         return false;
+      }
+
+      // Fast path (Clinger): an exact mantissa combined with an exact power
+      // of ten by a single multiply or divide is rounded correctly by the
+      // floating point unit.
+      if( !bTruncated && uMantissa <= uMaxExactMantissa &&
+          nExponent >= -nMaxExactPower && nExponent <= nMaxExactPower )
+      {
+         double d = static_cast<double>( static_cast<qint64>(uMantissa) );
+         if( nExponent < 0 )
+         {
+            d /= ExactPowersOfTen[-nExponent];
+         }
+         else
+         {
+            d *= ExactPowersOfTen[nExponent];
+         }
+         value = bNegative ? -d : d;
+         return true;
+      }
+
+      // Zero stays zero regardless of the exponent.
+      if( uMantissa == 0 && !bTruncated )
+      {
+         value = bNegative ? -0.0 : 0.0;
+         return true;
+      }
+
+      // Slow path for long or extreme values.  The text is known to be a
+      // valid number so only the rounding is left to the C locale conversion.
+      bool bOk = false;
+      double d = QLocale::c().toDouble( QString::fromLatin1(pText, nLength), &bOk );
+      if( bOk )
+      {
+         value = d;
+      }
+      return bOk;
+   }
+};
@@ -0,0 +1,46 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NUMBERPARSER_H
+#define NUMBERPARSER_H
+
+#include <QtGlobal>
+
+
+namespace Parser
+{
+   //! Converts decimal text to binary values directly from raw bytes.  The
+   //! conversion always uses '.' as the decimal point regardless of the 
+   //! system locale, and the result is the double nearest the decimal value.
+   //! Values whose digits form a mantissa of at most 2^53 with a decimal
+   //! exponent within +/-22, which covers recorded flight data, are converted
+   //! without allocating.  Other values fall back to the slower, exactly
+   //! rounded Qt conversion.  Trailing whitespace is ignored.
+   class NumberParser
+   {
+   public:
+      //! Converts the text to a double.  The whole text must be a number, 
+      //! e.g. "-12.5", "3", ".25" or "1.5e-3".
+      //! @param pText    First byte of the text
+      //! @param nLength  Number of bytes in the text
+      //! @param value    Converted value, only set on success
+      //! @retval true  If the text is a number
+      //! @retval false Otherwise
+      static bool ToDouble( const char* pText, int nLength, double& value );
+   };
+};
+#endif // NUMBERPARSER_H
@@ -0,0 +1,206 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ResultCache.h"
+
+
+namespace Data
+{
+   // Room for the selections of a few dozen flights of the usual length.
+   const qint64 ResultCache::llDefaultMaxBytes = 256 * 1024 * 1024;
+
+   // ==========================================================================
+   // ==========================================================================
+   ResultCache::ResultCache()
+      : m_llMaxBytes(llDefaultMaxBytes)
+      , m_llTick(0)
+   {
+      m_stats.nEntries  = 0;
+      m_stats.llBytes   = 0;
+      ResetStatistics();
+   }
+
+   void ResultCache::SetMaxBytes( qint64 llMaxBytes )
+   {
+      m_mutex.lock();
+      m_llMaxBytes = llMaxBytes;
+      Evict();
+      m_mutex.unlock();
+   }
+
+   QString ResultCache::Key( 
+      const QStringList& attributes,
+      bool bWindow,
+      unsigned int uBegin,
+      unsigned int uEnd,
+      int nStride,
+      bool bNormalized )
+   {
+      // Attribute names are column names, so they never hold a newline.
+      QString sKey = attributes.join( "\n" );
+      sKey += QString( "\n%1:%2:%3:%4:%5" )
+         .arg( bWindow ? 1 : 0 )
+         .arg( bWindow ? uBegin : 0 )
+         .arg( bWindow ? uEnd : 0 )
+         .arg( nStride )
+         .arg( bNormalized ? 1 : 0 );
+      return sKey;
+   }
+
+   int ResultCache::Generation( const QString& sFlight ) const
+   {
+      m_mutex.lock();
+      int nGeneration = m_generations.value( sFlight, 0 );
+      m_mutex.unlock();
+      return nGeneration;
+   }
+
+   bool ResultCache::Find( const QString& sFlight, const QString& sKey, Buffer& data )
+   {
+      bool bRetVal(false);
+      m_mutex.lock();
+      QMap<QString, EntryMap>::iterator flight = m_entries.find( sFlight );
+      if( flight != m_entries.end() )
+      {
+         EntryMap::iterator entry = flight->find( sKey );
+         if( entry != flight->end() )
+         {
+            entry->llUsed = ++m_llTick;
+            data = entry->data;
+            bRetVal = true;
+         }
+      }
+
+      if( bRetVal )
+      {
+         ++m_stats.nHits;
+      }
+      else
+      {
+         ++m_stats.nMisses;
+      }
+      m_mutex.unlock();
+      return bRetVal;
+   }
+
+   void ResultCache::Insert( 
+      const QString& sFlight, 
+      int nGeneration, 
+      const QString& sKey, 
+      const Buffer& data )
+   {
+      // The size is estimated outside of the lock.
+      Entry entry;
+      entry.data    = data;
+      entry.llBytes = data.Bytes();
+
+      m_mutex.lock();
+      // A result read while the flight changed is already out of date.
+      if( m_llMaxBytes > 0 && 
+          entry.llBytes <= m_llMaxBytes &&
+          m_generations.value(sFlight, 0) == nGeneration )
+      {
+         EntryMap& entries = m_entries[sFlight];
+         EntryMap::iterator existing = entries.find( sKey );
+         if( existing != entries.end() )
+         {
+            m_stats.llBytes -= existing->llBytes;
+            --m_stats.nEntries;
+         }
+
+         entry.llUsed = ++m_llTick;
+         entries.insert( sKey, entry );
+         m_stats.llBytes += entry.llBytes;
+         ++m_stats.nEntries;
+         Evict();
+      }
+      m_mutex.unlock();
+   }
+
+   void ResultCache::Invalidate( const QString& sFlight )
+   {
+      m_mutex.lock();
+      ++m_generations[sFlight];
+
+      QMap<QString, EntryMap>::iterator flight = m_entries.find( sFlight );
+      if( flight != m_entries.end() )
+      {
+         for( EntryMap::const_iterator entry = flight->constBegin(); 
+              entry != flight->constEnd(); ++entry )
+         {
+            m_stats.llBytes -= entry->llBytes;
+            --m_stats.nEntries;
+         }
+         m_entries.erase( flight );
+      }
+      m_mutex.unlock();
+   }
+
+   ResultCache::Statistics ResultCache::GetStatistics() const
+   {
+      m_mutex.lock();
+      Statistics stats = m_stats;
+      m_mutex.unlock();
+      return stats;
+   }
+
+   void ResultCache::ResetStatistics()
+   {
+      m_mutex.lock();
+      m_stats.nHits     = 0;
+      m_stats.nMisses   = 0;
+      m_stats.llEvicted = 0;
+      m_mutex.unlock();
+   }
+
+   void ResultCache::Evict()
+   {
+      // Called with m_mutex held.
+      while( m_stats.llBytes > m_llMaxBytes && !m_entries.empty() )
+      {
+         QMap<QString, EntryMap>::iterator oldestFlight = m_entries.end();
+         EntryMap::iterator oldest;
+         for( QMap<QString, EntryMap>::iterator flight = m_entries.begin(); 
+              flight != m_entries.end(); ++flight )
+         {
+            for( EntryMap::iterator entry = flight->begin(); 
+                 entry != flight->end(); ++entry )
+            {
+               if( oldestFlight == m_entries.end() || entry->llUsed < oldest->llUsed )
+               {
+                  oldestFlight = flight;
+                  oldest = entry;
+               }
+            }
+         }
+
+         if( oldestFlight == m_entries.end() )
+         {
+            break;
+         }
+
+         m_stats.llBytes   -= oldest->llBytes;
+         m_stats.llEvicted += oldest->llBytes;
+         --m_stats.nEntries;
+         oldestFlight->erase( oldest );
+         if( oldestFlight->empty() )
+         {
+            m_entries.erase( oldestFlight );
+         }
+      }
+   }
+};
@@ -0,0 +1,134 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _RESULTCACHE_H_
+#define _RESULTCACHE_H_
+
+#include <QMutex>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include "DataTypes.h"
+
+
+namespace Data
+{
+   //! Thread safe cache of the results of attribute queries so that views 
+   //! asking for the same selection again are answered without reading the
+   //! flight.  Results are kept per flight and a flight's results are only
+   //! dropped when it changes, e.g. it is loaded again or rows are appended.
+   //!
+   //! Each flight has a generation that Invalidate() advances.  A query 
+   //! takes the generation before reading the flight and its result is only
+   //! kept if the flight hasn't changed while it was read.  Once the cache
+   //! holds more than its maximum number of bytes the results used least 
+   //! recently are dropped.
+   class ResultCache
+   {
+   public:
+      //! Default maximum number of bytes held by the results.
+      static const qint64 llDefaultMaxBytes;
+
+      //! Counts of how often a result was found.
+      struct Statistics
+      {
+         int    nHits;      //!< Find() calls that found a result
+         int    nMisses;    //!< Find() calls that didn't
+         int    nEntries;   //!< Results held
+         qint64 llBytes;    //!< Approximate number of bytes held by the results
+         qint64 llEvicted;  //!< Bytes of the results dropped to make room
+      };
+
+      ResultCache();
+
+      //! Sets the maximum number of bytes held by the results.  Zero keeps
+      //! no results at all.
+      void SetMaxBytes( qint64 llMaxBytes );
+
+      //! Builds the key of a query on a flight.
+      //! @param attributes   Attributes queried
+      //! @param bWindow      True if the query is limited to [uBegin, uEnd)
+      //! @param uBegin       First time of the window
+      //! @param uEnd         Time the window ends before
+      //! @param nStride      Only every nStride-th row is returned
+      //! @param bNormalized  True if the values are normalized
+      static QString Key( 
+         const QStringList& attributes,
+         bool bWindow,
+         unsigned int uBegin,
+         unsigned int uEnd,
+         int nStride,
+         bool bNormalized );
+
+      //! Returns the current generation of a flight, to pass to Insert().
+      int Generation( const QString& sFlight ) const;
+
+      //! Looks up the result of a query.
+      //! @param sFlight  Name of the flight
+      //! @param sKey     Key of the query, see Key()
+      //! @param data     Receives the result
+      //! @retval true  If the result was held
+      //! @retval false Otherwise
+      bool Find( const QString& sFlight, const QString& sKey, Buffer& data );
+
+      //! Keeps the result of a query unless the flight changed since its 
+      //! generation was taken.
+      //! @param sFlight      Name of the flight
+      //! @param nGeneration  Generation of the flight before it was read
+      //! @param sKey         Key of the query, see Key()
+      //! @param data         Result of the query
+      void Insert( 
+         const QString& sFlight, 
+         int nGeneration, 
+         const QString& sKey, 
+         const Buffer& data );
+
+      //! Drops every result of a flight and advances its generation.
+      void Invalidate( const QString& sFlight );
+
+      //! Returns the counts since the last ResetStatistics().
+      Statistics GetStatistics() const;
+
+      //! Restarts the hit and miss counts.
+      void ResetStatistics();
+
+   private:
+      //! Result held for a query.
+      struct Entry
+      {
+         Buffer  data;     //!< Result of the query, shared rather than copied
+         qint64  llBytes;  //!< Approximate number of bytes held by data
+         quint64 llUsed;   //!< Tick of the last time the result was used
+      };
+
+      //! Results of a flight by the key of their query.
+      typedef QMap<QString, Entry> EntryMap;
+
+      //! Drops the results used least recently until the results fit.
+      void Evict();
+
+      mutable QMutex          m_mutex;       //!< Mutex for thread safety
+      QMap<QString, EntryMap> m_entries;     //!< Results of each flight
+      QMap<QString, int>      m_generations; //!< Generation of each flight
+      qint64                  m_llMaxBytes;  //!< Maximum number of bytes held
+      quint64                 m_llTick;      //!< Advanced each time a result is used
+      Statistics              m_stats;       //!< Counts of the cache use
+   };
+};
+
+#endif // _RESULTCACHE_H_
@@ -0,0 +1,209 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+
+#include "ShardWriter.h"
+
+using namespace std;
+
+
+namespace Data
+{
+
+   // Longest time the writer waits for data before checking for a stop.
+   const unsigned long nShardIdleWaitMsec = 500;
+
+
+   // ==========================================================================
+   // ==========================================================================
+   ShardWriter::ShardWriter( 
+      const QString& sFileName, 
+      DataMgmt::LoadProfile eProfile,
+      DataBufferPool& pool )
+      : m_sFileName(sFileName)
+      , m_eProfile(eProfile)
+      , m_pool(pool)
+      , m_bStop(false)
+   {
+   }
+
+   ShardWriter::~ShardWriter()
+   {
+      Close();
+      Stop();
+      wait();
+   }
+
+   const QString& ShardWriter::GetFileName() const
+   {
+      return m_sFileName;
+   }
+
+   bool ShardWriter::Enqueue( DataBuffer& buffer )
+   {
+      return m_queue.Enqueue( buffer );
+   }
+
+   void ShardWriter::Close()
+   {
+      m_queue.Close();
+   }
+
+   void ShardWriter::Stop()
+   {
+      m_bStop = true;
+   }
+
+   void ShardWriter::run()
+   {
+      // A connection may only be used by the thread that opened it, so the
+      // shard opens its own here and removes it once it is done.
+      {
+         QSqlDatabase db = QSqlDatabase::addDatabase( "QSQLITE", m_sFileName );
+         db.setDatabaseName( m_sFileName );
+         if( db.open() )
+         {
+            ApplySettings( db );
+         }
+         else
+         {
+            cerr << "Failed to open the shard database " << qPrintable(m_sFileName) << endl;
+            cerr << "Error Message: " << qPrintable(db.lastError().text()) << endl;
+         }
+
+         // Buffers are still taken when the shard couldn't be opened so the
+         // flights complete, the same as when a statement fails.
+         DataBuffer buffer;
+         m_queue.SetConsumerRunning( true );
+         while( !m_bStop )
+         {
+            if( m_queue.Dequeue(buffer) )
+            {
+               Store( db, buffer );
+               emit( BufferStored(buffer.sFlightName, buffer.nRows, buffer.bLastBuffer) );
+               m_pool.Release( buffer );
+            }
+            else
+            {
+               m_queue.WaitForData( nShardIdleWaitMsec );
+            }
+         }
+
+         // The consumer of the flight must not wait on a writer that stopped.
+         m_queue.SetConsumerRunning( false );
+         m_inserts.clear();
+         db.close();
+      }
+      QSqlDatabase::removeDatabase( m_sFileName );
+
+      m_bStop = false; // In case the thread needs restarted.
+   }
+
+   void ShardWriter::Store( QSqlDatabase& db, const DataBuffer& buffer )
+   {
+      if( !db.isOpen() )
+      {
+         return;
+      }
+
+      db.transaction();
+
+      // Statements change the table of the flight so its insert is released
+      // before they run and prepared again afterward.
+      if( !buffer.data.empty() )
+      {
+         m_inserts.remove( buffer.sFlightName );
+      }
+
+      QSqlQuery q(db);
+      for( int i = 0; i < buffer.data.size(); ++i )
+      {
+         if( !q.exec(buffer.data.at(i)) )
+         {
+            cerr << "------------------------------------------" << endl;
+            cerr << "Query failed for shard " << qPrintable(m_sFileName) << endl;
+            cerr << "   Flight       : " << qPrintable(buffer.sFlightName) << endl;
+            cerr << "   Query        : " << qPrintable(buffer.data.at(i));
+            cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+            cerr << "------------------------------------------" << endl;
+         }
+      }
+
+      // During a bulk load the indexes are held back until the rows are in,
+      // otherwise they're created along with the table.
+      if( buffer.bFirstBuffer )
+      {
+         if( m_eProfile == DataMgmt::LoadProfile_BulkLoad )
+         {
+            m_unindexed[buffer.sFlightName] = buffer.columns;
+         }
+         else
+         {
+            DataMgmt::CreateIndexes( db, buffer.sFlightName, buffer.columns );
+         }
+      }
+
+      DataMgmt::InsertRows( db, m_inserts, buffer );
+
+      if( buffer.bLastBuffer )
+      {
+         FlightColumnMap::iterator i = m_unindexed.find( buffer.sFlightName );
+         if( i != m_unindexed.end() )
+         {
+            DataMgmt::CreateIndexes( db, buffer.sFlightName, i.value() );
+            m_unindexed.erase( i );
+         }
+      }
+
+      db.commit();
+   }
+
+   void ShardWriter::ApplySettings( QSqlDatabase& db )
+   {
+      // Write ahead logging lets the DataMgmt connection read the flights 
+      // of the shard that are complete while others are being written.  
+      // The bulk load settings don't take the exclusive lock for the same
+      // reason, and each shard has a share of the cache.
+      QStringList pragmas;
+      pragmas << "PRAGMA journal_mode = WAL";
+      if( m_eProfile == DataMgmt::LoadProfile_BulkLoad )
+      {
+         pragmas << "PRAGMA synchronous = OFF"
+                 << "PRAGMA cache_size = -65536";
+      }
+
+      QSqlQuery q(db);
+      for( int i = 0; i < pragmas.size(); ++i )
+      {
+         if( !q.exec(pragmas.at(i)) )
+         {
+            cerr << "Unable to apply shard setting " << qPrintable(pragmas.at(i)) << endl;
+            cerr << "   Error Message: " << qPrintable(q.lastError().text()) << endl;
+         }
+      }
+   }
+
+   // ==========================================================================
+   // ==========================================================================
+
+};
@@ -0,0 +1,98 @@
+// Written by David Sheets
+// Visualization product for analyzing data, flight data in particular.
+// Copyright (C) 2011  David Sheets (dsheets4@kent.edu)
+//
+// Visualization is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _SHARDWRITER_H_
+#define _SHARDWRITER_H_
+
+#include <QThread>
+#include <QMap>
+#include <QString>
+
+#include "DataTypes.h"
+#include "DataQueue.h"
+#include "DataBufferPool.h"
+#include "DataMgmt.h"
+
+
+namespace Data
+{
+   //! Stores the flights of one shard in a database file of its own, on a
+   //! thread of its own.  Each shard has its own connection and lock so 
+   //! flights in different shards are committed at the same time.  The 
+   //! file is attached to the DataMgmt database so the flights are read as
+   //! if they were in it.
+   class ShardWriter : public QThread
+   {
+      Q_OBJECT
+
+   public:
+      //! @param sFileName  Database file of the shard
+      //! @param eProfile   Settings used while flights load
+      //! @param pool       Pool the stored buffers are returned to
+      ShardWriter( 
+         const QString& sFileName, 
+         DataMgmt::LoadProfile eProfile,
+         DataBufferPool& pool );
+      ~ShardWriter();
+
+      //! Returns the database file of the shard.
+      const QString& GetFileName() const;
+
+      //! Hands a buffer to the shard, leaving it empty.  Waits while the 
+      //! shard's queue is full.
+      //! @retval true  If the buffer was queued
+      //! @retval false If the shard was closed
+      bool Enqueue( DataBuffer& buffer );
+
+      //! Closes the queue so that nothing waits on the shard any longer.
+      void Close();
+
+      //! Stops storing buffers once the current one is committed.
+      void Stop();
+
+   signals:
+      //! Signal sent once the rows of a buffer are committed.
+      //! @param sFlightName  Name of the flight
+      //! @param nRows        Number of rows that were added
+      //! @param bLastBuffer  True if the flight is complete
+      void BufferStored(QString sFlightName, int nRows, bool bLastBuffer);
+
+   protected:
+      //! The threaded functionality.
+      void run();
+
+   private:
+      //! Runs the statements of a buffer and inserts its rows.
+      //! @param db      Connection to the shard
+      //! @param buffer  Buffer to store
+      void Store( QSqlDatabase& db, const DataBuffer& buffer );
+
+      //! Applies the database settings of the shard.
+      //! @param db  Connection to the shard
+      void ApplySettings( QSqlDatabase& db );
+
+      QString               m_sFileName;   //!< Database file of the shard
+      DataMgmt::LoadProfile m_eProfile;    //!< Settings used while flights load
+      DataBufferPool&       m_pool;        //!< Pool the stored buffers go back to
+      DataQueue             m_queue;       //!< Buffers waiting to be stored
+      FlightInsertMap       m_inserts;     //!< Prepared insert statement of each flight
+      FlightColumnMap       m_unindexed;   //!< Flights whose indexes wait on their rows
+      bool                  m_bStop;       //!< Flag indicating that storing should stop
+   };
+};
+
+#endif // _SHARDWRITER_H_
@@ -24,16 +24,19 @@
 #include <QLabel>
 #include <QProgressBar>
 #include <QMdiSubWindow>
+#include <QDesktopServices>
+#include <QDir>
 
 #include <QSqlDatabase>
 #include <QSqlError>
+#include <qnumeric.h>
 
 #include "EventDetector.h"
+#include "FlightCache.h"
 #include "TableEditor.h"
 #include "Chart_ParallelCoordinates.h"
 #include "seansGlyphCode/EventGlyph.h"
 #include "Visualization.h"
-#include "DataNormalizer.h"
 
 
 //const QString sConnectionName = "Database.db";
@@ -43,6 +46,20 @@ const QSize DefaultWindowSize(600,450);
 using namespace std;
 
 
+// Values of a row of a buffer for the real time glyph, which draws -1 as a
+// missing value.
+static std::vector<float> GlyphValues( const Data::Buffer& buffer, int nRow )
+{
+   std::vector<float> values( buffer.AttributeCount() );
+   for( int a = 0; a < buffer.AttributeCount(); ++a )
+   {
+      double value = buffer.Value( nRow, a );
+      values[a] = qIsNaN(value) ? -1 : value;
+   }
+   return values;
+}
+
+
 Visualization::Visualization(QWidget *parent, Qt::WFlags flags)
    : QMainWindow(parent, flags)
    , _map(0)
@@ -55,7 +72,11 @@ Visualization::Visualization(QWidget *parent, Qt::WFlags flags)
 
 
    Event::EventDetector evtDetect;
-   m_dataMgmt.Connect( sConnectionName );
+   m_sConnectionName = sConnectionName;
+   m_dataMgmt.Connect( m_sConnectionName );
+   m_dataMgmt.SetIngestMode( Data::DataMgmt::IngestMode_Deferred );
+   Data::FlightCache::SetDirectory( QDir(QDesktopServices::storageLocation(
+      QDesktopServices::CacheLocation)).filePath("FlightCache") );
    m_dataMgmt.SetEventDefinition( evtDetect.GetEventDefinition() );
    this->addDockWidget(Qt::LeftDockWidgetArea, &m_dockWidgetAttr);
    m_attrSel.SetDataMgmt( &m_dataMgmt );
@@ -70,6 +91,7 @@ Visualization::Visualization(QWidget *parent, Qt::WFlags flags)
    // Basic application function connections
    connect( ui.actionExit, SIGNAL(triggered()), this, SLOT(close()) );
    connect( ui.actionOpen, SIGNAL(triggered()), this, SLOT(LoadFile()) );
+   connect( ui.actionFollow, SIGNAL(triggered()), this, SLOT(FollowFile()) );
    // -------------------------------------------------------------------------
 
    // -------------------------------------------------------------------------
@@ -77,12 +99,21 @@ Visualization::Visualization(QWidget *parent, Qt::WFlags flags)
    connect
       ( &m_dataMgmt,  SIGNAL(FlightComplete(QString))
       , this,         SLOT(DatabaseStatus(QString)) );
+   connect
+      ( &m_dataMgmt,  SIGNAL(RowsAppended(QString,int))
+      , this,         SLOT(RowsAppended(QString,int)) );
+   connect
+      ( &m_dataMgmt,  SIGNAL(CacheSaved(QString,bool))
+      , this,         SLOT(CacheSaved(QString,bool)) );
    connect
       ( &m_dataMgmt,  SIGNAL(setProgressRange(int,int))
       , progress,     SLOT(setRange(int,int)) );
    connect
       ( &m_dataMgmt,  SIGNAL(setCurrentProgress(int))
       , progress,     SLOT(setValue(int)) );
+   connect
+      ( &m_ingestPool, SIGNAL(jobFinished(int,QString,bool,bool))
+      , this,          SLOT(CsvFileDone(int,QString,bool,bool)) );
    // -------------------------------------------------------------------------
 
    // -------------------------------------------------------------------------
@@ -109,35 +140,58 @@ Visualization::~Visualization()
 
 }
 
+void Visualization::SetIngestMode( Data::DataMgmt::IngestMode eMode )
+{
+   m_dataMgmt.SetIngestMode( eMode );
+}
+
+bool Visualization::SetDatabase( const QString& sDatabase )
+{
+   m_sConnectionName = sDatabase;
+   return m_dataMgmt.Connect( m_sConnectionName ) && m_dataMgmt.OpenCatalog();
+}
+
 void Visualization::closeEvent( QCloseEvent* event )
 {
    m_csvParser.stopParse();
+   m_ingestPool.CancelAll();
 }
 
 void Visualization::LoadFile()
 {
    // Create a file open dialog and prompt the user for a file.
-   m_listFileNames = QFileDialog::getOpenFileNames(this,
-      tr("Open CSV"), "../../../data", tr("CSV Files (*.csv)") );
-
-   // Initiate the load for the selected files but limit the number of threads
-   // that will be launched at one time.
-   int nLaunched = 0;
-   int nThreads = QThread::idealThreadCount()-1;
-   if( nThreads < 1 )
+   QStringList files = QFileDialog::getOpenFileNames(this,
+      tr("Open CSV"), "../../../data", tr("CSV Files (*.csv *.csv.gz)") );
+
+   // Queue every selected file.  The ingest pool limits how many are parsed
+   // at one time.
+   for( int s = 0; s < files.size(); ++s )
    {
-      nThreads = 1;
+      LoadFlight( files.at(s) );
    }
-   for( int s = m_listFileNames.size()-1; s >= 0 && nLaunched < nThreads; --s )
+}
+
+void Visualization::FollowFile()
+{
+   // A recording is followed on a parser thread of its own that runs until 
+   // the application closes.
+   QString filename = QFileDialog::getOpenFileName(this,
+      tr("Follow CSV Recording"), "../../../data", tr("CSV Files (*.csv)") );
+   if( !filename.isEmpty() )
    {
-      LoadFlight( m_listFileNames.takeLast() );
-      ++nLaunched;
+      LoadFlight( filename, true );
    }
 }
 
-void Visualization::LoadFlight( const QString& filename )
+void Visualization::LoadFlight( const QString& filename, bool bFollow )
 {
-   // Prepare to process the data from the queue.
+   // Prepare to process the data from the queue.  A thread that was told to
+   // stop may not have noticed yet, so it is allowed to finish and started
+   // again rather than left to exit with the new flight queued.
+   if( m_dataMgmt.IsStopping() )
+   {
+      m_dataMgmt.wait();
+   }
    if( !m_dataMgmt.isRunning() )
    {
       //cout << "Starting data management thread." << endl;
@@ -151,6 +205,10 @@ void Visualization::LoadFlight( const QString& filename )
    {
       index = filename.length() - index - 1;
       sFlightName = filename.right(index);
+      if( sFlightName.endsWith(".gz", Qt::CaseInsensitive) )
+      {
+         sFlightName.chop(3);
+      }
       index = sFlightName.lastIndexOf('.');
       if( index != -1 )
       {
@@ -163,9 +221,16 @@ void Visualization::LoadFlight( const QString& filename )
       sFlightName.sprintf("Default_%03d", ++m_nNextFlightNum);
    }
 
-   // Create and setup a new parser thread.
+   // Create and setup a new parser for the ingest pool.
    Parser::CsvParser* parser = new Parser::CsvParser;
-   parser->SetParseInformation( filename, &m_dataMgmt, sFlightName, sConnectionName );
+   parser->SetParseInformation( filename, &m_dataMgmt, sFlightName, m_sConnectionName );
+   parser->SetParallel( !bFollow );
+   parser->SetFollow( bFollow );
+
+   // A flight opened before is used from the database, or else read back 
+   // from its cache, by its ingest job rather than parsed.  Recordings being
+   // followed are still changing so they aren't kept.
+   parser->SetReuse( !bFollow );
 
    // Set the progress bar and a placeholder in the tree widget.
    QProgressBar* progress = new QProgressBar();
@@ -178,54 +243,81 @@ void Visualization::LoadFlight( const QString& filename )
    connect
       ( parser,       SIGNAL(setCurrentProgress(int))
       , progress,     SLOT(setValue(int)) );
-
-   // Connect the CSV parser so we can cleanup the memory.
    connect
-      ( parser,       SIGNAL(finished())
-      , this,         SLOT(CsvFileDone()) );
+      ( parser,       SIGNAL(cacheMissed(QString,QString))
+      , this,         SLOT(CacheMissed(QString,QString)) );
 
-   parser->start();
+   // Followed recordings start ahead of waiting files and get a thread of
+   // their own since they never finish.  The pool deletes the parser.
+   if( bFollow )
+   {
+      m_followJobs.append( m_ingestPool.Submit(parser, Parser::IngestPool::Priority_High, true) );
+   }
+   else
+   {
+      m_ingestPool.Submit( parser );
+   }
 
-   // Increment when the CSV thread is started.  
+   // Increment when the CSV job is submitted.  
    // Decrement when the Database is done
    ++m_nToComplete;
 }
 
-void Visualization::CsvFileDone()
+void Visualization::CsvFileDone(int nJob, QString sFlightName, bool bSuccess, bool bCommitted)
 {
-   // ---------------------------------------------------------------------------
-   // Clean up the old parser.
-   Parser::CsvParser* parser = dynamic_cast<Parser::CsvParser*>(QObject::sender());
-   if( !parser )
+   m_followJobs.removeAll( nJob );
+   if( !bSuccess )
    {
-      std::cerr << "Error accessing flight data after load" << std::endl;
-      return;
+      std::cerr << "Unable to load all of the flight " << qPrintable(sFlightName) << std::endl;
+      m_cacheFiles.remove( sFlightName );
    }
-   //! @todo After thinking some this is probably dangerous to delete the sender
-   //!       object because if there are other objects registered for this signal
-   //!       it probably won't get handled properly.  Something to work on later.
-   //!       For now, the object is created internal to this one and it's the only
-   //!       one listening for signals from the object.
-   delete parser;
-   
-   // ---------------------------------------------------------------------------
-   // If there are other files in the queue, begin loading them.
-   if( !m_listFileNames.empty() )
+
+   // A flight that was never committed won't complete in the database.
+   if( !bCommitted )
+   {
+      --m_nToComplete;
+      if( m_nToComplete == 0 && m_followJobs.empty() )
+      {
+         m_dataMgmt.stopProcessing();
+      }
+   }
+}
+
+void Visualization::CacheMissed(QString sFlightName, QString sCacheFile)
+{
+   // A parsed flight is written to its cache once its events are detected.
+   m_cacheFiles[sFlightName] = sCacheFile;
+}
+
+void Visualization::CacheSaved(QString sFlightName, bool bSaved)
+{
+   // The flight is simply parsed again next time.
+   if( !bSaved )
    {
-      LoadFlight( m_listFileNames.takeFirst() );
+      std::cerr << "Unable to cache the flight " << qPrintable(sFlightName) << std::endl;
    }
 }
 
 void Visualization::DatabaseStatus(QString sFlightName)
 {
    // -------------------------------------------------------------------------
-   // Detect the events for the flight.
+   // Detect the events for the flight.  Flights from the catalog or cache 
+   // may already have their events.  Parsed flights are cached once their 
+   // events are known.
    // -------------------------------------------------------------------------
-   Event::EventDetector evtDetect;
-   Data::EventData evtData;
-   if( evtDetect.DetectEvents( sFlightName, &m_dataMgmt, evtData) )
+   if( !m_dataMgmt.TakeRestoredEvents(sFlightName) )
    {
-      m_dataMgmt.SetEventData( sFlightName, evtData );
+      Event::EventDetector evtDetect;
+      Data::EventData evtData;
+      if( evtDetect.DetectEvents( sFlightName, &m_dataMgmt, evtData) )
+      {
+         m_dataMgmt.SetEventData( sFlightName, evtData );
+      }
+
+      if( m_cacheFiles.contains(sFlightName) )
+      {
+         m_dataMgmt.SaveCache( m_cacheFiles.take(sFlightName), sFlightName );
+      }
    }
 
    // -------------------------------------------------------------------------
@@ -244,13 +336,29 @@ void Visualization::DatabaseStatus(QString sFlightName)
    // Decrement when the Database is done
    --m_nToComplete;
 
-   if( m_nToComplete == 0 )
+   // Followed recordings keep adding rows so the thread is left running.
+   if( m_nToComplete == 0 && m_followJobs.empty() )
    {
       //cout << "Flight processing complete. Stopping data management thread." << endl;
       m_dataMgmt.stopProcessing();
    }
 }
 
+void Visualization::RowsAppended(QString sFlightName, int nRows)
+{
+   // The views are only created once a flight completes.
+   if( !_map )
+   {
+      return;
+   }
+
+   // Extend the time slider to cover the new rows and redraw the map.
+   _toolbar->setNewMax(int(m_dataMgmt.GetRowCount(sFlightName)));
+
+   _map->getNewAttributes();
+   _map->updateMap();
+}
+
 // Sets up the main map view and widgets associated with it
 void Visualization::createVisualizationUI()
 {
@@ -306,7 +414,7 @@ void Visualization::createVisualizationUI()
         QStringList temp;
         Data::Buffer buffer;
         m_dataMgmt.GetDataAttributes(flights.at(0), temp, buffer);
-        _toolbar->setNewMax(buffer._params.size());
+        _toolbar->setNewMax(buffer.RowCount());
 
         // Get the first set of data
         _map->getNewAttributes();
@@ -344,7 +452,7 @@ void Visualization::createVisualizationUI()
             QStringList temp;
             Data::Buffer buffer;
             m_dataMgmt.GetDataAttributes(flights.at(i), temp, buffer);
-            _toolbar->setNewMax(buffer._params.size());
+            _toolbar->setNewMax(buffer.RowCount());
         }
 
         _map->getNewAttributes();
@@ -362,7 +470,7 @@ void Visualization::OnViewTable()
    const Data::Selections& selections = m_attrSel.GetSelectedAttributes();
    for( Data::Selections::const_iterator i = selections.begin(); i != selections.end(); ++i )
    {
-      m_viewTable = new TableEditor(sConnectionName, i.key());
+      m_viewTable = new TableEditor(m_sConnectionName, i.key());
       m_viewTable->setObjectName(QString::fromUtf8("chart"));
       m_viewTable->setWindowTitle(QApplication::translate("VisualizationClass", qPrintable(i.key()), 0, QApplication::UnicodeUTF8));
       QMdiSubWindow* subwindow = ui.mdiArea->addSubWindow(m_viewTable);
@@ -461,9 +569,7 @@ void Visualization::OnViewRealTimeGlyph()
 
            // Get attributes' data for glyph
            Data::Buffer buffer;
-           m_dataMgmt.GetDataAttributes(flights[i],attNames, buffer);
-           Data::Normalizer norm;
-           norm.Process(buffer);
+           m_dataMgmt.GetNormalizedAttributes(flights[i],attNames, buffer);
 
            // Pair up the buffer with its flight_id
            //QPair<QString, Data::Buffer> pair(flights[i],buffer);
@@ -496,7 +602,7 @@ void Visualization::OnViewRealTimeGlyph()
     rt_glyph->SetAxisLabels( labels );
 
     // Draw the current point set
-    rt_glyph->DrawPointSet(buffer._params.at(_toolbar->slider()->value())._dataVector);
+    rt_glyph->DrawPointSet(GlyphValues(buffer, _toolbar->slider()->value()));
 
     QMdiSubWindow* subwindow = ui.mdiArea->addSubWindow(rt_glyph->GetGlyphView());
     subwindow->setWindowTitle(QApplication::translate("VisualizationClass", qPrintable(_loadedFlights->currentText()), 0, QApplication::UnicodeUTF8));
@@ -525,11 +631,6 @@ void Visualization::onTimeChanged(int idx)
                QMap<QString, Data::Buffer>::iterator b_iter = _buffers.find(_loadedFlights->currentText());
                Data::Buffer buffer = b_iter.value();
                //m_dataMgmt.GetDataAttributes(_flights[i],attNames, buffer);
-               /*QList<QVariant> stuff = _buffers.at(i)._params.at(idx)._dataVector;
-               std::vector<float> attValues;
-               for(int j = 0; j < stuff.size();j++) {
-                   attValues.push_back(stuff[j].toDouble());
-               }*/
 
                // Make sure the labels are current to the selection
                std::vector<std::string> labels;
@@ -538,9 +639,9 @@ void Visualization::onTimeChanged(int idx)
                }
                rt_glyph->SetAxisLabels( labels );
 
-               if( idx < buffer._params.size() )
+               if( idx < buffer.RowCount() )
                {
-                  rt_glyph->DrawPointSet(buffer._params.at(idx)._dataVector);
+                  rt_glyph->DrawPointSet(GlyphValues(buffer, idx));
                   //rt_glyph->GetGlyphView()->CorrectResize();
                }
             }
@@ -25,6 +25,7 @@
 #include "DataMgmt.h"
 #include "DataSelections.h"
 #include "CsvParser.h"
+#include "IngestPool.h"
 #include "DockWidgetAttributes.h"
 #include "MapWidget.h"
 #include "seansGlyphCode/RealTimeGlyph.h"
@@ -49,6 +50,18 @@ public:
    Visualization(QWidget *parent = 0, Qt::WFlags flags = 0);
    ~Visualization();
 
+   //! Selects how loaded flights are stored, IngestMode_Deferred by default.
+   //! The table view only shows flights that are in the database.
+   void SetIngestMode( Data::DataMgmt::IngestMode eMode );
+
+   //! Keeps the flights in a database on disk rather than in memory.  A
+   //! flight stored by an earlier session is used as is unless its file 
+   //! has changed.
+   //! @param sDatabase  Path of the database, created if it doesn't exist
+   //! @retval true  If the database and its catalog are open
+   //! @retval false Otherwise
+   bool SetDatabase( const QString& sDatabase );
+
 
 protected:
    // Handles the user clicking to close the application.
@@ -61,11 +74,23 @@ protected slots:
    //! Slot to handle user selection of the File->Open action.
    void LoadFile();
 
+   //! Slot to handle user selection of the File->Follow Recording action.
+   void FollowFile();
+
    //! Slot to handle enhanced status for a CSV parse.
    void DatabaseStatus(QString sFlightName);
 
-   //! Slot that handles the completion of a CSV file thread.
-   void CsvFileDone();
+   //! Slot to handle rows added to a flight that is being followed.
+   void RowsAppended(QString sFlightName, int nRows);
+
+   //! Slot that handles the completion of a CSV file parse job.
+   void CsvFileDone(int nJob, QString sFlightName, bool bSuccess, bool bCommitted);
+
+   //! Slot that tracks the cache file to write for a parsed flight.
+   void CacheMissed(QString sFlightName, QString sCacheFile);
+
+   //! Slot that reports a cache file that couldn't be written.
+   void CacheSaved(QString sFlightName, bool bSaved);
 
    //! Slot that opens the database table view.
    void OnViewTable();
@@ -83,7 +108,9 @@ protected slots:
 
 private:
    //! Loads a single flight.
-   void LoadFlight( const QString& filename );
+   //! @param filename  CSV file of the flight
+   //! @param bFollow   True to keep adding rows appended to the file
+   void LoadFlight( const QString& filename, bool bFollow = false );
 
    Ui::VisualizationClass ui;  //!< Qt generated from the .ui file from Designer
 
@@ -105,6 +132,7 @@ private:
 
    Parser::CsvParser     m_csvParser; //!< Class to parse CSV files
    Data::DataMgmt        m_dataMgmt;  //!< Abstraction of the data management
+   Parser::IngestPool    m_ingestPool;//!< Threads parsing the files being loaded
    Data::DataSelections  m_attrSel;   //!< User selected data.
 
    DockWidgetAttributes m_dockWidgetAttr; //!< The attribute dock widget.
@@ -112,7 +140,9 @@ private:
    Chart::ParallelCoordinates *m_viewPC;    //!< Graphical depiction of the data
    TableEditor                *m_viewTable; //!< Database editing view.
 
-   QStringList     m_listFileNames;  //!< List of files to be opened.
+   QString         m_sConnectionName;//!< Database the flights are stored in.
+   QList<int>      m_followJobs;     //!< Parse jobs following recordings.
+   QMap<QString,QString> m_cacheFiles; //!< Cache file to write for each parsed flight.
    unsigned int    m_nToComplete;    //!< Value to keep track of how many flights are yet to complete.
    unsigned int    m_nNextFlightNum; //!< Next number to assign for unique names.
 };
@@ -18,11 +18,36 @@
 #include "Visualization.h"
 #include <QtGui/QApplication>
 
+#include <iostream>
 
+
+// Usage: Visualization [--ingest database|columns|deferred] [--database file]
 int main(int argc, char *argv[])
 {
    QApplication a(argc, argv);
    Visualization w;
+
+   QStringList args = a.arguments();
+   int index = args.indexOf("--ingest");
+   if( index != -1 && index+1 < args.size() )
+   {
+      Data::DataMgmt::IngestMode eMode;
+      if( Data::DataMgmt::ParseIngestMode( args.at(index+1), eMode ) )
+      {
+         w.SetIngestMode( eMode );
+      }
+      else
+      {
+         std::cerr << "Unknown ingest mode " << qPrintable(args.at(index+1)) << std::endl;
+      }
+   }
+
+   index = args.indexOf("--database");
+   if( index != -1 && index+1 < args.size() && !w.SetDatabase( args.at(index+1) ) )
+   {
+      std::cerr << "Unable to open the database " << qPrintable(args.at(index+1)) << std::endl;
+   }
+
    w.show();
    return a.exec();
 }
@@ -68,7 +68,7 @@ public:
 	RealTimeGlyph(const int x_res, const int y_res, const int number_of_variables);
 	~RealTimeGlyph(void);
 
-        void DrawPointSet(const QList<QVariant>& data);
+        void DrawPointSet(const std::vector<float>& data);
 	void ClearGlyph(void);
 	void SetAttributeNumber(const int number_of_variables);
 	void SetAxisLabels(const std::vector<std::string>& axis_names);